@@ -26,15 +26,23 @@
  * Extremely generic interface for a genetic algorithm
  * initialize() and finalize() functions are guaranteed to be called by the
  * Processsor before and after Algo evaluation
+ * getGenes() exposes the tunable parameters as numbers for population
+ * statistics, in the same order as getGeneNames()
+ * clone() makes an algorithm of the same kind and mutation settings from a
+ * getGenes() vector, e.g. to restore a saved population
  **/
 
 class Algo
 {
     public:
+        virtual ~Algo() {}
         virtual void initialize() = 0;
         virtual std::vector<double> update(const std::vector<double>& inputs)  = 0;
         virtual void finalize() = 0;
         virtual Algo* gen() const = 0;
+        virtual Algo* clone(const std::vector<double>& genes) const = 0;
         virtual std::string getSummary() const = 0;
+        virtual std::vector<double> getGenes() const = 0;
+        virtual std::vector<std::string> getGeneNames() const = 0;
 };
 #endif // ALGO_HPP
@@ -0,0 +1,77 @@
+/*
+ *  AllocCounter.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AllocCounter.hpp"
+
+#include <new>
+#include <stdlib.h>
+
+static __thread unsigned long long s_allocations = 0;
+static __thread unsigned long long s_allocatedBytes = 0;
+
+unsigned long long threadAllocations()
+{
+    return s_allocations;
+}
+
+unsigned long long threadAllocatedBytes()
+{
+    return s_allocatedBytes;
+}
+
+static void* countedAlloc(size_t size)
+{
+    s_allocations++;
+    s_allocatedBytes += size;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size)
+{
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size)
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) throw()
+{
+    free(p);
+}
+
+void operator delete[](void* p, size_t) throw()
+{
+    free(p);
+}
@@ -0,0 +1,35 @@
+/*
+ *  AllocCounter.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ALLOC_COUNTER_HPP
+#define ALLOC_COUNTER_HPP
+
+/**
+ * Per-thread heap allocation counters
+ * AllocCounter.cpp replaces the global operator new, so linking it in is
+ * enough to make every C++ allocation count towards the calling thread.
+ * Counters are thread local to keep the hot path free of shared cache lines;
+ * take the difference of two readings on the same thread to attribute
+ * allocations to a region of code. The libraries link NullAllocCounter.cpp
+ * instead, which leaves the host's operator new alone and counts nothing
+ **/
+
+unsigned long long threadAllocations();
+unsigned long long threadAllocatedBytes();
+
+#endif // ALLOC_COUNTER_HPP
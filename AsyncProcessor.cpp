@@ -0,0 +1,108 @@
+/*
+ *  AsyncProcessor.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AsyncProcessor.hpp"
+
+#include <vector>
+
+struct AsyncProcessor::Ticket
+{
+    Processor::Score* score;
+    unsigned int* remaining;
+};
+
+AsyncProcessor::AsyncProcessor(unsigned int maxInFlight)
+    : m_maxInFlight(maxInFlight > 0 ? maxInFlight : 1)
+    , m_inFlight(0)
+    , m_peakInFlight(0)
+{
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+}
+
+AsyncProcessor::~AsyncProcessor()
+{
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+unsigned int AsyncProcessor::peakInFlight() const
+{
+    pthread_mutex_lock(&m_mutex);
+    unsigned int peak = m_peakInFlight;
+    pthread_mutex_unlock(&m_mutex);
+    return peak;
+}
+
+void AsyncProcessor::complete(Ticket* ticket, const Processor::Score& score) const
+{
+    pthread_mutex_lock(&m_mutex);
+    *ticket->score = score;
+    --*ticket->remaining;
+    m_inFlight--;
+    // Both a full window and a finished batch wait on the one condition
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void AsyncProcessor::run(Algo* const* algos, unsigned int count, Processor::Score* scores, const std::string& logname) const
+{
+    std::vector<Ticket> tickets(count);
+    unsigned int remaining = count;
+    for(unsigned int i = 0; i < count; i++)
+    {
+        pthread_mutex_lock(&m_mutex);
+        if (m_inFlight >= m_maxInFlight)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            flush();
+            pthread_mutex_lock(&m_mutex);
+        }
+        while (m_inFlight >= m_maxInFlight)
+        {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+        if (++m_inFlight > m_peakInFlight)
+        {
+            m_peakInFlight = m_inFlight;
+        }
+        pthread_mutex_unlock(&m_mutex);
+        tickets[i].score = &scores[i];
+        tickets[i].remaining = &remaining;
+        submit(algos[i], logname, &tickets[i]);
+    }
+    flush();
+    pthread_mutex_lock(&m_mutex);
+    while (remaining > 0)
+    {
+        pthread_cond_wait(&m_cond, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+Processor::Score AsyncProcessor::process(Algo* a, std::string logname) const
+{
+    Processor::Score score;
+    run(&a, 1, &score, logname);
+    return score;
+}
+
+void AsyncProcessor::processBatch(Algo* const* algos, unsigned int count, Processor::Score* scores) const
+{
+    run(algos, count, scores, "");
+}
@@ -0,0 +1,87 @@
+/*
+ *  AsyncProcessor.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ASYNC_PROCESSOR_HPP
+#define ASYNC_PROCESSOR_HPP
+
+#include "Processor.hpp"
+
+#include <pthread.h>
+
+/**
+ * Base of processors whose evaluations wait on something other than the
+ * CPU, e.g. a simulator or a rig
+ * Subclasses implement submit(), which starts an evaluation and returns,
+ * and call complete() with the ticket once its score is known, from any
+ * thread. processBatch() submits a whole chunk and waits for it, so one
+ * God thread keeps many evaluations outstanding. At most maxInFlight are
+ * outstanding over all threads together; submitting past that blocks
+ * until one completes.
+ */
+class AsyncProcessor : public virtual Processor
+{
+    public:
+        struct Ticket;
+
+        AsyncProcessor(unsigned int maxInFlight);
+        virtual ~AsyncProcessor();
+
+        /**
+         * Submits the algorithm and waits for it
+         */
+        virtual Processor::Score process(Algo* a, std::string logname="") const;
+        virtual void processBatch(Algo* const* algos, unsigned int count, Processor::Score* scores) const;
+
+        unsigned int maxInFlight() const { return m_maxInFlight; }
+
+        /**
+         * Most evaluations outstanding at once so far
+         */
+        unsigned int peakInFlight() const;
+
+    protected:
+        /**
+         * Starts scoring a, the same contract as process() otherwise
+         * Must not wait for the score; complete() may be called before it returns
+         */
+        virtual void submit(Algo* a, const std::string& logname, Ticket* ticket) const = 0;
+
+        /**
+         * Called once the submissions of a batch are in, and before waiting
+         * for room in flight, e.g. to send what submit() held back
+         */
+        virtual void flush() const {}
+
+        /**
+         * Hands back the score of a submitted algorithm, exactly once per ticket
+         */
+        void complete(Ticket* ticket, const Processor::Score& score) const;
+
+    private:
+        AsyncProcessor(const AsyncProcessor& processor);
+        const AsyncProcessor& operator=(const AsyncProcessor& processor);
+        void run(Algo* const* algos, unsigned int count, Processor::Score* scores, const std::string& logname) const;
+
+        const unsigned int m_maxInFlight;
+        mutable unsigned int m_inFlight;
+        mutable unsigned int m_peakInFlight;
+        mutable pthread_mutex_t m_mutex;
+        mutable pthread_cond_t m_cond;
+};
+
+#endif // ASYNC_PROCESSOR_HPP
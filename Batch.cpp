@@ -0,0 +1,422 @@
+/*
+ *  Batch.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CachedProcessor.hpp"
+#include "Config.hpp"
+#include "FitnessDb.hpp"
+#include "God.hpp"
+#include "PID1DProcessor.hpp"
+#include "ThreadPool.hpp"
+#include "Timer.hpp"
+#include "rand.h"
+
+#include <algorithm>
+#include <fstream>
+#include <pthread.h>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * Batch runner
+ * Runs many independent tuning jobs at once, every seed of every job being a
+ * God whose evaluations are tasks on one shared, fair-share ThreadPool, so
+ * jobs never oversubscribe the cores the way separate processes do.
+ *
+ * Usage: genetics-batch [--threads N] [--seeds N] [--jobs N] [--out report.json] jobs.txt
+ * Every line of the job file is "name [--share F] [--key=value ...]" with
+ * the options of genetics (see Config.hpp), '#' starts a comment. Each job
+ * runs once per seed, seeds counting up from its configured seed (1 if
+ * unset). --share weights the job in the pool, --jobs caps how many runs
+ * are in flight. Per-generation logs are only written for jobs that set
+ * logPrefix, as <logPrefix><seed>-<generation>.log; metrics and trace
+ * settings are ignored, and settings only genetics implements, see
+ * validateJobConfig(), are rejected. Jobs that set fitnessDb share its scores with every
+ * other run using the same file, in this batch or not.
+ * Prints every run and the best/median across seeds of every job, and
+ * writes them all as JSON with --out
+ **/
+
+struct BatchJob
+{
+    std::string name;
+    RunConfig config;
+    double share;
+};
+
+struct BatchRun
+{
+    unsigned int job;
+    unsigned long seed;
+    bool success;
+    double score;
+    std::string summary;
+    unsigned long long evaluations;
+    double wallTime;
+};
+
+struct BatchState
+{
+    ThreadPool* pool;
+    const std::vector<BatchJob>* jobs;
+    std::vector<BatchRun>* runs;
+    unsigned int next;
+    unsigned int done;
+};
+
+/**
+ * Counts the evaluations of a run
+ */
+class EvaluationSink : public virtual MetricsSink
+{
+    public:
+        EvaluationSink()
+            : evaluations(0)
+        {
+        }
+
+        virtual void record(const GenerationStats& stats)
+        {
+            evaluations += stats.populationSize;
+        }
+
+        unsigned long long evaluations;
+};
+
+static void runJob(ThreadPool* pool, const BatchJob& job, BatchRun& run)
+{
+    const RunConfig& config = job.config;
+    double start = monotonicTime();
+    init_thread_rng(run.seed);
+    PID1DProcessor* processor = createProcessor(config);
+    std::vector<Algo*> seeds = createSeeds(config);
+    EvaluationSink evaluations;
+    FitnessDb db;
+    Processor* evaluator = processor;
+    std::string error;
+    if (config.fitnessDb.size() && !db.open(config.fitnessDb, config.fitnessDbSize * 1048576ULL, error))
+    {
+        fprintf(stderr, "%s: running without fitness database, %s\n", job.name.c_str(), error.c_str());
+    }
+    CachedProcessor cached(*processor, db, plantHash(config), config.fitnessDbBits);
+    if (db.isOpen())
+    {
+        evaluator = &cached;
+    }
+
+    God god(*evaluator, seeds, config.populationSize, config.successorSize, config.initialChunkSize, config.maxNumThreads, config.numCycles);
+    std::stringstream prefix;
+    prefix << config.logPrefix << run.seed << "-";
+    god.setLogPrefix(prefix.str(), config.logging && config.logPrefix.size());
+    god.setPerfCounters(config.perf);
+    god.setStreaming(config.streaming);
+    god.setRacing(config.racing, config.racingDelta);
+    god.setThreadPool(pool, job.share);
+    god.addSink(&evaluations);
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+
+    run.success = best.score.success;
+    run.score = best.score.score;
+    run.summary = best.algo->getSummary();
+    run.evaluations = evaluations.evaluations;
+    run.wallTime = monotonicTime() - start;
+    delete best.algo;
+    delete processor;
+    free_thread_rng();
+}
+
+static void* driver(void* param)
+{
+    BatchState* state = static_cast<BatchState*>(param);
+    while (true)
+    {
+        unsigned int i = __sync_fetch_and_add(&state->next, 1);
+        if (i >= state->runs->size())
+        {
+            break;
+        }
+        BatchRun& run = (*state->runs)[i];
+        const BatchJob& job = (*state->jobs)[run.job];
+        runJob(state->pool, job, run);
+        unsigned int done = __sync_add_and_fetch(&state->done, 1);
+        fprintf(stderr, "[%u/%u] %s seed %lu: %s%f in %.2fs\n", done, (unsigned int) state->runs->size(), job.name.c_str(), run.seed, run.success ? "" : "(failed) ", run.score, run.wallTime);
+    }
+    return 0;
+}
+
+static bool better(const BatchRun& l, const BatchRun& r)
+{
+    if (l.success != r.success)
+    {
+        return l.success;
+    }
+    return l.score < r.score;
+}
+
+static double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    unsigned int n = v.size();
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+static std::string jsonString(const std::string& s)
+{
+    std::string out = "\"";
+    for(unsigned int i = 0; i < s.size(); i++)
+    {
+        char c = s[i];
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n')
+        {
+            out += "\\n";
+        }
+        else if (c == '\t')
+        {
+            out += "\\t";
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+/**
+ * @return false with the error on the first bad line
+ */
+static bool readJobs(const char* filename, std::vector<BatchJob>& jobs, std::string& error)
+{
+    std::ifstream in(filename);
+    if (!in)
+    {
+        error = std::string("cannot read ") + filename;
+        return false;
+    }
+    std::string line;
+    unsigned int lineNum = 0;
+    while (std::getline(in, line))
+    {
+        lineNum++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::vector<std::string> args;
+        std::string token;
+        while (tokens >> token)
+        {
+            args.push_back(token);
+        }
+        if (args.empty())
+        {
+            continue;
+        }
+
+        BatchJob job;
+        job.name = args[0];
+        job.share = 1.0;
+        std::vector<char*> argv;
+        for(unsigned int i = 0; i < args.size(); i++)
+        {
+            if (args[i] == "--share" && i + 1 < args.size())
+            {
+                job.share = atof(args[++i].c_str());
+            }
+            else if (args[i].compare(0, 8, "--share=") == 0)
+            {
+                job.share = atof(args[i].c_str() + 8);
+            }
+            else
+            {
+                argv.push_back(&args[i][0]);
+            }
+        }
+        std::stringstream where;
+        where << filename << ":" << lineNum << ": " << job.name << ": ";
+        if (!(job.share > 0.0))
+        {
+            error = where.str() + "share must be positive";
+            return false;
+        }
+        if (!parseConfigArgs(job.config, argv.size(), &argv[0], error) || !validateConfig(job.config, error) || !validateJobConfig(job.config, error))
+        {
+            error = where.str() + (error.size() ? error : "--help is not a job option");
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    if (jobs.empty())
+    {
+        error = std::string("no jobs in ") + filename;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int numThreads = 0;
+    unsigned int numSeeds = 1;
+    unsigned int numDrivers = 0;
+    const char* out = NULL;
+    const char* jobFile = NULL;
+    for(int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+        {
+            numThreads = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--seeds") && i + 1 < argc)
+        {
+            numSeeds = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--jobs") && i + 1 < argc)
+        {
+            numDrivers = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+        {
+            out = argv[++i];
+        }
+        else if (argv[i][0] != '-' && !jobFile)
+        {
+            jobFile = argv[i];
+        }
+        else
+        {
+            jobFile = NULL;
+            break;
+        }
+    }
+    if (!jobFile || numSeeds == 0)
+    {
+        fprintf(stderr, "Usage: %s [--threads N] [--seeds N] [--jobs N] [--out report.json] jobs.txt\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<BatchJob> jobs;
+    std::string error;
+    if (!readJobs(jobFile, jobs, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::vector<BatchRun> runs;
+    for(unsigned int j = 0; j < jobs.size(); j++)
+    {
+        unsigned long firstSeed = jobs[j].config.seed ? jobs[j].config.seed : 1;
+        for(unsigned int s = 0; s < numSeeds; s++)
+        {
+            BatchRun run;
+            run.job = j;
+            run.seed = firstSeed + s;
+            run.success = false;
+            run.score = 0.0;
+            run.evaluations = 0;
+            run.wallTime = 0.0;
+            runs.push_back(run);
+        }
+    }
+
+    init_rng();
+    double start = monotonicTime();
+    {
+        ThreadPool pool(numThreads);
+        if (numDrivers == 0)
+        {
+            // Two runs per worker keep the pool busy while others breed and select
+            numDrivers = 2 * pool.numThreads();
+        }
+        numDrivers = std::min(numDrivers, (unsigned int) runs.size());
+        BatchState state = {&pool, &jobs, &runs, 0, 0};
+        std::vector<pthread_t> drivers(numDrivers);
+        for(unsigned int i = 0; i < numDrivers; i++)
+        {
+            pthread_create(&drivers[i], NULL, driver, &state);
+        }
+        for(unsigned int i = 0; i < numDrivers; i++)
+        {
+            pthread_join(drivers[i], NULL);
+        }
+        fprintf(stderr, "%u runs on %u threads in %.2fs\n", (unsigned int) runs.size(), pool.numThreads(), monotonicTime() - start);
+    }
+    free_rng();
+
+    printf("%-20s %8s %8s %12s %12s %12s %10s\n", "job", "runs", "success", "best", "median", "worst", "median s");
+    FILE* f = NULL;
+    if (out)
+    {
+        f = fopen(out, "w");
+        if (!f)
+        {
+            perror(out);
+            return 1;
+        }
+        fprintf(f, "{\"seeds\":%u,\"jobs\":[\n", numSeeds);
+    }
+    for(unsigned int j = 0; j < jobs.size(); j++)
+    {
+        std::vector<const BatchRun*> jobRuns;
+        std::vector<double> scores, wallTimes;
+        unsigned int successes = 0;
+        const BatchRun* best = NULL;
+        const BatchRun* worst = NULL;
+        for(unsigned int i = 0; i < runs.size(); i++)
+        {
+            const BatchRun& r = runs[i];
+            if (r.job != j)
+            {
+                continue;
+            }
+            jobRuns.push_back(&r);
+            scores.push_back(r.score);
+            wallTimes.push_back(r.wallTime);
+            successes += r.success;
+            best = !best || better(r, *best) ? &r : best;
+            worst = !worst || better(*worst, r) ? &r : worst;
+        }
+        printf("%-20s %8u %8u %12.6f %12.6f %12.6f %10.2f\n", jobs[j].name.c_str(), (unsigned int) jobRuns.size(), successes, best->score, median(scores), worst->score, median(wallTimes));
+        if (!f)
+        {
+            continue;
+        }
+        fprintf(f, "%s{\"name\":%s,\"share\":%g,\"successes\":%u,\"bestSeed\":%lu,\"bestSuccess\":%s,\"bestScore\":%.17g,\"bestSummary\":%s,", j ? ",\n" : "", jsonString(jobs[j].name).c_str(), jobs[j].share, successes, best->seed, best->success ? "true" : "false", best->score, jsonString(best->summary).c_str());
+        fprintf(f, "\"medianScore\":%.17g,\"worstScore\":%.17g,\"medianWallTime\":%.9f,\"config\":%s,\"runs\":[", median(scores), worst->score, median(wallTimes), jsonString(configToString(jobs[j].config)).c_str());
+        for(unsigned int i = 0; i < jobRuns.size(); i++)
+        {
+            const BatchRun& r = *jobRuns[i];
+            fprintf(f, "%s{\"seed\":%lu,\"success\":%s,\"score\":%.17g,\"evaluations\":%llu,\"wallTime\":%.9f,\"summary\":%s}", i ? "," : "", r.seed, r.success ? "true" : "false", r.score, r.evaluations, r.wallTime, jsonString(r.summary).c_str());
+        }
+        fprintf(f, "]}");
+    }
+    if (f)
+    {
+        fprintf(f, "\n]}\n");
+        fclose(f);
+        printf("Wrote %s\n", out);
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ *  CachedProcessor.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CachedProcessor.hpp"
+
+#include "Algo.hpp"
+#include "FitnessDb.hpp"
+
+#include <vector>
+
+CachedProcessor::CachedProcessor(const Processor& processor, FitnessDb& db, unsigned long long configHash, unsigned int geneBits)
+    : m_processor(processor)
+    , m_db(db)
+    , m_configHash(configHash)
+    , m_geneBits(geneBits)
+{
+}
+
+Processor::Score CachedProcessor::process(Algo* a, std::string logname) const
+{
+    if (logname.size())
+    {
+        return m_processor.process(a, logname);
+    }
+    FitnessDb::Key key = FitnessDb::makeKey(m_configHash, a->getGenes(), m_geneBits);
+    Processor::Score score;
+    if (!m_db.lookup(key, score))
+    {
+        score = m_processor.process(a);
+        m_db.insert(key, score);
+    }
+    return score;
+}
+
+void CachedProcessor::processBatch(Algo* const* algos, unsigned int count, Processor::Score* scores) const
+{
+    std::vector<FitnessDb::Key> keys(count);
+    std::vector<unsigned int> misses;
+    std::vector<Algo*> missAlgos;
+    for(unsigned int i = 0; i < count; i++)
+    {
+        keys[i] = FitnessDb::makeKey(m_configHash, algos[i]->getGenes(), m_geneBits);
+        if (!m_db.lookup(keys[i], scores[i]))
+        {
+            misses.push_back(i);
+            missAlgos.push_back(algos[i]);
+        }
+    }
+    if (misses.empty())
+    {
+        return;
+    }
+    std::vector<Processor::Score> missScores(misses.size());
+    m_processor.processBatch(&missAlgos[0], misses.size(), &missScores[0]);
+    for(unsigned int i = 0; i < misses.size(); i++)
+    {
+        scores[misses[i]] = missScores[i];
+        m_db.insert(keys[misses[i]], missScores[i]);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ *  CachedProcessor.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CACHED_PROCESSOR_HPP
+#define CACHED_PROCESSOR_HPP
+
+#include "Processor.hpp"
+
+class FitnessDb;
+
+/**
+ * Looks algorithms up in a FitnessDb before handing them to another
+ * processor, and stores what that processor scores
+ * Logged runs always go to the processor, the log is the point of them.
+ * Neither the processor nor the database is owned
+ */
+class CachedProcessor : public virtual Processor
+{
+    public:
+        /**
+         * @param configHash identifies the processor's settings, e.g. plantHash()
+         * @param geneBits mantissa bits of each gene that must match, see FitnessDb::makeKey()
+         */
+        CachedProcessor(const Processor& processor, FitnessDb& db, unsigned long long configHash, unsigned int geneBits);
+        virtual Processor::Score process(Algo* a, std::string logname="") const;
+
+        /**
+         * Passes only the misses on, as one batch
+         */
+        virtual void processBatch(Algo* const* algos, unsigned int count, Processor::Score* scores) const;
+    private:
+        const Processor& m_processor;
+        FitnessDb& m_db;
+        const unsigned long long m_configHash;
+        const unsigned int m_geneBits;
+};
+
+#endif // CACHED_PROCESSOR_HPP
@@ -0,0 +1,185 @@
+/*
+ *  Client.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Config.hpp"
+#include "Protocol.hpp"
+
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Command line client of geneticsd
+ * Submits one job and prints its progress until the result arrives, or
+ * lists the daemon's jobs with --status. Job options are those of genetics
+ * and are validated before submitting.
+ *
+ * Usage: genetics-client [--socket path] [--priority N] [--name S] [--config file] [--key=value ...]
+ *        genetics-client [--socket path] --status
+ * Exits with 0 once the result is printed, 1 on any error
+ **/
+
+static int connectTo(const char* path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*) &addr, sizeof(addr)) < 0)
+    {
+        perror(path);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static void printProgress(const std::string& line)
+{
+    unsigned int generation, numGenerations;
+    int success;
+    double best, mu, sigma, rate, seconds;
+    if (sscanf(line.c_str(), "PROGRESS %u %u %d %lf %lf %lf %lf %lf", &generation, &numGenerations, &success, &best, &mu, &sigma, &rate, &seconds) == 8)
+    {
+        printf("Generation %u/%u best: %s%f mean: %f std: %f %.0f evals/s %.3fs\n", generation, numGenerations, success ? "" : "(failed) ", best, mu, sigma, rate, seconds);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* socketPath = defaultSocketPath;
+    int priority = 0;
+    std::string name = "job";
+    bool listJobs = false;
+    std::vector<char*> configArgs;
+    configArgs.push_back(argv[0]);
+    bool usage = false;
+    for(int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--socket") && i + 1 < argc)
+        {
+            socketPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--priority") && i + 1 < argc)
+        {
+            priority = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--name") && i + 1 < argc)
+        {
+            name = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--status"))
+        {
+            listJobs = true;
+        }
+        else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
+        {
+            usage = true;
+        }
+        else
+        {
+            configArgs.push_back(argv[i]);
+        }
+    }
+    if (usage || name.empty() || name.find_first_of(" \t\n") != std::string::npos)
+    {
+        fprintf(stderr, "Usage: %s [--socket path] [--priority N] [--name S] [--config file] [--key=value ...]\n", argv[0]);
+        fprintf(stderr, "       %s [--socket path] --status\n%s", argv[0], configUsage().c_str());
+        return 1;
+    }
+
+    if (listJobs)
+    {
+        int fd = connectTo(socketPath);
+        if (fd < 0 || !writeLine(fd, "STATUS"))
+        {
+            return 1;
+        }
+        LineReader reader(fd);
+        std::string line;
+        while (reader.readLine(line) && line != "END")
+        {
+            printf("%s\n", line.c_str() + (line.compare(0, 4, "JOB ") ? 0 : 4));
+        }
+        close(fd);
+        return 0;
+    }
+
+    RunConfig config;
+    std::string error;
+    if (!parseConfigArgs(config, configArgs.size(), &configArgs[0], error) || !validateConfig(config, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    int fd = connectTo(socketPath);
+    if (fd < 0)
+    {
+        return 1;
+    }
+    std::stringstream request;
+    request << "SUBMIT " << priority << " " << name << "\n" << configToString(config) << "END";
+    if (!writeLine(fd, request.str()))
+    {
+        fprintf(stderr, "Daemon closed the connection\n");
+        return 1;
+    }
+
+    LineReader reader(fd);
+    std::string line;
+    while (reader.readLine(line))
+    {
+        if (line.compare(0, 9, "PROGRESS ") == 0)
+        {
+            printProgress(line);
+        }
+        else if (line.compare(0, 6, "ERROR ") == 0)
+        {
+            fprintf(stderr, "%s\n", line.c_str() + 6);
+            return 1;
+        }
+        else if (line.compare(0, 7, "RESULT ") == 0)
+        {
+            int success;
+            double score;
+            int n = 0;
+            sscanf(line.c_str(), "RESULT %d %lf %n", &success, &score, &n);
+            printf("Success: %d Score: %f\n", success, score);
+            printf("%s\n", line.c_str() + n);
+            close(fd);
+            return 0;
+        }
+        else
+        {
+            printf("%s\n", line.c_str());
+        }
+    }
+    fprintf(stderr, "Daemon closed the connection before the result\n");
+    return 1;
+}
@@ -0,0 +1,742 @@
+/*
+ *  Config.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Config.hpp"
+
+#include "FitnessDb.hpp"
+#include "PDParam.hpp"
+#include "PID1DProcessor.hpp"
+#include "PIDAlgo.hpp"
+
+#include <errno.h>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+RunConfig::RunConfig()
+    : timeout(5.00)
+    , timein(1.00)
+    , threshold(0.01)
+    , maxVoltage(12.00)
+    , minVoltage(-12.00)
+    , goal(1.00)
+    , mass(1.000)
+    , motorStallTorque(10.00)
+    , motorFreeSpeed(10.00)
+    , gearingRatio(1.00)
+    , wheelDiameter(0.03)
+    , staticFriction(0.50)
+    , kineticFriction(0.10)
+    , sensorNoise(0.0)
+    , actuatorNoise(0.0)
+    , loadDisturbance(0.0)
+    , noiseSamples(1)
+    , noiseSeed(1)
+    , seedKP(0.00)
+    , seedKI(0.00)
+    , seedKD(0.00)
+    , mutationKP(1.00)
+    , mutationKI(0.00)
+    , mutationKD(0.01)
+    , populationSize(4000)
+    , successorSize(10)
+    , numCycles(100)
+    , initialChunkSize(100)
+    , maxNumThreads(0)
+    , seed(0)
+    , streaming(false)
+    , racing(false)
+    , racingDelta(0.05)
+    , online(false)
+    , fitnessDbSize(64)
+    , fitnessDbBits(40)
+    , farmWorkers(0)
+    , farmWorkerThreads(1)
+    , farmBatchSize(16)
+    , farmPipeline(4)
+    , farmTimeout(10.0)
+    , farmAttempts(2)
+    , isolate(0)
+    , isolateTimeout(0.0)
+    , isolateAttempts(2)
+    , isolateRecycle(0)
+    , plantLatency(0.0)
+    , asyncInFlight(64)
+    , simulatorProcesses(2)
+    , simulatorBatchSize(16)
+    , simulatorPipeline(2)
+    , simulatorTimeout(1.0)
+    , simulatorAttempts(2)
+    , perf(false)
+    , logging(true)
+{
+}
+
+enum FieldType
+{
+    doubleField,
+    uintField,
+    ulongField,
+    boolField,
+    stringField
+};
+
+struct ConfigField
+{
+    const char* name;
+    FieldType type;
+    void* value;
+    const char* help;
+};
+
+static void addField(std::vector<ConfigField>& fields, const char* name, double* value, const char* help)
+{
+    ConfigField f = {name, doubleField, value, help};
+    fields.push_back(f);
+}
+
+static void addField(std::vector<ConfigField>& fields, const char* name, unsigned int* value, const char* help)
+{
+    ConfigField f = {name, uintField, value, help};
+    fields.push_back(f);
+}
+
+static void addField(std::vector<ConfigField>& fields, const char* name, unsigned long* value, const char* help)
+{
+    ConfigField f = {name, ulongField, value, help};
+    fields.push_back(f);
+}
+
+static void addField(std::vector<ConfigField>& fields, const char* name, bool* value, const char* help)
+{
+    ConfigField f = {name, boolField, value, help};
+    fields.push_back(f);
+}
+
+static void addField(std::vector<ConfigField>& fields, const char* name, std::string* value, const char* help)
+{
+    ConfigField f = {name, stringField, value, help};
+    fields.push_back(f);
+}
+
+static std::vector<ConfigField> configFields(RunConfig& c)
+{
+    std::vector<ConfigField> f;
+    addField(f, "timeout", &c.timeout, "simulated seconds before giving up");
+    addField(f, "timein", &c.timein, "seconds within threshold of the goal to count as settled");
+    addField(f, "threshold", &c.threshold, "distance from the goal that counts as arrived (m)");
+    addField(f, "maxVoltage", &c.maxVoltage, "highest motor voltage (V)");
+    addField(f, "minVoltage", &c.minVoltage, "lowest motor voltage (V)");
+    addField(f, "goal", &c.goal, "distance to travel (m)");
+    addField(f, "mass", &c.mass, "robot mass (kg)");
+    addField(f, "motorStallTorque", &c.motorStallTorque, "motor stall torque (N m)");
+    addField(f, "motorFreeSpeed", &c.motorFreeSpeed, "motor free speed (rev/s)");
+    addField(f, "gearingRatio", &c.gearingRatio, "motor revolutions per wheel revolution");
+    addField(f, "wheelDiameter", &c.wheelDiameter, "wheel diameter (m)");
+    addField(f, "staticFriction", &c.staticFriction, "static friction coefficient");
+    addField(f, "kineticFriction", &c.kineticFriction, "kinetic friction coefficient");
+    addField(f, "sensorNoise", &c.sensorNoise, "standard deviation of the measured position (m), 0 for none");
+    addField(f, "actuatorNoise", &c.actuatorNoise, "standard deviation added to the motor voltage (V), 0 for none");
+    addField(f, "loadDisturbance", &c.loadDisturbance, "standard deviation of a load stepping in at a random time, as a fraction of stall torque, 0 for none");
+    addField(f, "noiseSamples", &c.noiseSamples, "noise draws averaged by each evaluation");
+    addField(f, "noiseSeed", &c.noiseSeed, "seed of the noise, which every algorithm of a generation shares");
+    addField(f, "trajectories", &c.trajectories, "file of setpoint profiles to track instead of the step to goal, made by genetics-profiles");
+    addField(f, "seedKP", &c.seedKP, "initial proportional gain");
+    addField(f, "seedKI", &c.seedKI, "initial integral gain");
+    addField(f, "seedKD", &c.seedKD, "initial derivative gain");
+    addField(f, "mutationKP", &c.mutationKP, "kP mutation sigma as a fraction of kP, 0 to freeze");
+    addField(f, "mutationKI", &c.mutationKI, "kI mutation sigma as a fraction of kI, 0 to freeze");
+    addField(f, "mutationKD", &c.mutationKD, "kD mutation sigma as a fraction of kD, 0 to freeze");
+    addField(f, "populationSize", &c.populationSize, "algorithms evaluated per generation");
+    addField(f, "successorSize", &c.successorSize, "best algorithms bred into the next generation");
+    addField(f, "numCycles", &c.numCycles, "generations to run");
+    addField(f, "initialChunkSize", &c.initialChunkSize, "evaluations per work chunk before tuning");
+    addField(f, "threads", &c.maxNumThreads, "most worker threads, 0 for one per processor");
+    addField(f, "seed", &c.seed, "random seed, 0 to seed from the clock");
+    addField(f, "streaming", &c.streaming, "breed each generation while evaluating it instead of keeping it in memory");
+    addField(f, "objectives", &c.objectives, "objectives for an NSGA-II Pareto front, from error, rise, settling, overshoot, peakVoltage, effort and energy; the score alone if empty");
+    addField(f, "racing", &c.racing, "race each generation over the noise samples, dropping algorithms once they are clearly behind");
+    addField(f, "racingDelta", &c.racingDelta, "chance that a racing comparison of two algorithms is wrong");
+    addField(f, "warmStart", &c.warmStart, "population file to start from instead of the seed gains");
+    addField(f, "saveSuccessors", &c.saveSuccessors, "population file the final successors are written to");
+    addField(f, "online", &c.online, "keep evolving, reloading the plant whenever the --config file changes");
+    addField(f, "fitnessDb", &c.fitnessDb, "file of scores reused across runs, none if empty");
+    addField(f, "fitnessDbSize", &c.fitnessDbSize, "size of a new fitnessDb file (MiB)");
+    addField(f, "fitnessDbBits", &c.fitnessDbBits, "mantissa bits of each gene that must match a stored score, 52 for exact");
+    addField(f, "farm", &c.farm, "[host:]port genetics-worker processes connect to, evaluate locally if empty");
+    addField(f, "farmWorkers", &c.farmWorkers, "local workers to start for the farm");
+    addField(f, "farmWorkerThreads", &c.farmWorkerThreads, "threads of each local worker");
+    addField(f, "farmBatchSize", &c.farmBatchSize, "algorithms sent to a worker at once");
+    addField(f, "farmPipeline", &c.farmPipeline, "batches in flight per worker");
+    addField(f, "farmTimeout", &c.farmTimeout, "seconds a silent worker keeps its batches");
+    addField(f, "farmAttempts", &c.farmAttempts, "workers a genome may be lost with before it counts as failed");
+    addField(f, "isolate", &c.isolate, "worker processes evaluating out of harm's way, 0 to evaluate in threads");
+    addField(f, "isolateTimeout", &c.isolateTimeout, "seconds before an isolated evaluation is killed, 0 for no limit");
+    addField(f, "isolateAttempts", &c.isolateAttempts, "evaluations of an algorithm whose worker dies before it counts as failed");
+    addField(f, "isolateRecycle", &c.isolateRecycle, "evaluations before a worker process is replaced, 0 for never");
+    addField(f, "plantLatency", &c.plantLatency, "seconds the plant takes to answer, as a rig or remote simulator would, 0 for none");
+    addField(f, "asyncInFlight", &c.asyncInFlight, "most evaluations waiting on the plant at once");
+    addField(f, "simulator", &c.simulator, "command of an external plant simulator, the built-in model if empty");
+    addField(f, "simulatorProcesses", &c.simulatorProcesses, "simulator processes to run");
+    addField(f, "simulatorBatchSize", &c.simulatorBatchSize, "algorithms sent to a simulator at once");
+    addField(f, "simulatorPipeline", &c.simulatorPipeline, "batches in flight per simulator");
+    addField(f, "simulatorTimeout", &c.simulatorTimeout, "seconds per algorithm before a simulator is restarted");
+    addField(f, "simulatorAttempts", &c.simulatorAttempts, "evaluations of an algorithm whose simulator fails before it counts as failed");
+    addField(f, "metrics", &c.metrics, "metrics file, format from extension .jsonl, .csv or .bin");
+    addField(f, "trace", &c.trace, "Chrome trace-event file of worker activity");
+    addField(f, "perf", &c.perf, "collect hardware performance counters");
+    addField(f, "logging", &c.logging, "log the best algorithm of every generation");
+    addField(f, "logPrefix", &c.logPrefix, "prefix of the per-generation logs");
+    return f;
+}
+
+static std::string trim(const std::string& s)
+{
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos)
+    {
+        return "";
+    }
+    size_t stop = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, stop - start + 1);
+}
+
+bool setConfigValue(RunConfig& config, const std::string& key, const std::string& value, std::string& error)
+{
+    std::vector<ConfigField> fields = configFields(config);
+    for(unsigned int i = 0; i < fields.size(); i++)
+    {
+        const ConfigField& f = fields[i];
+        if (key != f.name)
+        {
+            continue;
+        }
+        const char* s = value.c_str();
+        char* end = NULL;
+        errno = 0;
+        switch (f.type)
+        {
+            case doubleField:
+                *static_cast<double*>(f.value) = strtod(s, &end);
+                break;
+            case uintField:
+            case ulongField:
+            {
+                if (value.size() && value[0] == '-')
+                {
+                    error = key + ": expected a non-negative integer, got '" + value + "'";
+                    return false;
+                }
+                unsigned long v = strtoul(s, &end, 10);
+                if (f.type == uintField)
+                {
+                    if (v > 0xffffffffUL)
+                    {
+                        errno = ERANGE;
+                    }
+                    *static_cast<unsigned int*>(f.value) = v;
+                }
+                else
+                {
+                    *static_cast<unsigned long*>(f.value) = v;
+                }
+                break;
+            }
+            case boolField:
+            {
+                bool* b = static_cast<bool*>(f.value);
+                if (value == "1" || value == "true" || value == "yes" || value == "on")
+                {
+                    *b = true;
+                }
+                else if (value == "0" || value == "false" || value == "no" || value == "off")
+                {
+                    *b = false;
+                }
+                else
+                {
+                    error = key + ": expected true or false, got '" + value + "'";
+                    return false;
+                }
+                return true;
+            }
+            case stringField:
+                *static_cast<std::string*>(f.value) = value;
+                return true;
+        }
+        if (value.empty() || end == s || *end != '\0' || errno == ERANGE)
+        {
+            error = key + ": invalid number '" + value + "'";
+            return false;
+        }
+        return true;
+    }
+    error = "unknown setting '" + key + "'";
+    return false;
+}
+
+bool loadConfigString(RunConfig& config, const std::string& text, std::string& error)
+{
+    std::istringstream in(text);
+    std::string line;
+    unsigned int lineNum = 0;
+    while (std::getline(in, line))
+    {
+        lineNum++;
+        size_t comment = line.find_first_of("#;");
+        if (comment != std::string::npos)
+        {
+            line = line.substr(0, comment);
+        }
+        line = trim(line);
+        if (line.empty() || (line[0] == '[' && line[line.size() - 1] == ']'))
+        {
+            continue;
+        }
+        size_t eq = line.find('=');
+        std::stringstream ss;
+        ss << "line " << lineNum << ": ";
+        if (eq == std::string::npos)
+        {
+            error = ss.str() + "expected key = value";
+            return false;
+        }
+        if (!setConfigValue(config, trim(line.substr(0, eq)), trim(line.substr(eq + 1)), error))
+        {
+            error = ss.str() + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadConfigFile(RunConfig& config, const std::string& filename, std::string& error)
+{
+    std::ifstream in(filename.c_str());
+    if (!in)
+    {
+        error = "cannot read " + filename;
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    if (!loadConfigString(config, ss.str(), error))
+    {
+        error = filename + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool parseConfigArgs(RunConfig& config, int argc, char** argv, std::string& error)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            error = "";
+            return false;
+        }
+        if (arg.compare(0, 2, "--") != 0)
+        {
+            error = "unexpected argument '" + arg + "'";
+            return false;
+        }
+        arg = arg.substr(2);
+        std::string key, value;
+        size_t eq = arg.find('=');
+        if (eq != std::string::npos)
+        {
+            key = arg.substr(0, eq);
+            value = arg.substr(eq + 1);
+        }
+        else if (i + 1 < argc)
+        {
+            key = arg;
+            value = argv[++i];
+        }
+        else
+        {
+            error = "missing value for --" + arg;
+            return false;
+        }
+        if (key == "config")
+        {
+            if (!loadConfigFile(config, value, error))
+            {
+                return false;
+            }
+            config.configFile = value;
+        }
+        else if (!setConfigValue(config, key, value, error))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool validateConfig(const RunConfig& c, std::string& error)
+{
+    std::stringstream ss;
+    if (!(c.timeout > 0))
+    {
+        ss << "timeout must be positive; ";
+    }
+    if (!(c.timein >= 0))
+    {
+        ss << "timein must not be negative; ";
+    }
+    if (!(c.threshold > 0))
+    {
+        ss << "threshold must be positive; ";
+    }
+    if (!(c.maxVoltage > c.minVoltage))
+    {
+        ss << "maxVoltage must exceed minVoltage; ";
+    }
+    if (!(c.mass > 0))
+    {
+        ss << "mass must be positive; ";
+    }
+    if (!(c.motorStallTorque > 0))
+    {
+        ss << "motorStallTorque must be positive; ";
+    }
+    if (!(c.motorFreeSpeed > 0))
+    {
+        ss << "motorFreeSpeed must be positive; ";
+    }
+    if (!(c.gearingRatio > 0))
+    {
+        ss << "gearingRatio must be positive; ";
+    }
+    if (!(c.wheelDiameter > 0))
+    {
+        ss << "wheelDiameter must be positive; ";
+    }
+    if (!(c.staticFriction >= 0) || !(c.kineticFriction >= 0))
+    {
+        ss << "friction coefficients must not be negative; ";
+    }
+    if (!(c.sensorNoise >= 0) || !(c.actuatorNoise >= 0) || !(c.loadDisturbance >= 0))
+    {
+        ss << "noise levels must not be negative; ";
+    }
+    if (c.noiseSamples == 0)
+    {
+        ss << "noiseSamples must be positive; ";
+    }
+    if ((c.sensorNoise > 0 || c.actuatorNoise > 0 || c.loadDisturbance > 0) && (c.fitnessDb.size() || c.farm.size() || c.isolate || c.simulator.size()))
+    {
+        ss << "plant noise cannot be combined with fitnessDb, farm, isolate or simulator; ";
+    }
+    if (c.trajectories.size() && (c.sensorNoise > 0 || c.actuatorNoise > 0 || c.loadDisturbance > 0 || c.objectives.size() || c.fitnessDb.size() || c.farm.size() || c.isolate || c.simulator.size()))
+    {
+        ss << "trajectories cannot be combined with plant noise, objectives, fitnessDb, farm, isolate or simulator; ";
+    }
+    if (!(c.mutationKP >= 0) || !(c.mutationKI >= 0) || !(c.mutationKD >= 0))
+    {
+        ss << "mutation scales must not be negative; ";
+    }
+    if (c.populationSize == 0)
+    {
+        ss << "populationSize must be positive; ";
+    }
+    if (c.successorSize == 0 || c.successorSize > c.populationSize)
+    {
+        ss << "successorSize must be between 1 and populationSize; ";
+    }
+    if (c.numCycles == 0)
+    {
+        ss << "numCycles must be positive; ";
+    }
+    if (c.initialChunkSize == 0)
+    {
+        ss << "initialChunkSize must be positive; ";
+    }
+    std::vector<PID1DProcessor::Objective> objectives;
+    std::string objectivesError;
+    if (!PID1DProcessor::parseObjectives(c.objectives, objectives, objectivesError))
+    {
+        ss << objectivesError << "; ";
+    }
+    if (c.objectives.size() && (c.streaming || c.fitnessDb.size() || c.farm.size() || c.isolate || c.plantLatency > 0 || c.simulator.size()))
+    {
+        ss << "objectives cannot be combined with streaming, fitnessDb, farm, isolate, plantLatency or simulator; ";
+    }
+    if (!(c.racingDelta > 0 && c.racingDelta < 1))
+    {
+        ss << "racingDelta must be between 0 and 1; ";
+    }
+    if (c.racing && ((c.noiseSamples < 2 && c.trajectories.empty()) || c.streaming || c.objectives.size() || c.fitnessDb.size() || c.farm.size() || c.isolate || c.plantLatency > 0 || c.simulator.size()))
+    {
+        ss << "racing needs noiseSamples above 1 or trajectories and cannot be combined with streaming, objectives, fitnessDb, farm, isolate, plantLatency or simulator; ";
+    }
+    if (c.fitnessDbSize == 0)
+    {
+        ss << "fitnessDbSize must be positive; ";
+    }
+    if (c.fitnessDbBits == 0 || c.fitnessDbBits > 52)
+    {
+        ss << "fitnessDbBits must be between 1 and 52; ";
+    }
+    if (c.farmWorkerThreads == 0 || c.farmBatchSize == 0 || c.farmPipeline == 0)
+    {
+        ss << "farmWorkerThreads, farmBatchSize and farmPipeline must be positive; ";
+    }
+    if (!(c.farmTimeout > 0))
+    {
+        ss << "farmTimeout must be positive; ";
+    }
+    if (c.farmAttempts == 0)
+    {
+        ss << "farmAttempts must be positive; ";
+    }
+    if (c.isolate && c.farm.size())
+    {
+        ss << "isolate and farm cannot be combined; ";
+    }
+    if (!(c.isolateTimeout >= 0))
+    {
+        ss << "isolateTimeout must not be negative; ";
+    }
+    if (c.isolateAttempts == 0)
+    {
+        ss << "isolateAttempts must be positive; ";
+    }
+    if (!(c.plantLatency >= 0))
+    {
+        ss << "plantLatency must not be negative; ";
+    }
+    if (c.plantLatency > 0 && (c.farm.size() || c.isolate))
+    {
+        ss << "plantLatency cannot be combined with farm or isolate; ";
+    }
+    if (c.asyncInFlight == 0)
+    {
+        ss << "asyncInFlight must be positive; ";
+    }
+    if (c.simulator.size() && (c.farm.size() || c.isolate || c.plantLatency > 0))
+    {
+        ss << "simulator cannot be combined with farm, isolate or plantLatency; ";
+    }
+    if (c.simulator.size() && c.online)
+    {
+        ss << "simulator cannot be combined with online, the simulator owns its plant; ";
+    }
+    if (c.simulatorProcesses == 0)
+    {
+        ss << "simulatorProcesses must be positive; ";
+    }
+    if (c.simulatorBatchSize == 0)
+    {
+        ss << "simulatorBatchSize must be positive; ";
+    }
+    if (c.simulatorPipeline == 0)
+    {
+        ss << "simulatorPipeline must be positive; ";
+    }
+    if (!(c.simulatorTimeout > 0))
+    {
+        ss << "simulatorTimeout must be positive; ";
+    }
+    if (c.simulatorAttempts == 0)
+    {
+        ss << "simulatorAttempts must be positive; ";
+    }
+    error = ss.str();
+    if (error.size())
+    {
+        error = error.substr(0, error.size() - 2);
+        return false;
+    }
+    return true;
+}
+
+std::string executableSettings(const RunConfig& c)
+{
+    std::stringstream ss;
+    if (c.objectives.size())
+    {
+        ss << "objectives, ";
+    }
+    if (c.trajectories.size())
+    {
+        ss << "trajectories, ";
+    }
+    if (c.warmStart.size())
+    {
+        ss << "warmStart, ";
+    }
+    if (c.saveSuccessors.size())
+    {
+        ss << "saveSuccessors, ";
+    }
+    if (c.online)
+    {
+        ss << "online, ";
+    }
+    if (c.farm.size())
+    {
+        ss << "farm, ";
+    }
+    if (c.isolate)
+    {
+        ss << "isolate, ";
+    }
+    if (c.plantLatency > 0)
+    {
+        ss << "plantLatency, ";
+    }
+    if (c.simulator.size())
+    {
+        ss << "simulator, ";
+    }
+    std::string names = ss.str();
+    return names.size() ? names.substr(0, names.size() - 2) : names;
+}
+
+bool validateJobConfig(const RunConfig& c, std::string& error)
+{
+    std::string names = executableSettings(c);
+    if (names.size())
+    {
+        error = "only the genetics executable supports " + names;
+        return false;
+    }
+    return true;
+}
+
+static std::string formatField(const ConfigField& f, const char* doubleFormat)
+{
+    std::stringstream ss;
+    switch (f.type)
+    {
+        case doubleField:
+        {
+            char buf[32];
+            snprintf(buf, sizeof(buf), doubleFormat, *static_cast<double*>(f.value));
+            ss << buf;
+            break;
+        }
+        case uintField:
+            ss << *static_cast<unsigned int*>(f.value);
+            break;
+        case ulongField:
+            ss << *static_cast<unsigned long*>(f.value);
+            break;
+        case boolField:
+            ss << (*static_cast<bool*>(f.value) ? "true" : "false");
+            break;
+        case stringField:
+            ss << *static_cast<std::string*>(f.value);
+            break;
+    }
+    return ss.str();
+}
+
+std::string configToString(const RunConfig& config)
+{
+    std::vector<ConfigField> fields = configFields(const_cast<RunConfig&>(config));
+    std::stringstream ss;
+    for(unsigned int i = 0; i < fields.size(); i++)
+    {
+        ss << fields[i].name << " = " << formatField(fields[i], "%.17g") << std::endl;
+    }
+    return ss.str();
+}
+
+std::string configDiff(const RunConfig& from, const RunConfig& to)
+{
+    std::vector<ConfigField> fromFields = configFields(const_cast<RunConfig&>(from));
+    std::vector<ConfigField> toFields = configFields(const_cast<RunConfig&>(to));
+    std::stringstream ss;
+    for(unsigned int i = 0; i < fromFields.size(); i++)
+    {
+        std::string a = formatField(fromFields[i], "%.17g");
+        std::string b = formatField(toFields[i], "%.17g");
+        if (a != b)
+        {
+            ss << fromFields[i].name << ": " << formatField(fromFields[i], "%g") << " -> " << formatField(toFields[i], "%g") << std::endl;
+        }
+    }
+    return ss.str();
+}
+
+std::string configUsage()
+{
+    RunConfig defaults;
+    std::vector<ConfigField> fields = configFields(defaults);
+    std::stringstream ss;
+    ss << "Options (--key=value or --key value, applied in order):" << std::endl;
+    ss << "  --config FILE  load settings from an INI file" << std::endl;
+    for(unsigned int i = 0; i < fields.size(); i++)
+    {
+        std::string value = formatField(fields[i], "%g");
+        ss << "  --" << fields[i].name << " (" << (value.size() ? value : "\"\"") << ")  " << fields[i].help << std::endl;
+    }
+    return ss.str();
+}
+
+PID1DProcessor* createProcessor(const RunConfig& c)
+{
+    PID1DProcessor* processor = new PID1DProcessor(c.timeout, c.timein, c.threshold, c.maxVoltage, c.minVoltage, c.goal, c.mass, c.motorStallTorque, c.motorFreeSpeed, c.gearingRatio, c.wheelDiameter, c.staticFriction, c.kineticFriction);
+    std::vector<PID1DProcessor::Objective> objectives;
+    std::string error;
+    if (PID1DProcessor::parseObjectives(c.objectives, objectives, error))
+    {
+        processor->setObjectives(objectives);
+    }
+    processor->setNoise(c.sensorNoise, c.actuatorNoise, c.loadDisturbance, c.noiseSamples, c.noiseSeed);
+    return processor;
+}
+
+unsigned long long plantHash(const RunConfig& c)
+{
+    double plant[] = {c.timeout, c.timein, c.threshold, c.maxVoltage, c.minVoltage, c.goal, c.mass, c.motorStallTorque, c.motorFreeSpeed, c.gearingRatio, c.wheelDiameter, c.staticFriction, c.kineticFriction};
+    // An external simulator takes its plant from its own command line
+    return fitnessHash(plant, sizeof(plant) / sizeof(plant[0]), c.simulator.size() ? fitnessHash(c.simulator) : 0);
+}
+
+void copyPlant(const RunConfig& from, RunConfig& to)
+{
+    to.timeout = from.timeout;
+    to.timein = from.timein;
+    to.threshold = from.threshold;
+    to.maxVoltage = from.maxVoltage;
+    to.minVoltage = from.minVoltage;
+    to.goal = from.goal;
+    to.mass = from.mass;
+    to.motorStallTorque = from.motorStallTorque;
+    to.motorFreeSpeed = from.motorFreeSpeed;
+    to.gearingRatio = from.gearingRatio;
+    to.wheelDiameter = from.wheelDiameter;
+    to.staticFriction = from.staticFriction;
+    to.kineticFriction = from.kineticFriction;
+}
+
+std::vector<Algo*> createSeeds(const RunConfig& c)
+{
+    std::vector<Algo*> seeds(1);
+    seeds[0] = new PIDAlgo(new PDParam(c.seedKP, c.mutationKP), new PDParam(c.seedKI, c.mutationKI), new PDParam(c.seedKD, c.mutationKD), c.maxVoltage, c.minVoltage);
+    return seeds;
+}
@@ -0,0 +1,184 @@
+/*
+ *  Config.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include <string>
+#include <vector>
+
+class Algo;
+class PID1DProcessor;
+
+/**
+ * Every parameter of a tuning run: plant, seed gains and GA settings
+ * Defaults reproduce the original hard-coded main.cpp run.
+ *
+ * Files are INI style: one "key = value" per line, '#' or ';' starts a
+ * comment and [section] headers are accepted for readability but do not
+ * namespace keys. Command line options are "--key=value" or "--key value",
+ * plus "--config file" to load a file at that point, so later options
+ * override earlier ones.
+ * All functions report problems through the error string and return false
+ **/
+
+struct RunConfig
+{
+    // Plant, see PID1DProcessor
+    double timeout;
+    double timein;
+    double threshold;
+    double maxVoltage;
+    double minVoltage;
+    double goal;
+    double mass;
+    double motorStallTorque;
+    double motorFreeSpeed;
+    double gearingRatio;
+    double wheelDiameter;
+    double staticFriction;
+    double kineticFriction;
+
+    // Plant noise drawn once per generation, see PID1DProcessor::setNoise()
+    double sensorNoise;
+    double actuatorNoise;
+    double loadDisturbance;
+    unsigned int noiseSamples;
+    unsigned long noiseSeed;
+
+    // Setpoint profiles tracked instead of the step, see TrajectoryProcessor
+    std::string trajectories;
+
+    // Seed gains and their mutation scales, see PDParam
+    double seedKP;
+    double seedKI;
+    double seedKD;
+    double mutationKP;
+    double mutationKI;
+    double mutationKD;
+
+    // GA and engine settings, see God
+    unsigned int populationSize;
+    unsigned int successorSize;
+    unsigned int numCycles;
+    unsigned int initialChunkSize;
+    unsigned int maxNumThreads;
+    unsigned long seed;
+    bool streaming;
+    std::string objectives;
+    bool racing;
+    double racingDelta;
+
+    // Warm start and online retuning
+    std::string warmStart;
+    std::string saveSuccessors;
+    bool online;
+
+    // Scores shared across runs, see FitnessDb
+    std::string fitnessDb;
+    unsigned int fitnessDbSize;
+    unsigned int fitnessDbBits;
+
+    // Evaluation on genetics-worker processes, see Farm
+    std::string farm;
+    unsigned int farmWorkers;
+    unsigned int farmWorkerThreads;
+    unsigned int farmBatchSize;
+    unsigned int farmPipeline;
+    double farmTimeout;
+    unsigned int farmAttempts;
+
+    // Evaluation in forked worker processes, see IsolatedProcessor
+    unsigned int isolate;
+    double isolateTimeout;
+    unsigned int isolateAttempts;
+    unsigned int isolateRecycle;
+
+    // Asynchronous evaluation, see AsyncProcessor
+    double plantLatency;
+    unsigned int asyncInFlight;
+
+    // External plant simulator, see SimulatorProcessor
+    std::string simulator;
+    unsigned int simulatorProcesses;
+    unsigned int simulatorBatchSize;
+    unsigned int simulatorPipeline;
+    double simulatorTimeout;
+    unsigned int simulatorAttempts;
+
+    // Output
+    std::string metrics;
+    std::string trace;
+    bool perf;
+    bool logging;
+    std::string logPrefix;
+
+    // Last file loaded with --config, not itself a setting
+    std::string configFile;
+
+    RunConfig();
+};
+
+bool setConfigValue(RunConfig& config, const std::string& key, const std::string& value, std::string& error);
+bool loadConfigFile(RunConfig& config, const std::string& filename, std::string& error);
+bool loadConfigString(RunConfig& config, const std::string& text, std::string& error);
+
+/**
+ * @return false on a bad option; "--help" also returns false with an empty error
+ */
+bool parseConfigArgs(RunConfig& config, int argc, char** argv, std::string& error);
+bool validateConfig(const RunConfig& config, std::string& error);
+
+/**
+ * Settings the config sets that only the genetics executable implements,
+ * as "farm, isolate", empty if none
+ */
+std::string executableSettings(const RunConfig& config);
+
+/**
+ * Rejects executableSettings(), for genetics-batch and geneticsd jobs,
+ * which run one plain God each
+ */
+bool validateJobConfig(const RunConfig& config, std::string& error);
+
+/**
+ * Serializes to the file format, loadConfigString() reads it back exactly
+ */
+std::string configToString(const RunConfig& config);
+
+/**
+ * @return "key: old -> new" for every setting that differs, one per line
+ */
+std::string configDiff(const RunConfig& from, const RunConfig& to);
+std::string configUsage();
+
+PID1DProcessor* createProcessor(const RunConfig& config);
+
+/**
+ * Identifies the plant for a FitnessDb, GA and output settings do not change it
+ * The simulator command is part of the plant, steps without one hash as before
+ */
+unsigned long long plantHash(const RunConfig& config);
+
+/**
+ * Copies the plant constants plantHash() covers, all an online reload may change
+ */
+void copyPlant(const RunConfig& from, RunConfig& to);
+std::vector<Algo*> createSeeds(const RunConfig& config);
+
+#endif // CONFIG_HPP
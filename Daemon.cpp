@@ -0,0 +1,376 @@
+/*
+ *  Daemon.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CachedProcessor.hpp"
+#include "Config.hpp"
+#include "FitnessDb.hpp"
+#include "God.hpp"
+#include "PID1DProcessor.hpp"
+#include "Protocol.hpp"
+#include "ThreadPool.hpp"
+#include "Timer.hpp"
+#include "rand.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Tuning daemon
+ * Accepts jobs over a Unix-domain socket (see Protocol.hpp), queues them by
+ * priority and runs up to --jobs of them at once. Every job's God runs its
+ * evaluations on one ThreadPool that lives as long as the daemon, so the
+ * worker threads are started once and cap the daemon's CPU use however
+ * many jobs are running. Progress and results are streamed back over the
+ * submitting connection.
+ * Jobs write per-generation logs only if they set logPrefix; metrics and
+ * trace settings are ignored, and settings only genetics implements, see
+ * validateJobConfig(), are rejected. Jobs that set fitnessDb share its
+ * scores with every other run using the same file.
+ *
+ * Usage: geneticsd [--socket path] [--threads N] [--jobs N]
+ **/
+
+struct DaemonJob
+{
+    unsigned long id;
+    int priority;
+    std::string name;
+    RunConfig config;
+    int fd;
+    bool running;
+};
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_queued = PTHREAD_COND_INITIALIZER;
+static std::vector<DaemonJob*> s_jobs;
+static unsigned long s_nextId = 1;
+static ThreadPool* s_pool = NULL;
+static const char* s_socketPath = defaultSocketPath;
+
+/**
+ * Streams every generation back to the client
+ */
+class ProgressSink : public virtual MetricsSink
+{
+    public:
+        ProgressSink(int fd)
+            : m_fd(fd)
+        {
+        }
+
+        virtual void record(const GenerationStats& stats)
+        {
+            std::stringstream ss;
+            ss << "PROGRESS " << stats.generation << " " << stats.numGenerations << " " << stats.bestSuccess << " " << stats.bestScore << " " << stats.mu << " " << stats.sigma << " " << stats.evaluationsPerSecond << " " << stats.totalTime();
+            writeLine(m_fd, ss.str());
+        }
+
+    private:
+        int m_fd;
+};
+
+/**
+ * Next job to run: highest priority, then lowest id
+ * Call with s_mutex held
+ */
+static DaemonJob* nextJob()
+{
+    DaemonJob* next = NULL;
+    for(unsigned int i = 0; i < s_jobs.size(); i++)
+    {
+        DaemonJob* job = s_jobs[i];
+        if (!job->running && (!next || job->priority > next->priority))
+        {
+            next = job;
+        }
+    }
+    return next;
+}
+
+static void runJob(DaemonJob* job)
+{
+    const RunConfig& config = job->config;
+    std::stringstream started;
+    started << "STARTED " << job->id;
+    writeLine(job->fd, started.str());
+    double start = monotonicTime();
+
+    void* rng = rng_create(config.seed ? config.seed : time(NULL) + job->id);
+    void* previous = rng_select(rng);
+    PID1DProcessor* processor = createProcessor(config);
+    FitnessDb db;
+    Processor* evaluator = processor;
+    std::string error;
+    if (config.fitnessDb.size() && !db.open(config.fitnessDb, config.fitnessDbSize * 1048576ULL, error))
+    {
+        fprintf(stderr, "Job %lu %s: running without fitness database, %s\n", job->id, job->name.c_str(), error.c_str());
+    }
+    CachedProcessor cached(*processor, db, plantHash(config), config.fitnessDbBits);
+    if (db.isOpen())
+    {
+        evaluator = &cached;
+    }
+    ProgressSink progress(job->fd);
+    God god(*evaluator, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, config.maxNumThreads, config.numCycles);
+    god.setLogPrefix(config.logPrefix, config.logging && config.logPrefix.size());
+    god.setPerfCounters(config.perf);
+    god.setStreaming(config.streaming);
+    god.setRacing(config.racing, config.racingDelta);
+    god.setThreadPool(s_pool);
+    god.addSink(&progress);
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    rng_select(previous);
+    rng_destroy(rng);
+
+    std::stringstream result;
+    result.precision(17);
+    result << "RESULT " << best.score.success << " " << best.score.score;
+    std::vector<double> genes = best.algo->getGenes();
+    std::vector<std::string> names = best.algo->getGeneNames();
+    for(unsigned int i = 0; i < genes.size() && i < names.size(); i++)
+    {
+        result << " " << names[i] << "=" << genes[i];
+    }
+    writeLine(job->fd, result.str());
+    fprintf(stderr, "Job %lu %s finished in %.2fs: %s%f\n", job->id, job->name.c_str(), monotonicTime() - start, best.score.success ? "" : "(failed) ", best.score.score);
+    delete best.algo;
+    delete processor;
+}
+
+static void* runner(void* param)
+{
+    while (true)
+    {
+        pthread_mutex_lock(&s_mutex);
+        DaemonJob* job;
+        while (!(job = nextJob()))
+        {
+            pthread_cond_wait(&s_queued, &s_mutex);
+        }
+        job->running = true;
+        pthread_mutex_unlock(&s_mutex);
+
+        runJob(job);
+
+        pthread_mutex_lock(&s_mutex);
+        for(unsigned int i = 0; i < s_jobs.size(); i++)
+        {
+            if (s_jobs[i] == job)
+            {
+                s_jobs.erase(s_jobs.begin() + i);
+                break;
+            }
+        }
+        pthread_mutex_unlock(&s_mutex);
+        close(job->fd);
+        delete job;
+    }
+    return 0;
+}
+
+static void submit(int fd, LineReader& reader, const std::string& header)
+{
+    char name[256] = "";
+    int priority = 0;
+    if (sscanf(header.c_str(), "SUBMIT %d %255s", &priority, name) < 1)
+    {
+        writeLine(fd, "ERROR expected SUBMIT <priority> <name>");
+        close(fd);
+        return;
+    }
+    std::string text, line;
+    bool ended = false;
+    while (reader.readLine(line))
+    {
+        if (line == "END")
+        {
+            ended = true;
+            break;
+        }
+        text += line + "\n";
+    }
+
+    DaemonJob* job = new DaemonJob;
+    job->priority = priority;
+    job->name = *name ? name : "job";
+    job->fd = fd;
+    job->running = false;
+    std::string error;
+    if (!ended)
+    {
+        error = "connection closed before END";
+    }
+    else if (loadConfigString(job->config, text, error) && validateConfig(job->config, error))
+    {
+        validateJobConfig(job->config, error);
+    }
+    if (error.size())
+    {
+        writeLine(fd, "ERROR " + error);
+        close(fd);
+        delete job;
+        return;
+    }
+
+    pthread_mutex_lock(&s_mutex);
+    job->id = s_nextId++;
+    unsigned int ahead = 0;
+    for(unsigned int i = 0; i < s_jobs.size(); i++)
+    {
+        ahead += !s_jobs[i]->running && s_jobs[i]->priority >= priority;
+    }
+    std::stringstream ss;
+    ss << "ACCEPTED " << job->id << " " << ahead;
+    writeLine(fd, ss.str());
+    s_jobs.push_back(job);
+    fprintf(stderr, "Job %lu %s queued with priority %d\n", job->id, job->name.c_str(), priority);
+    pthread_cond_signal(&s_queued);
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static void status(int fd)
+{
+    pthread_mutex_lock(&s_mutex);
+    for(unsigned int i = 0; i < s_jobs.size(); i++)
+    {
+        const DaemonJob* job = s_jobs[i];
+        std::stringstream ss;
+        ss << "JOB " << job->id << " " << (job->running ? "running" : "queued") << " " << job->priority << " " << job->name;
+        writeLine(fd, ss.str());
+    }
+    pthread_mutex_unlock(&s_mutex);
+    writeLine(fd, "END");
+    close(fd);
+}
+
+/**
+ * Reads one request, so a slow client never holds up accept()
+ */
+static void* connection(void* param)
+{
+    int fd = (int) (long) param;
+    LineReader reader(fd);
+    std::string line;
+    if (!reader.readLine(line))
+    {
+        close(fd);
+    }
+    else if (line.compare(0, 7, "SUBMIT ") == 0)
+    {
+        submit(fd, reader, line);
+    }
+    else if (line == "STATUS")
+    {
+        status(fd);
+    }
+    else
+    {
+        writeLine(fd, "ERROR unknown request");
+        close(fd);
+    }
+    return 0;
+}
+
+static void stopDaemon(int sig)
+{
+    unlink(s_socketPath);
+    _exit(0);
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int numThreads = 0;
+    unsigned int numRunners = 2;
+    for(int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--socket") && i + 1 < argc)
+        {
+            s_socketPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+        {
+            numThreads = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--jobs") && i + 1 < argc)
+        {
+            numRunners = atoi(argv[++i]);
+        }
+        else
+        {
+            numRunners = 0;
+            break;
+        }
+    }
+    if (numRunners == 0)
+    {
+        fprintf(stderr, "Usage: %s [--socket path] [--threads N] [--jobs N]\n", argv[0]);
+        return 1;
+    }
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(s_socketPath) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", s_socketPath);
+        return 1;
+    }
+    strcpy(addr.sun_path, s_socketPath);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(s_socketPath);
+    if (listener < 0 || bind(listener, (sockaddr*) &addr, sizeof(addr)) < 0 || listen(listener, 16) < 0)
+    {
+        perror(s_socketPath);
+        return 1;
+    }
+    signal(SIGINT, stopDaemon);
+    signal(SIGTERM, stopDaemon);
+
+    init_rng();
+    s_pool = new ThreadPool(numThreads);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for(unsigned int i = 0; i < numRunners; i++)
+    {
+        pthread_t thread;
+        pthread_create(&thread, &attr, runner, NULL);
+    }
+    fprintf(stderr, "Listening on %s with %u threads, %u concurrent jobs\n", s_socketPath, s_pool->numThreads(), numRunners);
+
+    while (true)
+    {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+        pthread_t thread;
+        pthread_create(&thread, &attr, connection, (void*) (long) fd);
+    }
+}
@@ -0,0 +1,575 @@
+/*
+ *  Farm.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Farm.hpp"
+
+#include "Protocol.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <set>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct Farm::Request
+{
+    unsigned int remaining;
+    pthread_cond_t done;
+};
+
+struct Farm::Batch
+{
+    unsigned long long id;
+    unsigned int config;
+    const std::vector<std::vector<double> >* genes;
+    unsigned int offset;
+    unsigned int count;
+    Processor::Score* scores;
+    Request* request;
+    unsigned int attempts;
+};
+
+struct Farm::Worker
+{
+    Worker(int fd_)
+        : fd(fd_)
+        , reader(fd_)
+        , lastSeen(monotonicTime())
+        , dead(false)
+    {
+    }
+
+    int fd;
+    LineReader reader;
+    double lastSeen;
+    bool dead;
+    std::set<unsigned int> configs;
+    std::vector<Batch*> inflight;
+};
+
+static void closeOnExec(int fd)
+{
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+Farm::Farm(unsigned int batchSize, unsigned int pipeline, double timeout, unsigned int maxAttempts)
+    : m_batchSize(batchSize > 0 ? batchSize : 1)
+    , m_pipeline(pipeline > 0 ? pipeline : 1)
+    , m_timeout(timeout)
+    , m_maxAttempts(maxAttempts > 0 ? maxAttempts : 1)
+    , m_listen(-1)
+    , m_port(0)
+    , m_started(false)
+    , m_stop(false)
+    , m_nextBatch(0)
+{
+    m_wake[0] = m_wake[1] = -1;
+    memset(&m_stats, 0, sizeof(m_stats));
+    pthread_mutex_init(&m_mutex, NULL);
+}
+
+Farm::~Farm()
+{
+    if (m_started)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_stop = true;
+        pthread_mutex_unlock(&m_mutex);
+        wake();
+        pthread_join(m_thread, NULL);
+    }
+    for(unsigned int i = 0; i < m_workers.size(); i++)
+    {
+        close(m_workers[i]->fd);
+        delete m_workers[i];
+    }
+    for(unsigned int i = 0; i < m_queue.size(); i++)
+    {
+        delete m_queue[i];
+    }
+    if (m_listen >= 0)
+    {
+        close(m_listen);
+    }
+    if (m_wake[0] >= 0)
+    {
+        close(m_wake[0]);
+        close(m_wake[1]);
+    }
+    for(unsigned int i = 0; i < m_spawned.size(); i++)
+    {
+        waitpid(m_spawned[i], NULL, 0);
+    }
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool Farm::listen(const std::string& address, std::string& error)
+{
+    std::string host, port = address;
+    size_t colon = address.rfind(':');
+    if (colon != std::string::npos)
+    {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+    }
+    struct addrinfo hints, *info = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(host.size() ? host.c_str() : NULL, port.c_str(), &hints, &info) != 0)
+    {
+        error = "cannot resolve " + address;
+        return false;
+    }
+    m_listen = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    bool ok = m_listen >= 0 && bind(m_listen, info->ai_addr, info->ai_addrlen) == 0 && ::listen(m_listen, 64) == 0;
+    freeaddrinfo(info);
+    if (!ok)
+    {
+        error = "cannot listen on " + address + ": " + strerror(errno);
+        return false;
+    }
+    closeOnExec(m_listen);
+    struct sockaddr_in bound;
+    socklen_t length = sizeof(bound);
+    getsockname(m_listen, (struct sockaddr*) &bound, &length);
+    m_port = ntohs(bound.sin_port);
+    if (pipe(m_wake) != 0)
+    {
+        error = "cannot create pipe";
+        return false;
+    }
+    closeOnExec(m_wake[0]);
+    closeOnExec(m_wake[1]);
+    fcntl(m_wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(m_wake[1], F_SETFL, O_NONBLOCK);
+    pthread_create(&m_thread, NULL, network, this);
+    m_started = true;
+    return true;
+}
+
+bool Farm::spawnWorkers(unsigned int count, const std::string& program, unsigned int threads, std::string& error)
+{
+    std::stringstream master, numThreads;
+    master << "127.0.0.1:" << m_port;
+    numThreads << threads;
+    pthread_mutex_lock(&m_mutex);
+    m_program = program;
+    m_masterArg = master.str();
+    m_threadsArg = numThreads.str();
+    bool ok = true;
+    for(unsigned int i = 0; ok && i < count; i++)
+    {
+        pid_t pid = spawn();
+        if (pid < 0)
+        {
+            error = "cannot fork";
+            ok = false;
+        }
+        else
+        {
+            m_spawned.push_back(pid);
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return ok;
+}
+
+std::vector<pid_t> Farm::spawnedWorkers() const
+{
+    pthread_mutex_lock(&m_mutex);
+    std::vector<pid_t> spawned = m_spawned;
+    pthread_mutex_unlock(&m_mutex);
+    return spawned;
+}
+
+pid_t Farm::spawn()
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execl(m_program.c_str(), m_program.c_str(), "--master", m_masterArg.c_str(), "--threads", m_threadsArg.c_str(), (char*) NULL);
+        fprintf(stderr, "Cannot run %s: %s\n", m_program.c_str(), strerror(errno));
+        _exit(127);
+    }
+    return pid;
+}
+
+void Farm::reap()
+{
+    for(unsigned int i = 0; i < m_spawned.size(); i++)
+    {
+        int status;
+        if (waitpid(m_spawned[i], &status, WNOHANG) != m_spawned[i])
+        {
+            continue;
+        }
+        // A program that cannot be run would only fail again
+        pid_t pid = WIFEXITED(status) && WEXITSTATUS(status) == 127 ? -1 : spawn();
+        if (pid < 0)
+        {
+            m_spawned.erase(m_spawned.begin() + i);
+            i--;
+            continue;
+        }
+        m_spawned[i] = pid;
+        m_stats.respawned++;
+    }
+}
+
+unsigned int Farm::addConfig(const std::string& config)
+{
+    pthread_mutex_lock(&m_mutex);
+    unsigned int id = m_configs.size();
+    m_configs.push_back(config);
+    if (config.size() && config[config.size() - 1] != '\n')
+    {
+        m_configs.back() += "\n";
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return id;
+}
+
+void Farm::evaluate(unsigned int config, const std::vector<std::vector<double> >& genes, Processor::Score* scores)
+{
+    if (genes.empty())
+    {
+        return;
+    }
+    Request request;
+    request.remaining = (genes.size() + m_batchSize - 1) / m_batchSize;
+    pthread_cond_init(&request.done, NULL);
+    pthread_mutex_lock(&m_mutex);
+    for(unsigned int offset = 0; offset < genes.size(); offset += m_batchSize)
+    {
+        Batch* batch = new Batch;
+        batch->id = m_nextBatch++;
+        batch->config = config;
+        batch->genes = &genes;
+        batch->offset = offset;
+        batch->count = std::min((unsigned int) genes.size() - offset, m_batchSize);
+        batch->scores = scores + offset;
+        batch->request = &request;
+        batch->attempts = 0;
+        m_queue.push_back(batch);
+    }
+    pthread_mutex_unlock(&m_mutex);
+    wake();
+    pthread_mutex_lock(&m_mutex);
+    while (request.remaining > 0)
+    {
+        pthread_cond_wait(&request.done, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+    pthread_cond_destroy(&request.done);
+}
+
+Farm::Stats Farm::getStats() const
+{
+    pthread_mutex_lock(&m_mutex);
+    Stats stats = m_stats;
+    stats.workers = m_workers.size();
+    pthread_mutex_unlock(&m_mutex);
+    return stats;
+}
+
+std::string Farm::getSummary() const
+{
+    Stats stats = getStats();
+    std::stringstream ss;
+    ss << "Farm: " << stats.workers << " workers Batches: " << stats.batches << " Redispatched: " << stats.redispatched << " Lost workers: " << stats.lost << " Failed: " << stats.failed << " Respawned: " << stats.respawned << std::endl;
+    return ss.str();
+}
+
+void Farm::wake()
+{
+    char c = 0;
+    if (write(m_wake[1], &c, 1) < 0)
+    {
+        // Pipe full, the network thread is awake anyway
+    }
+}
+
+void* Farm::network(void* param)
+{
+    static_cast<Farm*>(param)->run();
+    return 0;
+}
+
+void Farm::run()
+{
+    double interval = m_timeout / 4;
+    double lastPing = monotonicTime();
+    std::vector<struct pollfd> fds;
+    std::vector<Worker*> polled;
+    while (true)
+    {
+        pthread_mutex_lock(&m_mutex);
+        polled = m_workers;
+        pthread_mutex_unlock(&m_mutex);
+        fds.resize(polled.size() + 2);
+        fds[0].fd = m_wake[0];
+        fds[1].fd = m_listen;
+        for(unsigned int i = 0; i < polled.size(); i++)
+        {
+            fds[i + 2].fd = polled[i]->fd;
+        }
+        for(unsigned int i = 0; i < fds.size(); i++)
+        {
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        poll(&fds[0], fds.size(), (int) (interval * 1000) + 1);
+
+        pthread_mutex_lock(&m_mutex);
+        if (m_stop)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return;
+        }
+        char drain[64];
+        while (read(m_wake[0], drain, sizeof(drain)) > 0)
+        {
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            int fd = accept(m_listen, NULL, NULL);
+            if (fd >= 0)
+            {
+                closeOnExec(fd);
+                int on = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                // A worker that stops reading must not stall the farm for longer than the timeout
+                struct timeval tv;
+                tv.tv_sec = (time_t) m_timeout;
+                tv.tv_usec = (suseconds_t) ((m_timeout - tv.tv_sec) * 1e6);
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+                m_workers.push_back(new Worker(fd));
+            }
+        }
+        for(unsigned int i = 0; i < polled.size(); i++)
+        {
+            Worker* w = polled[i];
+            if (!fds[i + 2].revents)
+            {
+                continue;
+            }
+            if (!w->reader.fill())
+            {
+                w->dead = true;
+                continue;
+            }
+            std::string line;
+            while (!w->dead && w->reader.nextLine(line))
+            {
+                w->lastSeen = monotonicTime();
+                w->dead = !handle(w, line);
+            }
+        }
+        double now = monotonicTime();
+        bool ping = now - lastPing >= interval;
+        if (ping)
+        {
+            lastPing = now;
+        }
+        for(unsigned int i = 0; i < m_workers.size(); i++)
+        {
+            Worker* w = m_workers[i];
+            if (!w->dead && now - w->lastSeen > m_timeout)
+            {
+                w->dead = true;
+            }
+            if (!w->dead && ping)
+            {
+                w->dead = !writeLine(w->fd, "PING");
+            }
+        }
+        for(unsigned int i = 0; i < m_workers.size(); i++)
+        {
+            if (m_workers[i]->dead)
+            {
+                drop(m_workers[i]);
+                m_workers.erase(m_workers.begin() + i);
+                i--;
+            }
+        }
+        reap();
+        dispatch();
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+bool Farm::handle(Worker* w, const std::string& line)
+{
+    if (line.compare(0, 7, "SCORES ") != 0)
+    {
+        return line == "PONG" || line.compare(0, 6, "HELLO ") == 0;
+    }
+    const char* s = line.c_str() + 7;
+    char* end;
+    unsigned long long id = strtoull(s, &end, 10);
+    unsigned long count = strtoul(end, &end, 10);
+    unsigned int i = 0;
+    while (i < w->inflight.size() && w->inflight[i]->id != id)
+    {
+        i++;
+    }
+    if (i == w->inflight.size() || count != w->inflight[i]->count)
+    {
+        return false;
+    }
+    Batch* batch = w->inflight[i];
+    for(unsigned int j = 0; j < count; j++)
+    {
+        char* scoreEnd;
+        batch->scores[j].success = strtol(end, &scoreEnd, 10) != 0;
+        batch->scores[j].score = strtod(scoreEnd, &end);
+        if (end == scoreEnd)
+        {
+            return false;
+        }
+    }
+    w->inflight.erase(w->inflight.begin() + i);
+    if (--batch->request->remaining == 0)
+    {
+        pthread_cond_signal(&batch->request->done);
+    }
+    delete batch;
+    return true;
+}
+
+bool Farm::send(Worker* w, Batch* batch)
+{
+    if (!w->configs.count(batch->config))
+    {
+        std::stringstream ss;
+        ss << "CONFIG " << batch->config << "\n" << m_configs[batch->config] << "END";
+        if (!writeLine(w->fd, ss.str()))
+        {
+            return false;
+        }
+        w->configs.insert(batch->config);
+    }
+    const std::vector<std::vector<double> >& genes = *batch->genes;
+    unsigned int numGenes = genes[batch->offset].size();
+    char buf[64];
+    snprintf(buf, sizeof(buf), "BATCH %llu %u %u %u", batch->id, batch->config, batch->count, numGenes);
+    std::string line = buf;
+    for(unsigned int i = batch->offset; i < batch->offset + batch->count; i++)
+    {
+        for(unsigned int j = 0; j < numGenes; j++)
+        {
+            snprintf(buf, sizeof(buf), " %.17g", genes[i][j]);
+            line += buf;
+        }
+    }
+    return writeLine(w->fd, line);
+}
+
+void Farm::dispatch()
+{
+    while (!m_queue.empty())
+    {
+        Worker* target = NULL;
+        for(unsigned int i = 0; i < m_workers.size(); i++)
+        {
+            Worker* w = m_workers[i];
+            if (!w->dead && w->inflight.size() < m_pipeline && (!target || w->inflight.size() < target->inflight.size()))
+            {
+                target = w;
+            }
+        }
+        if (!target)
+        {
+            return;
+        }
+        Batch* batch = m_queue.front();
+        m_queue.pop_front();
+        if (!send(target, batch))
+        {
+            m_queue.push_front(batch);
+            target->dead = true;
+            drop(target);
+            m_workers.erase(std::find(m_workers.begin(), m_workers.end(), target));
+            continue;
+        }
+        target->inflight.push_back(batch);
+        m_stats.batches++;
+    }
+}
+
+void Farm::drop(Worker* w)
+{
+    // Oldest batches first at the front, so requeued work keeps its order
+    for(unsigned int i = w->inflight.size(); i > 0; i--)
+    {
+        requeue(w->inflight[i - 1]);
+    }
+    m_stats.lost++;
+    close(w->fd);
+    delete w;
+}
+
+void Farm::requeue(Batch* batch)
+{
+    batch->attempts++;
+    if (batch->attempts >= m_maxAttempts)
+    {
+        for(unsigned int i = 0; i < batch->count; i++)
+        {
+            batch->scores[i].success = false;
+            batch->scores[i].score = HUGE_VAL;
+        }
+        m_stats.failed += batch->count;
+        if (--batch->request->remaining == 0)
+        {
+            pthread_cond_signal(&batch->request->done);
+        }
+        delete batch;
+        return;
+    }
+    // One genome per batch, so one that crashes its worker is not retried with the others
+    batch->request->remaining += batch->count - 1;
+    for(unsigned int i = batch->count; i > 0; i--)
+    {
+        Batch* single = new Batch(*batch);
+        single->id = m_nextBatch++;
+        single->offset = batch->offset + i - 1;
+        single->count = 1;
+        single->scores = batch->scores + i - 1;
+        m_queue.push_front(single);
+    }
+    m_stats.redispatched += batch->count;
+    delete batch;
+}
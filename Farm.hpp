@@ -0,0 +1,161 @@
+/*
+ *  Farm.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FARM_HPP
+#define FARM_HPP
+
+#include "Processor.hpp"
+
+#include <deque>
+#include <pthread.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * Master side of an evaluation farm
+ * genetics-worker processes connect over TCP and evaluate batches of
+ * genomes; evaluate() splits its genomes into batches, queues them and
+ * blocks until every one is scored. A network thread owns all sockets: it
+ * keeps up to `pipeline` batches in flight on each worker, least loaded
+ * first, pings every worker a quarter of the timeout apart and treats one
+ * that has not answered within the timeout, or whose connection fails, as
+ * dead, putting its batches back at the front of the queue for the
+ * others. A lost batch comes back one genome per batch, so a genome that
+ * crashes its worker takes down only itself; once a genome has been lost
+ * maxAttempts times it is scored as a failure with an infinite score.
+ * Spawned workers that exit are started again. Scores are written to the
+ * caller's slot for each genome, so results do not depend on which worker
+ * returned them or when.
+ *
+ * Line protocol, numbers printed with %.17g:
+ *   < HELLO <threads>                                     on connecting
+ *   > CONFIG <id>, the genetics.ini text, END             before its first batch
+ *   > BATCH <id> <config> <count> <genes> <gene>...       count * genes values
+ *   < SCORES <id> <count> <success> <score>...
+ *   > PING
+ *   < PONG
+ **/
+
+class Farm
+{
+    public:
+        struct Stats
+        {
+            unsigned int workers;
+            unsigned long long batches;
+            unsigned long long redispatched;
+            unsigned long long lost;
+            unsigned long long failed;
+            unsigned long long respawned;
+        };
+
+        /**
+         * @param batchSize most genomes sent in one batch
+         * @param pipeline batches in flight per worker
+         * @param timeout seconds a worker may stay silent before it is dropped
+         * @param maxAttempts workers a genome may be lost with before it counts as failed
+         */
+        Farm(unsigned int batchSize=16, unsigned int pipeline=4, double timeout=10.0, unsigned int maxAttempts=2);
+
+        /**
+         * No evaluate() may be in progress; workers see the connection
+         * close and exit, spawned ones are reaped
+         */
+        ~Farm();
+
+        /**
+         * Starts accepting workers
+         * @param address "[host:]port", port 0 picks a free one
+         */
+        bool listen(const std::string& address, std::string& error);
+
+        unsigned short port() const
+        {
+            return m_port;
+        }
+
+        /**
+         * Starts local workers connected to this farm, e.g. for testing
+         * Workers that exit are started again, except when the program
+         * cannot be run
+         * @param program path of genetics-worker
+         */
+        bool spawnWorkers(unsigned int count, const std::string& program, unsigned int threads, std::string& error);
+
+        /**
+         * Thread-safe, pids of the running spawned workers
+         */
+        std::vector<pid_t> spawnedWorkers() const;
+
+        /**
+         * Thread-safe
+         * @param config genetics.ini text the workers build their processor from
+         * @return id to evaluate() with
+         */
+        unsigned int addConfig(const std::string& config);
+
+        /**
+         * Thread-safe, blocks until every genome is scored
+         */
+        void evaluate(unsigned int config, const std::vector<std::vector<double> >& genes, Processor::Score* scores);
+
+        Stats getStats() const;
+        std::string getSummary() const;
+
+    private:
+        struct Request;
+        struct Batch;
+        struct Worker;
+
+        Farm(const Farm& farm);
+        const Farm& operator=(const Farm& farm);
+        static void* network(void* param);
+        void run();
+        void wake();
+        bool handle(Worker* worker, const std::string& line);
+        bool send(Worker* worker, Batch* batch);
+        void dispatch();
+        void drop(Worker* worker);
+        void requeue(Batch* batch);
+        pid_t spawn();
+        void reap();
+
+        unsigned int m_batchSize;
+        unsigned int m_pipeline;
+        double m_timeout;
+        unsigned int m_maxAttempts;
+        int m_listen;
+        int m_wake[2];
+        unsigned short m_port;
+        bool m_started;
+        bool m_stop;
+        pthread_t m_thread;
+        mutable pthread_mutex_t m_mutex;
+        std::vector<std::string> m_configs;
+        std::deque<Batch*> m_queue;
+        std::vector<Worker*> m_workers;
+        std::vector<pid_t> m_spawned;
+        std::string m_program;
+        std::string m_masterArg;
+        std::string m_threadsArg;
+        unsigned long long m_nextBatch;
+        Stats m_stats;
+};
+
+#endif // FARM_HPP
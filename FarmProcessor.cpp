@@ -0,0 +1,59 @@
+/*
+ *  FarmProcessor.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FarmProcessor.hpp"
+
+#include "Algo.hpp"
+#include "Config.hpp"
+#include "Farm.hpp"
+#include "PID1DProcessor.hpp"
+
+#include <vector>
+
+FarmProcessor::FarmProcessor(Farm& farm, const RunConfig& config)
+    : m_farm(farm)
+    , m_config(farm.addConfig(configToString(config)))
+    , m_local(createProcessor(config))
+{
+}
+
+FarmProcessor::~FarmProcessor()
+{
+    delete m_local;
+}
+
+Processor::Score FarmProcessor::process(Algo* a, std::string logname) const
+{
+    if (logname.size())
+    {
+        return m_local->process(a, logname);
+    }
+    Processor::Score score;
+    processBatch(&a, 1, &score);
+    return score;
+}
+
+void FarmProcessor::processBatch(Algo* const* algos, unsigned int count, Processor::Score* scores) const
+{
+    std::vector<std::vector<double> > genes(count);
+    for(unsigned int i = 0; i < count; i++)
+    {
+        genes[i] = algos[i]->getGenes();
+    }
+    m_farm.evaluate(m_config, genes, scores);
+}
@@ -0,0 +1,49 @@
+/*
+ *  FarmProcessor.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FARM_PROCESSOR_HPP
+#define FARM_PROCESSOR_HPP
+
+#include "Processor.hpp"
+
+class Farm;
+class PID1DProcessor;
+struct RunConfig;
+
+/**
+ * Scores algorithms on the workers of a Farm
+ * Workers rebuild the plant from the run configuration and the algorithm
+ * from its genes. Logged runs are simulated locally so the log is written
+ * here. The farm is not owned
+ */
+class FarmProcessor : public virtual Processor
+{
+    public:
+        FarmProcessor(Farm& farm, const RunConfig& config);
+        ~FarmProcessor();
+        virtual Processor::Score process(Algo* a, std::string logname="") const;
+        virtual void processBatch(Algo* const* algos, unsigned int count, Processor::Score* scores) const;
+    private:
+        FarmProcessor(const FarmProcessor& processor);
+        const FarmProcessor& operator=(const FarmProcessor& processor);
+        Farm& m_farm;
+        unsigned int m_config;
+        PID1DProcessor* m_local;
+};
+
+#endif // FARM_PROCESSOR_HPP
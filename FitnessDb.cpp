@@ -0,0 +1,310 @@
+/*
+ *  FitnessDb.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FitnessDb.hpp"
+
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char s_magic[8] = {'g', 'e', 'n', 'f', 'i', 't', 'd', 'b'};
+static const unsigned int s_version = 1;
+static const unsigned int s_maxProbe = 32;
+static const unsigned long long s_minSlots = 1024;
+
+// Slot states, the low two bits of the tag below the epoch
+static const unsigned long long s_empty = 0;
+static const unsigned long long s_writing = 1;
+static const unsigned long long s_failed = 2;
+static const unsigned long long s_succeeded = 3;
+
+// Epochs start at 2 so that a zeroed slot already counts as two behind
+static const unsigned long long s_firstEpoch = 2;
+
+struct FitnessDb::Header
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int slotSize;
+    unsigned long long numSlots;
+    volatile unsigned long long epoch;
+    volatile unsigned long long used[2];
+    unsigned long long reserved[2];
+};
+
+struct FitnessDb::Slot
+{
+    volatile unsigned long long tag;
+    volatile unsigned long long hash;
+    volatile unsigned long long check;
+    volatile double score;
+};
+
+static unsigned long long mix(unsigned long long x)
+{
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static unsigned long long doubleBits(double value)
+{
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+unsigned long long fitnessHash(const double* values, unsigned int count, unsigned long long seed)
+{
+    unsigned long long h = mix(seed + 0x9e3779b97f4a7c15ULL);
+    for(unsigned int i = 0; i < count; i++)
+    {
+        h = mix(h ^ doubleBits(values[i]));
+    }
+    return h;
+}
+
+unsigned long long fitnessHash(const std::string& text, unsigned long long seed)
+{
+    unsigned long long h = mix(seed + 0x9e3779b97f4a7c15ULL);
+    for(unsigned int i = 0; i < text.size(); i++)
+    {
+        h = mix(h ^ (unsigned char) text[i]);
+    }
+    return mix(h ^ text.size());
+}
+
+FitnessDb::FitnessDb()
+    : m_header(NULL)
+    , m_slots(NULL)
+    , m_mapSize(0)
+    , m_lookups(0)
+    , m_hits(0)
+{
+}
+
+FitnessDb::~FitnessDb()
+{
+    close();
+}
+
+bool FitnessDb::open(const std::string& filename, unsigned long long maxBytes, std::string& error)
+{
+    close();
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0)
+    {
+        error = "cannot open " + filename;
+        return false;
+    }
+    // Only creation needs the lock, concurrent openers wait for the header
+    flock(fd, LOCK_EX);
+    Header header;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size == 0)
+    {
+        unsigned long long halfSlots = s_minSlots;
+        while (sizeof(Header) + 4 * halfSlots * sizeof(Slot) <= maxBytes)
+        {
+            halfSlots *= 2;
+        }
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, s_magic, sizeof(s_magic));
+        header.version = s_version;
+        header.slotSize = sizeof(Slot);
+        header.numSlots = 2 * halfSlots;
+        header.epoch = s_firstEpoch;
+        ok = ftruncate(fd, sizeof(Header) + header.numSlots * sizeof(Slot)) == 0 && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+        if (!ok)
+        {
+            error = "cannot create " + filename;
+        }
+    }
+    else if (ok)
+    {
+        ok = pread(fd, &header, sizeof(header), 0) == sizeof(header) && !memcmp(header.magic, s_magic, sizeof(s_magic)) && header.version == s_version && header.slotSize == sizeof(Slot) && header.numSlots >= 2 * s_minSlots && (header.numSlots & (header.numSlots - 1)) == 0 && (unsigned long long) st.st_size == sizeof(Header) + header.numSlots * sizeof(Slot);
+        if (!ok)
+        {
+            error = filename + " is not a fitness database";
+        }
+    }
+    else
+    {
+        error = "cannot stat " + filename;
+    }
+    flock(fd, LOCK_UN);
+    if (ok)
+    {
+        m_mapSize = sizeof(Header) + header.numSlots * sizeof(Slot);
+        void* map = mmap(NULL, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            error = "cannot map " + filename;
+            ok = false;
+        }
+        else
+        {
+            m_header = static_cast<Header*>(map);
+            m_slots = reinterpret_cast<Slot*>(m_header + 1);
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+void FitnessDb::close()
+{
+    if (m_header)
+    {
+        munmap(m_header, m_mapSize);
+    }
+    m_header = NULL;
+    m_slots = NULL;
+    m_mapSize = 0;
+}
+
+FitnessDb::Key FitnessDb::makeKey(unsigned long long configHash, const std::vector<double>& genes, unsigned int geneBits)
+{
+    unsigned long long cut = geneBits < 52 ? 52 - geneBits : 0;
+    Key key = {mix(configHash ^ genes.size()), mix(~configHash + genes.size())};
+    for(unsigned int i = 0; i < genes.size(); i++)
+    {
+        double gene = genes[i] == 0 ? 0.0 : genes[i];
+        unsigned long long bits = doubleBits(gene);
+        if (cut && isfinite(gene))
+        {
+            // Round to nearest, a carry into the exponent is still correct
+            bits += 1ULL << (cut - 1);
+            bits &= ~((1ULL << cut) - 1);
+        }
+        key.hash = mix(key.hash ^ bits);
+        key.check = mix(key.check + bits * 0x9e3779b97f4a7c15ULL);
+    }
+    return key;
+}
+
+unsigned long long FitnessDb::numSlots() const
+{
+    return m_header ? m_header->numSlots / 2 : 0;
+}
+
+bool FitnessDb::find(const Key& key, unsigned long long epoch, Processor::Score& score) const
+{
+    unsigned long long halfSlots = m_header->numSlots / 2;
+    const Slot* table = m_slots + (epoch & 1) * halfSlots;
+    for(unsigned int p = 0; p < s_maxProbe; p++)
+    {
+        const Slot& slot = table[(key.hash + p) & (halfSlots - 1)];
+        unsigned long long tag = slot.tag;
+        __sync_synchronize();
+        if (tag >> 2 != epoch || (tag & 3) == s_empty)
+        {
+            // Anything older than this generation ends its probe sequences
+            return false;
+        }
+        if ((tag & 3) == s_writing)
+        {
+            continue;
+        }
+        unsigned long long hash = slot.hash, check = slot.check;
+        double value = slot.score;
+        __sync_synchronize();
+        if (slot.tag == tag && hash == key.hash && check == key.check)
+        {
+            score.success = (tag & 3) == s_succeeded;
+            score.score = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FitnessDb::lookup(const Key& key, Processor::Score& score) const
+{
+    if (!m_header)
+    {
+        return false;
+    }
+    __sync_fetch_and_add(&m_lookups, 1);
+    unsigned long long epoch = m_header->epoch;
+    if (find(key, epoch, score) || find(key, epoch - 1, score))
+    {
+        __sync_fetch_and_add(&m_hits, 1);
+        return true;
+    }
+    return false;
+}
+
+void FitnessDb::advance(unsigned long long epoch)
+{
+    if (__sync_bool_compare_and_swap(&m_header->epoch, epoch, epoch + 1))
+    {
+        m_header->used[(epoch + 1) & 1] = 0;
+    }
+}
+
+void FitnessDb::insert(const Key& key, const Processor::Score& score)
+{
+    if (!m_header)
+    {
+        return;
+    }
+    unsigned long long epoch = m_header->epoch;
+    unsigned long long halfSlots = m_header->numSlots / 2;
+    Slot* table = m_slots + (epoch & 1) * halfSlots;
+    for(unsigned int p = 0; p < s_maxProbe; p++)
+    {
+        Slot& slot = table[(key.hash + p) & (halfSlots - 1)];
+        unsigned long long tag = slot.tag;
+        if ((tag >> 2) + 2 > epoch)
+        {
+            // Live, or being written, in this generation
+            if ((tag & 3) >= s_failed && slot.hash == key.hash && slot.check == key.check)
+            {
+                return;
+            }
+            continue;
+        }
+        if (!__sync_bool_compare_and_swap(&slot.tag, tag, (epoch << 2) | s_writing))
+        {
+            // Lost the slot to another insert, look at it again
+            p--;
+            continue;
+        }
+        slot.hash = key.hash;
+        slot.check = key.check;
+        slot.score = score.score;
+        __sync_synchronize();
+        slot.tag = (epoch << 2) | (score.success ? s_succeeded : s_failed);
+        if (__sync_add_and_fetch(&m_header->used[epoch & 1], 1) >= halfSlots / 2)
+        {
+            advance(epoch);
+        }
+        return;
+    }
+    advance(epoch);
+}
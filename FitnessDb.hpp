@@ -0,0 +1,130 @@
+/*
+ *  FitnessDb.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FITNESS_DB_HPP
+#define FITNESS_DB_HPP
+
+#include "Processor.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * Persistent table of scores, memory-mapped from a file so that every
+ * thread and every process on the machine shares it
+ * Entries are keyed by a hash of the processor configuration and the
+ * genome with each gene rounded to a number of mantissa bits, so a genome
+ * scored by any earlier run is not simulated again.
+ *
+ * The file is a header and two open-addressing hash tables of fixed-size
+ * slots, one per generation. Inserts claim a slot with a compare-and-swap
+ * on its tag (epoch and state) and never change it afterwards; lookups
+ * read the tag before and after the slot, seqlock style, so neither takes a
+ * lock. Inserts go to the current generation's table, lookups try it and
+ * then the previous one. When the current table is half full, or a probe
+ * sequence runs out, the epoch advances: the previous generation is
+ * dropped and its table is reused, its slots being free once their epoch
+ * is two behind. Entries a run keeps hitting are therefore lost at most
+ * once per two generations.
+ **/
+
+class FitnessDb
+{
+    public:
+        struct Key
+        {
+            unsigned long long hash;
+            unsigned long long check;
+        };
+
+        FitnessDb();
+        ~FitnessDb();
+
+        /**
+         * Creates the file if needed, an existing file keeps its own size
+         * @param maxBytes size of a new file including the header
+         */
+        bool open(const std::string& filename, unsigned long long maxBytes, std::string& error);
+        void close();
+
+        bool isOpen() const
+        {
+            return m_header != NULL;
+        }
+
+        /**
+         * @param geneBits mantissa bits kept of every gene, 52 for exact matches
+         */
+        static Key makeKey(unsigned long long configHash, const std::vector<double>& genes, unsigned int geneBits);
+
+        /**
+         * Thread-safe and lock-free
+         * @return false on a miss
+         */
+        bool lookup(const Key& key, Processor::Score& score) const;
+
+        /**
+         * Thread-safe and lock-free; dropped if no free slot is found
+         */
+        void insert(const Key& key, const Processor::Score& score);
+
+        /**
+         * Slots in each generation's table
+         */
+        unsigned long long numSlots() const;
+
+        /**
+         * Lookups and hits through this handle only, not the whole file
+         */
+        unsigned long long lookups() const
+        {
+            return m_lookups;
+        }
+
+        unsigned long long hits() const
+        {
+            return m_hits;
+        }
+
+    private:
+        struct Header;
+        struct Slot;
+
+        FitnessDb(const FitnessDb& db);
+        const FitnessDb& operator=(const FitnessDb& db);
+        bool find(const Key& key, unsigned long long epoch, Processor::Score& score) const;
+        void advance(unsigned long long epoch);
+
+        Header* m_header;
+        Slot* m_slots;
+        unsigned long long m_mapSize;
+        mutable unsigned long long m_lookups;
+        mutable unsigned long long m_hits;
+};
+
+/**
+ * 64-bit hash of a list of numbers, e.g. a plant's constants
+ */
+unsigned long long fitnessHash(const double* values, unsigned int count, unsigned long long seed=0);
+
+/**
+ * 64-bit hash of a text, e.g. an external simulator's command line
+ */
+unsigned long long fitnessHash(const std::string& text, unsigned long long seed=0);
+
+#endif // FITNESS_DB_HPP
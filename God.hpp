@@ -20,8 +20,20 @@
 #define GOD_HPP
 
 #include "Algo.hpp"
+#include "AllocCounter.hpp"
 #include "Heap.hpp"
+#include "Metrics.hpp"
+#include "Pareto.hpp"
+#include "Race.hpp"
+#include "PerfCounters.hpp"
+#include "Population.hpp"
 #include "Processor.hpp"
+#include "QuantileSketch.hpp"
+#include "ThreadPool.hpp"
+#include "ThreadTuner.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+#include "rand.h"
 
 #include <algorithm>
 #include <math.h>
@@ -33,52 +45,240 @@
  * Game Master / God Class
  * Oversees the "natural selection" of algorithms from generation to generation
  * Different exit conditions available by passing a functor to update()
+ * Thread count and chunk size are calibrated at runtime by a ThreadTuner
+ * Progress is published as GenerationStats to every registered MetricsSink
+ * Hardware counters per phase are collected when enabled by setPerfCounters()
+ * With setThreadPool() the evaluation workers run as tasks on a pool shared
+ * with other Gods instead of threads of their own
+ * For warm starts setKeepSeeds() puts the seeds themselves into the first
+ * generation, so a saved population is re-scored before it is bred from.
+ * In online use setProcessor() swaps the fitness function from any thread,
+ * taking effect at the next generation, and stop() ends the run after the
+ * current one
  * Online descriptive statistics derived from: ftp://reports.stanford.edu/pub/cstr/reports/cs/tr/79/773/CS-TR-79-773.pdf
+ * Score quantiles and per-gene GeneStats are gathered by each thread during
+ * evaluation and merged with the moments
+ * With setStreaming() no population is kept: workers breed each chunk from
+ * the successors as they take it and keep only their best, so memory is
+ * bounded by successors and threads times chunk size, not population size
+ * simulatePareto() runs NSGA-II on the processor's objectives instead and
+ * returns the first Pareto front
+ * When the processor measures step responses they are taken during the
+ * evaluation itself, kept with each score and published for every successor
+ * Processor::beginGeneration() is called before each generation is
+ * evaluated, with the generation number
+ * With setRacing() and a processor scoring several samples, a generation is
+ * raced over its samples instead, see Race.hpp
  **/
 
 struct AlgoScore
 {
     Algo* algo;
     Processor::Score score;
+    Processor::Response response;
 };
 
 template<typename H>
 struct threadData
 {
     const std::vector<Algo*>* population;
-    unsigned int start;
+    const std::vector<Algo*>* parents;
+    const Algo* elite;
+    unsigned int numKept;
+    unsigned long seed;
+    unsigned int* next;
     unsigned int stop;
+    unsigned int chunkSize;
     unsigned int successorSize;
     const Processor*  processor;
+    bool responses;
     pthread_mutex_t* mutex;
     Heap<AlgoScore, H>* scores;
     double* popM;
     double* popBar;
     unsigned int* popN;
+    QuantileSketch* popSketch;
+    unsigned int* popSuccesses;
+    std::vector<GeneStats>* popGenes;
+    double busy;
+    double overhead;
+    unsigned int chunks;
+    double lockWait;
+    double evalEnd;
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+    bool perf;
+    bool perfValid;
+    PerfSample evalPerf;
+    PerfSample mergePerf;
 };
 
+/**
+ * Keeps as in a bounded heap of algorithms it owns, deleting whichever of
+ * as and the worst kept one loses
+ */
+template<typename H> void insertOwned(Heap<AlgoScore, H>& heap, const AlgoScore& as, unsigned int capacity)
+{
+    if ((unsigned int) heap.Size() < capacity)
+    {
+        heap.Insert(as);
+        return;
+    }
+    if (H()(as, heap.Peek()) >= 0)
+    {
+        delete as.algo;
+        return;
+    }
+    Algo* evicted = heap.Peek().algo;
+    heap.Insert(as);
+    delete evicted;
+}
+
+/**
+ * Child at index i of a streamed generation: the first numKept parents
+ * themselves, the elite at 0, the rest bred from the parents in turn, as
+ * God::simulate() would have filled the population
+ */
+template<typename H> Algo* breed(const threadData<H>* td, unsigned int i)
+{
+    const std::vector<Algo*>& parents = *td->parents;
+    if (i < td->numKept)
+    {
+        return parents[i]->clone(parents[i]->getGenes());
+    }
+    if (i == 0 && td->elite)
+    {
+        return td->elite->clone(td->elite->getGenes());
+    }
+    return parents[i % parents.size()]->gen();
+}
+
+/**
+ * Evaluation worker
+ * Threads pull chunks of the population off a shared cursor until it runs
+ * out, so a slow chunk only delays its own thread. Each chunk is scored by
+ * one Processor::processBatch() call. When streaming the chunk is bred
+ * first, each child from a generator seeded by its own position, so the
+ * children depend neither on which thread took the chunk nor on the chunk
+ * size the tuner picked
+ **/
 template<typename H> void* Process(void* param)
 {
     threadData<H>* td = static_cast<threadData<H>*>(param);
+    PerfCounters* perf = td->perf ? new PerfCounters : NULL;
+    PerfSample perfStart = {0, 0, 0, 0}, perfEval = {0, 0, 0, 0};
+    if (perf)
+    {
+        perfStart = perf->read();
+    }
+    unsigned long long allocations = threadAllocations(), allocatedBytes = threadAllocatedBytes();
     Heap<AlgoScore, H> scores(td->successorSize, td->successorSize);
+    QuantileSketch sketch;
     double xM = 0.0, xBar = 0.0;
-    unsigned int xN = td->stop - td->start;
+    unsigned int xN = 0, xSuccesses = 0;
+    std::vector<GeneStats> genes;
+    std::vector<Processor::Score> chunkScores;
+    Processor::Response unknown = {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+    std::vector<Processor::Response> chunkResponses;
+    std::vector<Algo*> children;
+    void* rng = NULL;
     double *popM = td->popM, *popBar = td->popBar;
     unsigned int* popN = td->popN;
-    for(unsigned int i = td->start; i < td->stop; i++)
+    while (true)
+    {
+        double fetchStart = monotonicTime();
+        unsigned int start = __sync_fetch_and_add(td->next, td->chunkSize);
+        double fetchStop = monotonicTime();
+        td->overhead += fetchStop - fetchStart;
+        if (start >= td->stop)
+        {
+            break;
+        }
+        unsigned int stop = std::min(start + td->chunkSize, td->stop);
+        td->chunks++;
+        chunkScores.resize(stop - start);
+        chunkResponses.resize(stop - start, unknown);
+        Algo* const* chunk;
+        if (td->parents)
+        {
+            children.resize(stop - start);
+            if (!rng)
+            {
+                rng = rng_create(td->seed);
+            }
+            void* previous = rng_select(rng);
+            for(unsigned int i = start; i < stop; i++)
+            {
+                rng_reseed(rng, td->seed + i);
+                children[i - start] = breed(td, i);
+            }
+            rng_select(previous);
+            chunk = &children[0];
+        }
+        else
+        {
+            chunk = &(*td->population)[start];
+        }
+        if (td->responses)
+        {
+            td->processor->processResponses(chunk, stop - start, &chunkScores[0], &chunkResponses[0]);
+        }
+        else
+        {
+            td->processor->processBatch(chunk, stop - start, &chunkScores[0]);
+        }
+        for(unsigned int i = start; i < stop; i++)
+        {
+            Algo* algo = chunk[i - start];
+            AlgoScore as;
+            as.algo = algo;
+            as.score = chunkScores[i - start];
+            as.response = chunkResponses[i - start];
+            sketch.insert(as.score.score);
+            xSuccesses += as.score.success;
+            std::vector<double> g = algo->getGenes();
+            genes.resize(g.size());
+            for(unsigned int j = 0; j < g.size(); j++)
+            {
+                genes[j].insert(g[j]);
+            }
+            xN++;
+            double delta = as.score.score - xBar;
+            xBar += delta / xN;
+            xM += delta * (as.score.score - xBar);
+            // Last, a streamed algorithm may be deleted here
+            if (td->parents)
+            {
+                insertOwned(scores, as, td->successorSize);
+            }
+            else
+            {
+                scores.Insert(as);
+            }
+        }
+        double chunkEnd = monotonicTime();
+        td->busy += chunkEnd - fetchStop;
+        traceEvent("evaluate", fetchStop, chunkEnd, start);
+    }
+    td->evalEnd = monotonicTime();
+    if (perf)
+    {
+        perfEval = perf->read();
+    }
+    if (rng)
     {
-        Algo* algo = td->population->at(i);
-        AlgoScore as;
-        as.algo = algo;
-        as.score = td->processor->process(algo);
-        scores.Insert(as);
-        double delta = as.score.score - xBar;
-        xBar += delta / (i - td->start + 1);
-        xM += delta * (as.score.score - xBar);
+        rng_destroy(rng);
     }
 
     pthread_mutex_lock(td->mutex);
-    if (*popN == 0)
+    double mergeStart = monotonicTime();
+    td->lockWait = mergeStart - td->evalEnd;
+    traceEvent("lock wait", td->evalEnd, mergeStart);
+    if (xN == 0)
+    {
+        // Nothing left by the time this thread started
+    }
+    else if (*popN == 0)
     {
         *popM = xM;
         *popBar = xBar;
@@ -96,11 +296,145 @@ template<typename H> void* Process(void* param)
         *popBar = bar;
         *popN = n;
     }
-    for(unsigned int i = 0; i < td->successorSize; i++)
+    td->popSketch->merge(sketch);
+    *td->popSuccesses += xSuccesses;
+    if (td->popGenes->size() < genes.size())
     {
-        td->scores->Insert(scores.Pop());
+        td->popGenes->resize(genes.size());
+    }
+    for(unsigned int j = 0; j < genes.size(); j++)
+    {
+        (*td->popGenes)[j].merge(genes[j]);
+    }
+    while (scores.Size() > 0)
+    {
+        if (td->parents)
+        {
+            insertOwned(*td->scores, scores.Pop(), td->successorSize);
+        }
+        else
+        {
+            td->scores->Insert(scores.Pop());
+        }
     }
     pthread_mutex_unlock(td->mutex);
+    traceEvent("merge", mergeStart, monotonicTime());
+    td->allocations = threadAllocations() - allocations;
+    td->allocatedBytes = threadAllocatedBytes() - allocatedBytes;
+    if (perf)
+    {
+        td->perfValid = perf->available();
+        td->evalPerf = perfEval - perfStart;
+        td->mergePerf = perf->read() - perfEval;
+        delete perf;
+    }
+    return 0;
+}
+
+struct objectiveData
+{
+    const std::vector<Algo*>* population;
+    unsigned int* next;
+    unsigned int stop;
+    unsigned int chunkSize;
+    const Processor* processor;
+    unsigned int numObjectives;
+    Processor::Score* scores;
+    double* objectives;
+    double busy;
+    double overhead;
+    unsigned int chunks;
+    double evalEnd;
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+};
+
+/**
+ * Evaluation worker of God::simulatePareto()
+ * Pulls chunks off the shared cursor as Process() does and writes each
+ * algorithm's score and objectives to its own slot, so nothing is merged
+ **/
+inline void* ProcessObjectives(void* param)
+{
+    objectiveData* od = static_cast<objectiveData*>(param);
+    unsigned long long allocations = threadAllocations(), allocatedBytes = threadAllocatedBytes();
+    while (true)
+    {
+        double fetchStart = monotonicTime();
+        unsigned int start = __sync_fetch_and_add(od->next, od->chunkSize);
+        double fetchStop = monotonicTime();
+        od->overhead += fetchStop - fetchStart;
+        if (start >= od->stop)
+        {
+            break;
+        }
+        unsigned int stop = std::min(start + od->chunkSize, od->stop);
+        od->chunks++;
+        for(unsigned int i = start; i < stop; i++)
+        {
+            od->scores[i] = od->processor->processObjectives((*od->population)[i], od->objectives + (size_t) i * od->numObjectives);
+        }
+        double chunkEnd = monotonicTime();
+        od->busy += chunkEnd - fetchStop;
+        traceEvent("evaluate", fetchStop, chunkEnd, start);
+    }
+    od->evalEnd = monotonicTime();
+    od->allocations = threadAllocations() - allocations;
+    od->allocatedBytes = threadAllocatedBytes() - allocatedBytes;
+    return 0;
+}
+
+struct sampleData
+{
+    const std::vector<Algo*>* population;
+    Race* race;
+    unsigned int* next;
+    unsigned int chunkSize;
+    const Processor* processor;
+    double busy;
+    double overhead;
+    unsigned int chunks;
+    double evalEnd;
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+};
+
+/**
+ * Evaluation worker of one round of a race
+ * Pulls chunks of the racers off the shared cursor and scores each on the
+ * race's next sample
+ **/
+inline void* ProcessSamples(void* param)
+{
+    sampleData* sd = static_cast<sampleData*>(param);
+    unsigned long long allocations = threadAllocations(), allocatedBytes = threadAllocatedBytes();
+    const std::vector<unsigned int>& racers = sd->race->racers();
+    unsigned int sample = sd->race->nextSample();
+    unsigned int count = racers.size();
+    while (true)
+    {
+        double fetchStart = monotonicTime();
+        unsigned int start = __sync_fetch_and_add(sd->next, sd->chunkSize);
+        double fetchStop = monotonicTime();
+        sd->overhead += fetchStop - fetchStart;
+        if (start >= count)
+        {
+            break;
+        }
+        unsigned int stop = std::min(start + sd->chunkSize, count);
+        sd->chunks++;
+        for(unsigned int n = start; n < stop; n++)
+        {
+            unsigned int i = racers[n];
+            sd->race->record(i, sd->processor->processSample((*sd->population)[i], sample));
+        }
+        double chunkEnd = monotonicTime();
+        sd->busy += chunkEnd - fetchStop;
+        traceEvent("evaluate", fetchStop, chunkEnd, start);
+    }
+    sd->evalEnd = monotonicTime();
+    sd->allocations = threadAllocations() - allocations;
+    sd->allocatedBytes = threadAllocatedBytes() - allocatedBytes;
     return 0;
 }
 
@@ -147,6 +481,21 @@ class God
         };
 
 
+        /**
+         * Best first: success, then lower scores
+         */
+        struct eliteSort
+        {
+            bool operator() (const AlgoScore& lhs, const AlgoScore& rhs) const
+            {
+                if (lhs.score.success != rhs.score.success)
+                {
+                    return lhs.score.success;
+                }
+                return lhs.score.score < rhs.score.score;
+            }
+        };
+
         struct minScoreHeap
         {
             short operator() (const AlgoScore& lhs, const AlgoScore& rhs)
@@ -205,52 +554,211 @@ class God
             }
         };
 
-        God(const Processor& processor, const std::vector<Algo*>& seeds, unsigned int populationSize, unsigned int successorSize, unsigned int minThreadWorkloadSize, unsigned int maxNumThreads, unsigned int numCycles)
-            : m_processor(processor)
+        /**
+         * @param initialChunkSize evaluations per chunk until the tuner has measured the processor
+         * @param maxNumThreads upper bound on worker threads, 0 to use every online processor
+         */
+        God(const Processor& processor, const std::vector<Algo*>& seeds, unsigned int populationSize, unsigned int successorSize, unsigned int initialChunkSize, unsigned int maxNumThreads, unsigned int numCycles)
+            : m_processor(&processor)
+            , m_nextProcessor(NULL)
             , m_seeds(seeds)
             , m_populationSize(populationSize)
             , m_successorSize(successorSize)
-            , m_minThreadWorkloadSize(minThreadWorkloadSize)
-            , m_maxNumThreads(maxNumThreads)
+            , m_tuner(maxNumThreads, initialChunkSize)
             , m_numCycles(numCycles)
+            , m_perfCounters(false)
+            , m_logging(true)
+            , m_pool(NULL)
+            , m_poolShare(1.0)
+            , m_keepSeeds(false)
+            , m_streaming(false)
+            , m_racing(false)
+            , m_racingDelta(0.05)
+            , m_stop(false)
+        {
+            pthread_mutex_init(&m_processorMutex, NULL);
+        }
+
+        ~God()
+        {
+            pthread_mutex_destroy(&m_processorMutex);
+        }
+
+        const ThreadTuner& getTuner() const
+        {
+            return m_tuner;
+        }
+
+        ThreadTuner& getTuner()
+        {
+            return m_tuner;
+        }
+
+        /**
+         * The best algorithm of generation N is logged to <prefix>N.log
+         * @param logging false to skip writing the logs altogether
+         */
+        void setLogPrefix(const std::string& prefix, bool logging=true)
+        {
+            m_logPrefix = prefix;
+            m_logging = logging;
+        }
+
+        /**
+         * Sinks are not owned and must outlive simulate()
+         */
+        void addSink(MetricsSink* sink)
+        {
+            m_sinks.push_back(sink);
+        }
+
+        void setPerfCounters(bool enabled)
+        {
+            m_perfCounters = enabled;
+        }
+
+        /**
+         * The pool is not owned and must outlive simulate(); the tuner still
+         * picks how many workers are queued, capped by maxNumThreads
+         * @param share relative share of the pool while other clients are busy
+         */
+        void setThreadPool(ThreadPool* pool, double share=1.0)
+        {
+            m_pool = pool;
+            m_poolShare = share;
+        }
+
+        void setKeepSeeds(bool keep)
+        {
+            m_keepSeeds = keep;
+        }
+
+        /**
+         * Breeds each generation as it is evaluated instead of keeping it
+         * whole; a different but equally distributed population
+         */
+        void setStreaming(bool streaming)
+        {
+            m_streaming = streaming;
+        }
+
+        /**
+         * Races each generation over the processor's samples instead of
+         * scoring every algorithm on all of them; needs a processor with
+         * more than one sample, and not streaming
+         * @param delta chance that one comparison of two algorithms is wrong
+         */
+        void setRacing(bool racing, double delta=0.05)
         {
+            m_racing = racing;
+            m_racingDelta = delta;
+        }
+
+        /**
+         * Thread-safe, the processor must outlive simulate()
+         */
+        void setProcessor(const Processor& processor)
+        {
+            pthread_mutex_lock(&m_processorMutex);
+            m_nextProcessor = &processor;
+            pthread_mutex_unlock(&m_processorMutex);
+        }
+
+        /**
+         * Thread-safe and async-signal-safe
+         */
+        void stop()
+        {
+            m_stop = true;
+        }
+
+        /**
+         * Successors of the last completed generation with their scores
+         */
+        const std::vector<SavedAlgo>& getSuccessors() const
+        {
+            return m_successors;
         }
 
 
         template<typename H, typename C> AlgoScore simulate()
         {
-            std::vector<Algo*> population(m_populationSize);
+            std::vector<Algo*> population(m_streaming ? 0 : m_populationSize);
+            std::vector<Algo*> parents;
             Heap<AlgoScore, H> scores(m_successorSize, m_successorSize);
+            QuantileSketch popSketch;
             std::vector<AlgoScore> algoscores(m_successorSize);
-            unsigned int numThreads = m_populationSize / m_minThreadWorkloadSize;
-            if (numThreads > m_maxNumThreads)
-            {
-                numThreads = m_maxNumThreads;
-            }
-            std::vector<pthread_t> threads(numThreads);
-            std::vector<threadData<H> > threadDatas(numThreads);
+            std::vector<pthread_t> threads(m_tuner.maxNumThreads());
+            std::vector<threadData<H> > threadDatas(m_tuner.maxNumThreads());
             pthread_attr_t attr;
             pthread_attr_init(&attr);
             pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
             pthread_mutex_t mutex;
             pthread_mutex_init(&mutex, NULL);
             AlgoScore* best = NULL;
-            double prevAvg = 0.0, prevBest = 0.0;
+            PerfCounters* perf = m_perfCounters ? new PerfCounters : NULL;
+            ThreadPool::Client* client = m_pool ? m_pool->addClient(m_poolShare) : NULL;
             for(unsigned int i = 1; i <= m_numCycles; i++)
             {
                 double popM = 0.0, popBar = 0.0;
-                unsigned int popN = 0;
-                printf("Generation %d/%d\n",i,m_numCycles);
-                if (i == 1)
+                unsigned int popN = 0, popSuccesses = 0;
+                popSketch.clear();
+                GenerationStats stats;
+                unsigned long long allocations = threadAllocations(), allocatedBytes = threadAllocatedBytes();
+                stats.perfValid = perf && perf->available();
+                PerfSample perfMark = {0, 0, 0, 0};
+                for(unsigned int j = 0; j < GenerationStats::numPhases; j++)
+                {
+                    stats.perf[j] = perfMark;
+                }
+                if (perf)
+                {
+                    perfMark = perf->read();
+                }
+                double breedStart = monotonicTime();
+                pthread_mutex_lock(&m_processorMutex);
+                if (m_nextProcessor)
+                {
+                    m_processor = m_nextProcessor;
+                    m_nextProcessor = NULL;
+                }
+                pthread_mutex_unlock(&m_processorMutex);
+                // Every algorithm, the elite included, is scored again anyway
+                m_processor->beginGeneration(i);
+                const Algo* elite = NULL;
+                unsigned int numKept = 0;
+                unsigned long seed = 0;
+                if (m_streaming)
+                {
+                    parents.clear();
+                    if (i == 1)
+                    {
+                        parents = m_seeds;
+                        numKept = m_keepSeeds ? std::min((unsigned int) m_seeds.size(), m_populationSize) : 0;
+                    }
+                    else
+                    {
+                        for(unsigned int j = 0; j < m_successorSize; j++)
+                        {
+                            parents.push_back(algoscores[j].algo);
+                        }
+                        elite = best->algo;
+                    }
+                    seed = (unsigned long) (randf() * 4294967296.0);
+                }
+                else if (i == 1)
                 {
                     unsigned int numSeeds = m_seeds.size();
                     for(unsigned int j = 0; j < m_populationSize; j++)
                     {
-                        population[j] = m_seeds[j%numSeeds]->gen();
+                        population[j] = m_keepSeeds && j < numSeeds ? m_seeds[j] : m_seeds[j%numSeeds]->gen();
                     }
                     for(unsigned int j = 0; j < m_seeds.size(); j++)
                     {
-                        delete m_seeds[j];
+                        if (!m_keepSeeds || j >= m_populationSize)
+                        {
+                            delete m_seeds[j];
+                        }
                         m_seeds[j] = 0;
                     }
                 }
@@ -275,52 +783,178 @@ class God
 
                 scores.Flush();
 
-                for(unsigned int j = 0; j < numThreads; j++)
+                bool race = m_racing && !m_streaming && m_processor->numSamples() > 1;
+                unsigned int numThreads = std::min(m_tuner.numThreads(), m_populationSize);
+                unsigned int next = 0;
+                double evalStart = monotonicTime();
+                stats.breedTime = evalStart - breedStart;
+                traceEvent("breed", breedStart, evalStart, i);
+                if (perf)
+                {
+                    PerfSample now = perf->read();
+                    stats.perf[GenerationStats::breedPhase] = now - perfMark;
+                    perfMark = now;
+                }
+                double busy = 0.0, overhead = 0.0, evalEnd = evalStart;
+                unsigned int chunks = 0;
+                unsigned long long workerAllocations = 0, workerAllocatedBytes = 0;
+                stats.lockWait = 0.0;
+                stats.samplesUsed = 1.0;
+                if (race)
+                {
+                    // Only the thread fields, the perf counters are not split by round
+                    stats.perfValid = false;
+                    evalEnd = evaluateRace(population, scores, client, stats, popM, popBar, popSketch, popSuccesses, workerAllocations, workerAllocatedBytes);
+                }
+                else
                 {
-                    threadData<H> td = {&population, j * m_populationSize / numThreads, (j + 1) * m_populationSize / numThreads, m_successorSize, &m_processor, &mutex, &scores, &popM, &popBar, &popN};
-                    if (j == numThreads-1)
+                    for(unsigned int j = 0; j < numThreads; j++)
+                    {
+                        threadData<H> td = {&population, m_streaming ? &parents : NULL, elite, numKept, seed, &next, m_populationSize, m_tuner.chunkSize(), m_successorSize, m_processor, m_processor->hasResponse(), &mutex, &scores, &popM, &popBar, &popN, &popSketch, &popSuccesses, &stats.genes, 0.0, 0.0, 0, 0.0, evalStart, 0, 0, m_perfCounters, false, perfMark, perfMark};
+                        threadDatas[j] = td;
+                        if (client)
+                        {
+                            m_pool->submit(client, Process<H>, (void*) (&threadDatas[j]));
+                        }
+                        else
+                        {
+                            pthread_create(&threads[j], &attr, Process<H>, (void*) (&threadDatas[j]));
+                        }
+                    }
+                    if (client)
+                    {
+                        m_pool->wait(client);
+                    }
+                    stats.threadBusy.resize(numThreads);
+                    for(unsigned int j = 0; j < numThreads; j++)
                     {
-                        td.stop = m_populationSize;
+                        if (!client)
+                        {
+                            void* status;
+                            pthread_join(threads[j], &status);
+                        }
+                        const threadData<H>& td = threadDatas[j];
+                        busy += td.busy;
+                        overhead += td.overhead;
+                        chunks += td.chunks;
+                        evalEnd = std::max(evalEnd, td.evalEnd);
+                        stats.threadBusy[j] = td.busy;
+                        stats.lockWait += td.lockWait;
+                        workerAllocations += td.allocations;
+                        workerAllocatedBytes += td.allocatedBytes;
+                        stats.perfValid = stats.perfValid && td.perfValid;
+                        stats.perf[GenerationStats::evaluatePhase] += td.evalPerf;
+                        stats.perf[GenerationStats::mergePhase] += td.mergePerf;
                     }
-                    threadDatas[j] = td;
-                    pthread_create(&threads[j], &attr, Process<H>, (void*) (&threadDatas[j]));
+                    stats.chunkSize = threadDatas[0].chunkSize;
                 }
-                for(unsigned int j = 0; j < numThreads; j++)
+                if (perf)
+                {
+                    // The joining thread is idle in pthread_join, only worker counts matter
+                    perfMark = perf->read();
+                }
+                double selectStart = monotonicTime();
+                stats.evaluateTime = evalEnd - evalStart;
+                stats.mergeTime = selectStart - evalEnd;
+                stats.evaluationsPerSecond = m_populationSize / (selectStart - evalStart);
+                if (!race)
                 {
-                    void* status;
-                    pthread_join(threads[j], &status);
+                    // A race records each of its rounds
+                    m_tuner.record(m_populationSize, chunks, selectStart - evalStart, busy, overhead);
                 }
 
                 for(unsigned int j = 0; j < m_successorSize; j++)
                 {
                     algoscores[j] = scores.Pop();
                 }
+                if (m_streaming)
+                {
+                    // Only clones of the parents can have been kept
+                    for(unsigned int j = 0; j < parents.size(); j++)
+                    {
+                        delete parents[j];
+                    }
+                    if (i == 1)
+                    {
+                        for(unsigned int j = 0; j < m_seeds.size(); j++)
+                        {
+                            m_seeds[j] = 0;
+                        }
+                    }
+                }
                 best = &(*max_element(algoscores.begin(), algoscores.end(), m_sorter));
+                m_successors.resize(m_successorSize);
+                for(unsigned int j = 0; j < m_successorSize; j++)
+                {
+                    m_successors[j].score = algoscores[j].score;
+                    m_successors[j].genes = algoscores[j].algo->getGenes();
+                }
+
+                stats.generation = i;
+                stats.numGenerations = m_numCycles;
+                stats.populationSize = m_populationSize;
+                stats.mu = popBar;
+                stats.sigma = sqrt(popM/m_populationSize);
+                stats.p10 = popSketch.quantile(0.1);
+                stats.median = popSketch.quantile(0.5);
+                stats.p90 = popSketch.quantile(0.9);
+                stats.successRate = (double) popSuccesses / m_populationSize;
+                stats.bestSuccess = best->score.success;
+                stats.bestScore = best->score.score;
+                stats.bestSummary = best->algo->getSummary();
+                std::vector<std::string> geneNames = best->algo->getGeneNames();
+                for(unsigned int j = 0; j < stats.genes.size() && j < geneNames.size(); j++)
+                {
+                    stats.genes[j].name = geneNames[j];
+                }
+                stats.responseValid = m_processor->hasResponse() && !race;
+                stats.bestResponse = best->response;
+                if (stats.responseValid)
+                {
+                    std::vector<AlgoScore> elites(algoscores);
+                    std::sort(elites.begin(), elites.end(), m_eliteSorter);
+                    stats.elites.resize(m_successorSize);
+                    for(unsigned int j = 0; j < m_successorSize; j++)
+                    {
+                        stats.elites[j] = elites[j].response;
+                    }
+                }
 
-                double sigma = sqrt(popM/m_populationSize);
-
-                printf("Average performance of population %d:\n", m_populationSize);
-                printf("mu: %f sigma: %f\n", popBar, sigma);
-                printf("Best Algo:\n");
-                printf("%s",best->algo->getSummary().c_str());
-                printf("\n");
-                printf("Success: %d Score: %f\n", best->score.success, best->score.score);
-                printf("\n");
-                printf("%% above avg: %f\n", -(best->score.score-popBar)/popBar*100.0);
-                printf("Std above avg: %f\n", -(best->score.score-popBar)/sigma);
-                printf("%% score change from prev: avg: %f best: %f\n", -(popBar - prevAvg) / prevAvg * 100.0, -(best->score.score - prevBest) / prevBest * 100.0);
-                std::stringstream ss;
-                ss << i << ".log";
-                m_processor.process(best->algo, ss.str());
-                printf("\n");
-
-                prevBest = best->score.score;
-                prevAvg = popBar;
+                double logStart = monotonicTime();
+                stats.selectTime = logStart - selectStart;
+                traceEvent("select", selectStart, logStart, i);
+                if (perf)
+                {
+                    PerfSample now = perf->read();
+                    stats.perf[GenerationStats::selectPhase] = now - perfMark;
+                    perfMark = now;
+                }
+                if (m_logging)
+                {
+                    std::stringstream ss;
+                    ss << m_logPrefix << i << ".log";
+                    m_processor->process(best->algo, ss.str());
+                }
+                double logEnd = monotonicTime();
+                stats.logTime = logEnd - logStart;
+                if (perf)
+                {
+                    stats.perf[GenerationStats::logPhase] = perf->read() - perfMark;
+                }
+
+                stats.allocations = threadAllocations() - allocations + workerAllocations;
+                stats.allocatedBytes = threadAllocatedBytes() - allocatedBytes + workerAllocatedBytes;
+                stats.peakRssKb = peakRssKb();
+                for(unsigned int j = 0; j < m_sinks.size(); j++)
+                {
+                    m_sinks[j]->record(stats);
+                }
+                traceEvent("log", logStart, monotonicTime(), i);
 
                 C complete;
-                if (complete(algoscores, i))
+                if (m_stop || complete(algoscores, i))
                 {
-                    for(unsigned int j = 0; j < m_populationSize; j++)
+                    for(unsigned int j = 0; j < population.size(); j++)
                     {
                         if (population[j] != best->algo)
                         {
@@ -328,12 +962,24 @@ class God
                             population[j] = NULL;
                         }
                     }
+                    for(unsigned int j = 0; m_streaming && j < m_successorSize; j++)
+                    {
+                        if (algoscores[j].algo != best->algo)
+                        {
+                            delete algoscores[j].algo;
+                        }
+                    }
+                    delete perf;
+                    if (client)
+                    {
+                        m_pool->removeClient(client);
+                    }
                     return *best;
                 }
             }
 
             AlgoScore& winner = *max_element(algoscores.begin(), algoscores.end(), m_sorter);
-            for(unsigned int j = 0; j < m_populationSize; j++)
+            for(unsigned int j = 0; j < population.size(); j++)
             {
                 if (population[j] != winner.algo)
                 {
@@ -341,18 +987,433 @@ class God
                     population[j] = NULL;
                 }
             }
+            for(unsigned int j = 0; m_streaming && j < m_successorSize; j++)
+            {
+                if (algoscores[j].algo != winner.algo)
+                {
+                    delete algoscores[j].algo;
+                }
+            }
+            delete perf;
+            if (client)
+            {
+                m_pool->removeClient(client);
+            }
             return winner;
         }
 
+        /**
+         * NSGA-II on the objectives of the processor, see Pareto.hpp
+         * Each generation breeds populationSize children by binary
+         * tournament on the crowded comparison, scores them and keeps the
+         * best populationSize of parents and children: whole fronts first,
+         * then the least crowded of the front that does not fit. Failed
+         * algorithms rank behind every successful one. Successors are the
+         * first front; successorSize is not used. Parents are scored again
+         * after setProcessor() and when beginGeneration() says so
+         * @return first front of the last generation in order of the first
+         * objective, owned by the caller
+         */
+        std::vector<ParetoPoint> simulatePareto()
+        {
+            std::vector<Algo*> population;
+            std::vector<Processor::Score> scores;
+            std::vector<double> objectives;
+            std::vector<unsigned int> ranks;
+            std::vector<double> crowding;
+            std::vector<unsigned int> front;
+            unsigned int numObjectives = 0;
+            ThreadPool::Client* client = m_pool ? m_pool->addClient(m_poolShare) : NULL;
+            for(unsigned int i = 1; i <= m_numCycles; i++)
+            {
+                GenerationStats stats;
+                unsigned long long allocations = threadAllocations(), allocatedBytes = threadAllocatedBytes();
+                stats.perfValid = false;
+                PerfSample perfZero = {0, 0, 0, 0};
+                for(unsigned int j = 0; j < GenerationStats::numPhases; j++)
+                {
+                    stats.perf[j] = perfZero;
+                }
+                double breedStart = monotonicTime();
+                pthread_mutex_lock(&m_processorMutex);
+                bool swapped = m_nextProcessor != NULL;
+                if (swapped)
+                {
+                    m_processor = m_nextProcessor;
+                    m_nextProcessor = NULL;
+                }
+                pthread_mutex_unlock(&m_processorMutex);
+                unsigned int evaluateFrom = m_populationSize;
+                if (i == 1)
+                {
+                    unsigned int numSeeds = m_seeds.size();
+                    population.resize(m_populationSize);
+                    for(unsigned int j = 0; j < m_populationSize; j++)
+                    {
+                        population[j] = m_keepSeeds && j < numSeeds ? m_seeds[j] : m_seeds[j%numSeeds]->gen();
+                    }
+                    for(unsigned int j = 0; j < m_seeds.size(); j++)
+                    {
+                        if (!m_keepSeeds || j >= m_populationSize)
+                        {
+                            delete m_seeds[j];
+                        }
+                        m_seeds[j] = 0;
+                    }
+                    evaluateFrom = 0;
+                }
+                else
+                {
+                    crowdedOrder better = {&ranks[0], &crowding[0]};
+                    for(unsigned int j = 0; j < m_populationSize; j++)
+                    {
+                        unsigned int a = std::min((unsigned int) (randf() * m_populationSize), m_populationSize - 1);
+                        unsigned int b = std::min((unsigned int) (randf() * m_populationSize), m_populationSize - 1);
+                        population.push_back(population[better(b, a) ? b : a]->gen());
+                    }
+                    if (swapped)
+                    {
+                        evaluateFrom = 0;
+                    }
+                }
+                if (m_processor->beginGeneration(i))
+                {
+                    evaluateFrom = 0;
+                }
+                if (numObjectives != m_processor->numObjectives())
+                {
+                    numObjectives = m_processor->numObjectives();
+                    evaluateFrom = 0;
+                }
+                unsigned int count = population.size();
+                scores.resize(count);
+                objectives.resize((size_t) count * numObjectives);
+
+                double evalStart = monotonicTime();
+                stats.breedTime = evalStart - breedStart;
+                traceEvent("breed", breedStart, evalStart, i);
+                unsigned long long workerAllocations = 0, workerAllocatedBytes = 0;
+                double evalEnd = evaluateObjectives(population, evaluateFrom, &scores[0], &objectives[0], numObjectives, client, stats, workerAllocations, workerAllocatedBytes);
+
+                double selectStart = monotonicTime();
+                stats.evaluateTime = evalEnd - evalStart;
+                stats.mergeTime = selectStart - evalEnd;
+                stats.evaluationsPerSecond = (count - evaluateFrom) / (selectStart - evalStart);
+                stats.samplesUsed = 1.0;
+                ranks.resize(count);
+                crowding.resize(count);
+                unsigned int numFronts = constrainedSort(&objectives[0], &scores[0], count, numObjectives, &ranks[0]);
+                crowdingDistances(&objectives[0], count, numObjectives, &ranks[0], numFronts, m_tuner.maxNumThreads(), &crowding[0]);
+                if (count > m_populationSize)
+                {
+                    std::vector<unsigned int> order(count);
+                    for(unsigned int j = 0; j < count; j++)
+                    {
+                        order[j] = j;
+                    }
+                    crowdedOrder better = {&ranks[0], &crowding[0]};
+                    std::sort(order.begin(), order.end(), better);
+                    std::vector<Algo*> keptPopulation(m_populationSize);
+                    std::vector<Processor::Score> keptScores(m_populationSize);
+                    std::vector<double> keptObjectives((size_t) m_populationSize * numObjectives);
+                    std::vector<unsigned int> keptRanks(m_populationSize);
+                    std::vector<double> keptCrowding(m_populationSize);
+                    for(unsigned int j = 0; j < count; j++)
+                    {
+                        unsigned int k = order[j];
+                        if (j >= m_populationSize)
+                        {
+                            delete population[k];
+                            continue;
+                        }
+                        keptPopulation[j] = population[k];
+                        keptScores[j] = scores[k];
+                        std::copy(&objectives[(size_t) k * numObjectives], &objectives[(size_t) k * numObjectives] + numObjectives, &keptObjectives[(size_t) j * numObjectives]);
+                        keptRanks[j] = ranks[k];
+                        keptCrowding[j] = crowding[k];
+                    }
+                    population.swap(keptPopulation);
+                    scores.swap(keptScores);
+                    objectives.swap(keptObjectives);
+                    ranks.swap(keptRanks);
+                    crowding.swap(keptCrowding);
+                }
+
+                front.clear();
+                unsigned int best = 0;
+                for(unsigned int j = 0; j < m_populationSize; j++)
+                {
+                    if (ranks[j] == 0)
+                    {
+                        front.push_back(j);
+                    }
+                    const Processor::Score& l = scores[j];
+                    const Processor::Score& r = scores[best];
+                    if (l.success != r.success ? l.success : l.score < r.score)
+                    {
+                        best = j;
+                    }
+                }
+                objectiveOrder byFirst = {&objectives[0], numObjectives, 0};
+                std::sort(front.begin(), front.end(), byFirst);
+                m_successors.resize(front.size());
+                for(unsigned int j = 0; j < front.size(); j++)
+                {
+                    m_successors[j].score = scores[front[j]];
+                    m_successors[j].genes = population[front[j]]->getGenes();
+                }
+
+                QuantileSketch sketch;
+                double xM = 0.0, xBar = 0.0;
+                unsigned int xN = 0, xSuccesses = 0;
+                for(unsigned int j = 0; j < m_populationSize; j++)
+                {
+                    double score = scores[j].score;
+                    sketch.insert(score);
+                    xSuccesses += scores[j].success;
+                    std::vector<double> g = population[j]->getGenes();
+                    stats.genes.resize(g.size());
+                    for(unsigned int k = 0; k < g.size(); k++)
+                    {
+                        stats.genes[k].insert(g[k]);
+                    }
+                    xN++;
+                    double delta = score - xBar;
+                    xBar += delta / xN;
+                    xM += delta * (score - xBar);
+                }
+                stats.generation = i;
+                stats.numGenerations = m_numCycles;
+                stats.populationSize = m_populationSize;
+                stats.mu = xBar;
+                stats.sigma = sqrt(xM / m_populationSize);
+                stats.p10 = sketch.quantile(0.1);
+                stats.median = sketch.quantile(0.5);
+                stats.p90 = sketch.quantile(0.9);
+                stats.successRate = (double) xSuccesses / m_populationSize;
+                stats.bestSuccess = scores[best].success;
+                stats.bestScore = scores[best].score;
+                stats.bestSummary = population[best]->getSummary();
+                stats.responseValid = false;
+                std::vector<std::string> geneNames = population[best]->getGeneNames();
+                for(unsigned int j = 0; j < stats.genes.size() && j < geneNames.size(); j++)
+                {
+                    stats.genes[j].name = geneNames[j];
+                }
+
+                double logStart = monotonicTime();
+                stats.selectTime = logStart - selectStart;
+                traceEvent("select", selectStart, logStart, i);
+                if (m_logging)
+                {
+                    std::stringstream ss;
+                    ss << m_logPrefix << i << ".log";
+                    m_processor->process(population[best], ss.str());
+                }
+                double logEnd = monotonicTime();
+                stats.logTime = logEnd - logStart;
+                stats.allocations = threadAllocations() - allocations + workerAllocations;
+                stats.allocatedBytes = threadAllocatedBytes() - allocatedBytes + workerAllocatedBytes;
+                stats.peakRssKb = peakRssKb();
+                for(unsigned int j = 0; j < m_sinks.size(); j++)
+                {
+                    m_sinks[j]->record(stats);
+                }
+                traceEvent("log", logStart, monotonicTime(), i);
+                if (m_stop)
+                {
+                    break;
+                }
+            }
+
+            std::vector<ParetoPoint> points(front.size());
+            std::vector<bool> inFront(population.size(), false);
+            for(unsigned int j = 0; j < front.size(); j++)
+            {
+                unsigned int k = front[j];
+                points[j].algo = population[k];
+                points[j].score = scores[k];
+                points[j].objectives.assign(&objectives[(size_t) k * numObjectives], &objectives[(size_t) k * numObjectives] + numObjectives);
+                inFront[k] = true;
+            }
+            for(unsigned int j = 0; j < population.size(); j++)
+            {
+                if (!inFront[j])
+                {
+                    delete population[j];
+                }
+            }
+            if (client)
+            {
+                m_pool->removeClient(client);
+            }
+            return points;
+        }
+
     private:
-        const Processor& m_processor;
+        /**
+         * Runs worker on each of datas, as pool tasks if there is a client
+         * and as threads otherwise, and waits for all of them
+         */
+        template<typename T> void runWorkers(void* (*worker)(void*), std::vector<T>& datas, ThreadPool::Client* client)
+        {
+            std::vector<pthread_t> threads(datas.size());
+            for(unsigned int j = 0; j < datas.size(); j++)
+            {
+                if (client)
+                {
+                    m_pool->submit(client, worker, (void*) (&datas[j]));
+                }
+                else
+                {
+                    pthread_create(&threads[j], NULL, worker, (void*) (&datas[j]));
+                }
+            }
+            if (client)
+            {
+                m_pool->wait(client);
+                return;
+            }
+            for(unsigned int j = 0; j < datas.size(); j++)
+            {
+                pthread_join(threads[j], NULL);
+            }
+        }
+
+        /**
+         * Races the population over the processor's samples, one round per
+         * sample on the tuned number of threads or pool tasks. Every
+         * algorithm goes into the population statistics with the mean of
+         * the samples it was scored on, and those not dropped into scores
+         * @return when the last round finished
+         */
+        template<typename H> double evaluateRace(const std::vector<Algo*>& population, Heap<AlgoScore, H>& scores, ThreadPool::Client* client, GenerationStats& stats, double& popM, double& popBar, QuantileSketch& popSketch, unsigned int& popSuccesses, unsigned long long& allocations, unsigned long long& allocatedBytes)
+        {
+            unsigned int count = population.size();
+            unsigned int numSamples = m_processor->numSamples();
+            Race race(count, numSamples, m_successorSize, m_racingDelta);
+            double evalEnd = monotonicTime();
+            stats.threadBusy.clear();
+            stats.chunkSize = m_tuner.chunkSize();
+            while (race.racers().size())
+            {
+                unsigned int numRacers = race.racers().size();
+                unsigned int numThreads = std::max(std::min(m_tuner.numThreads(), numRacers), 1U);
+                unsigned int next = 0;
+                double roundStart = monotonicTime();
+                std::vector<sampleData> sds(numThreads);
+                for(unsigned int j = 0; j < numThreads; j++)
+                {
+                    sampleData sd = {&population, &race, &next, m_tuner.chunkSize(), m_processor, 0.0, 0.0, 0, roundStart, 0, 0};
+                    sds[j] = sd;
+                }
+                runWorkers(ProcessSamples, sds, client);
+                double busy = 0.0, overhead = 0.0;
+                unsigned int chunks = 0;
+                stats.threadBusy.resize(std::max((unsigned int) stats.threadBusy.size(), numThreads), 0.0);
+                for(unsigned int j = 0; j < numThreads; j++)
+                {
+                    busy += sds[j].busy;
+                    overhead += sds[j].overhead;
+                    chunks += sds[j].chunks;
+                    evalEnd = std::max(evalEnd, sds[j].evalEnd);
+                    stats.threadBusy[j] += sds[j].busy;
+                    allocations += sds[j].allocations;
+                    allocatedBytes += sds[j].allocatedBytes;
+                }
+                m_tuner.record(numRacers, chunks, monotonicTime() - roundStart, busy, overhead);
+                race.update();
+            }
+
+            Processor::Response unknown = {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+            for(unsigned int i = 0; i < count; i++)
+            {
+                AlgoScore as;
+                as.algo = population[i];
+                as.score = race.score(i);
+                as.response = unknown;
+                popSketch.insert(as.score.score);
+                popSuccesses += as.score.success;
+                std::vector<double> g = as.algo->getGenes();
+                stats.genes.resize(g.size());
+                for(unsigned int j = 0; j < g.size(); j++)
+                {
+                    stats.genes[j].insert(g[j]);
+                }
+                double delta = as.score.score - popBar;
+                popBar += delta / (i + 1);
+                popM += delta * (as.score.score - popBar);
+                if (!race.dropped(i))
+                {
+                    scores.Insert(as);
+                }
+            }
+            stats.samplesUsed = (double) race.samplesScored() / ((double) count * numSamples);
+            return evalEnd;
+        }
+
+        /**
+         * Scores population[from..] on the tuned number of threads or pool
+         * tasks, filling the thread fields of stats and the tuner's record
+         * @return when the last worker finished
+         */
+        double evaluateObjectives(const std::vector<Algo*>& population, unsigned int from, Processor::Score* scores, double* objectives, unsigned int numObjectives, ThreadPool::Client* client, GenerationStats& stats, unsigned long long& allocations, unsigned long long& allocatedBytes)
+        {
+            unsigned int count = population.size();
+            unsigned int numThreads = std::max(std::min(m_tuner.numThreads(), count - from), 1U);
+            unsigned int next = from;
+            double evalStart = monotonicTime();
+            std::vector<objectiveData> ods(numThreads);
+            for(unsigned int j = 0; j < numThreads; j++)
+            {
+                objectiveData od = {&population, &next, count, m_tuner.chunkSize(), m_processor, numObjectives, scores, objectives, 0.0, 0.0, 0, evalStart, 0, 0};
+                ods[j] = od;
+            }
+            runWorkers(ProcessObjectives, ods, client);
+            double busy = 0.0, overhead = 0.0, evalEnd = evalStart;
+            unsigned int chunks = 0;
+            stats.lockWait = 0.0;
+            stats.threadBusy.resize(numThreads);
+            for(unsigned int j = 0; j < numThreads; j++)
+            {
+                busy += ods[j].busy;
+                overhead += ods[j].overhead;
+                chunks += ods[j].chunks;
+                evalEnd = std::max(evalEnd, ods[j].evalEnd);
+                stats.threadBusy[j] = ods[j].busy;
+                allocations += ods[j].allocations;
+                allocatedBytes += ods[j].allocatedBytes;
+            }
+            stats.chunkSize = ods[0].chunkSize;
+            if (count > from)
+            {
+                m_tuner.record(count - from, chunks, monotonicTime() - evalStart, busy, overhead);
+            }
+            return evalEnd;
+        }
+
+        const Processor* m_processor;
+        const Processor* m_nextProcessor;
+        pthread_mutex_t m_processorMutex;
         std::vector<Algo*> m_seeds;
         unsigned int m_populationSize;
         unsigned int m_successorSize;
-        unsigned int m_minThreadWorkloadSize;
-        unsigned int m_maxNumThreads;
+        ThreadTuner m_tuner;
         unsigned int m_numCycles;
+        std::vector<MetricsSink*> m_sinks;
+        bool m_perfCounters;
+        bool m_logging;
+        std::string m_logPrefix;
+        ThreadPool* m_pool;
+        double m_poolShare;
+        bool m_keepSeeds;
+        bool m_streaming;
+        bool m_racing;
+        double m_racingDelta;
+        volatile bool m_stop;
+        std::vector<SavedAlgo> m_successors;
         algoScoreSort m_sorter;
+        eliteSort m_eliteSorter;
 };
 
 #endif // GOD_HPP
@@ -0,0 +1,361 @@
+/*
+ *  IsolatedProcessor.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "IsolatedProcessor.hpp"
+
+#include "Algo.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <sstream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Slot states
+static const int s_pending = 0;
+static const int s_claimed = 1;
+static const int s_done = 2;
+
+// How often the parent looks for dead and overrunning workers
+static const double s_superviseInterval = 0.01;
+
+struct IsolatedProcessor::Shared
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    unsigned int count;
+    unsigned int next;
+    unsigned int remaining;
+    unsigned int numRequeued;
+    bool stop;
+};
+
+struct IsolatedProcessor::Slot
+{
+    Processor::Score score;
+    int state;
+    pid_t owner;
+    unsigned int attempts;
+    double claimed;
+};
+
+static void recover(int result, pthread_mutex_t* mutex)
+{
+#ifdef __linux__
+    if (result == EOWNERDEAD)
+    {
+        // A worker died holding the lock, every update under it is a single store
+        pthread_mutex_consistent(mutex);
+    }
+#endif
+}
+
+IsolatedProcessor::IsolatedProcessor(const Processor& processor, const Algo& prototype, unsigned int numWorkers, unsigned int capacity, double timeout, unsigned int maxAttempts, unsigned int recycle)
+    : m_processor(processor)
+    , m_prototype(prototype.clone(prototype.getGenes()))
+    , m_numGenes(prototype.getGenes().size())
+    , m_capacity(capacity > 0 ? capacity : 1)
+    , m_timeout(timeout)
+    , m_maxAttempts(maxAttempts > 0 ? maxAttempts : 1)
+    , m_recycle(recycle)
+    , m_mapSize(0)
+    , m_shared(NULL)
+    , m_workers(numWorkers > 0 ? numWorkers : 1, 0)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    pthread_mutex_init(&m_batchMutex, NULL);
+}
+
+IsolatedProcessor::~IsolatedProcessor()
+{
+    if (m_shared)
+    {
+        lock();
+        m_shared->stop = true;
+        pthread_cond_broadcast(&m_shared->work);
+        pthread_mutex_unlock(&m_shared->mutex);
+        for(unsigned int i = 0; i < m_workers.size(); i++)
+        {
+            if (m_workers[i] > 0)
+            {
+                waitpid(m_workers[i], NULL, 0);
+            }
+        }
+        pthread_cond_destroy(&m_shared->work);
+        pthread_cond_destroy(&m_shared->done);
+        pthread_mutex_destroy(&m_shared->mutex);
+        munmap(m_shared, m_mapSize);
+    }
+    pthread_mutex_destroy(&m_batchMutex);
+    delete m_prototype;
+}
+
+bool IsolatedProcessor::start(std::string& error)
+{
+    m_mapSize = sizeof(Shared) + m_capacity * (sizeof(Slot) + m_numGenes * sizeof(double) + sizeof(unsigned int));
+    void* map = mmap(NULL, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+    {
+        std::stringstream ss;
+        ss << "cannot map " << m_mapSize << " bytes for " << m_capacity << " isolated slots";
+        error = ss.str();
+        return false;
+    }
+    m_shared = static_cast<Shared*>(map);
+    m_slots = reinterpret_cast<Slot*>(m_shared + 1);
+    m_genes = reinterpret_cast<double*>(m_slots + m_capacity);
+    m_requeued = reinterpret_cast<unsigned int*>(m_genes + m_capacity * m_numGenes);
+
+    pthread_mutexattr_t mutexAttr;
+    pthread_mutexattr_init(&mutexAttr);
+    pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+    pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&m_shared->mutex, &mutexAttr);
+    pthread_mutexattr_destroy(&mutexAttr);
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&m_shared->work, &condAttr);
+    pthread_cond_init(&m_shared->done, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+    m_shared->count = 0;
+    m_shared->next = 0;
+    m_shared->remaining = 0;
+    m_shared->numRequeued = 0;
+    m_shared->stop = false;
+
+    for(unsigned int i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i] = spawn();
+        if (m_workers[i] <= 0)
+        {
+            error = "cannot fork isolated workers";
+            return false;
+        }
+    }
+    return true;
+}
+
+void IsolatedProcessor::lock() const
+{
+    recover(pthread_mutex_lock(&m_shared->mutex), &m_shared->mutex);
+}
+
+pid_t IsolatedProcessor::spawn() const
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        work();
+        _exit(0);
+    }
+    return pid;
+}
+
+void IsolatedProcessor::work() const
+{
+    Shared* shared = m_shared;
+    unsigned int evaluations = 0;
+    std::vector<double> genes(m_numGenes);
+    lock();
+    while (true)
+    {
+        while (!shared->stop && shared->numRequeued == 0 && shared->next >= shared->count)
+        {
+            recover(pthread_cond_wait(&shared->work, &shared->mutex), &shared->mutex);
+        }
+        if (shared->stop)
+        {
+            break;
+        }
+        unsigned int i = shared->numRequeued > 0 ? m_requeued[--shared->numRequeued] : shared->next++;
+        Slot& slot = m_slots[i];
+        slot.state = s_claimed;
+        slot.owner = getpid();
+        slot.claimed = monotonicTime();
+        slot.attempts++;
+        pthread_mutex_unlock(&shared->mutex);
+
+        std::copy(m_genes + i * m_numGenes, m_genes + (i + 1) * m_numGenes, genes.begin());
+        Algo* algo = m_prototype->clone(genes);
+        Processor::Score score = m_processor.process(algo);
+        delete algo;
+
+        lock();
+        slot.score = score;
+        slot.state = s_done;
+        if (--shared->remaining == 0)
+        {
+            pthread_cond_signal(&shared->done);
+        }
+        if (m_recycle && ++evaluations >= m_recycle)
+        {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shared->mutex);
+}
+
+void IsolatedProcessor::supervise() const
+{
+    Shared* shared = m_shared;
+    for(unsigned int w = 0; w < m_workers.size(); w++)
+    {
+        int status;
+        pid_t pid = m_workers[w];
+        // waitpid() would reap any child for a pid of -1 from a failed fork
+        if (pid <= 0)
+        {
+            m_workers[w] = spawn();
+            pthread_cond_broadcast(&shared->work);
+            continue;
+        }
+        if (waitpid(pid, &status, WNOHANG) != pid)
+        {
+            continue;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            m_stats.crashes++;
+        }
+        for(unsigned int i = 0; i < shared->count; i++)
+        {
+            Slot& slot = m_slots[i];
+            if (slot.state != s_claimed || slot.owner != pid)
+            {
+                continue;
+            }
+            if (slot.attempts >= m_maxAttempts)
+            {
+                slot.score.success = false;
+                slot.score.score = HUGE_VAL;
+                slot.state = s_done;
+                shared->remaining--;
+                m_stats.failures++;
+            }
+            else
+            {
+                slot.state = s_pending;
+                m_requeued[shared->numRequeued++] = i;
+                m_stats.retries++;
+            }
+        }
+        m_workers[w] = spawn();
+        m_stats.respawns++;
+        pthread_cond_broadcast(&shared->work);
+    }
+    if (m_timeout > 0)
+    {
+        double now = monotonicTime();
+        for(unsigned int i = 0; i < shared->count; i++)
+        {
+            Slot& slot = m_slots[i];
+            if (slot.state == s_claimed && now - slot.claimed > m_timeout)
+            {
+                kill(slot.owner, SIGKILL);
+                // Counted once, the slot is dealt with when the worker is reaped
+                slot.claimed = HUGE_VAL;
+                m_stats.timeouts++;
+            }
+        }
+    }
+}
+
+void IsolatedProcessor::evaluate(Algo* const* algos, unsigned int count, Processor::Score* scores) const
+{
+    Shared* shared = m_shared;
+    lock();
+    for(unsigned int i = 0; i < count; i++)
+    {
+        std::vector<double> genes = algos[i]->getGenes();
+        std::copy(genes.begin(), genes.begin() + std::min((unsigned int) genes.size(), m_numGenes), m_genes + i * m_numGenes);
+        m_slots[i].state = s_pending;
+        m_slots[i].attempts = 0;
+    }
+    shared->count = count;
+    shared->next = 0;
+    shared->numRequeued = 0;
+    shared->remaining = count;
+    pthread_cond_broadcast(&shared->work);
+    while (shared->remaining > 0)
+    {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        double deadline = now.tv_sec + now.tv_usec * 1e-6 + s_superviseInterval;
+        struct timespec ts;
+        ts.tv_sec = (time_t) deadline;
+        ts.tv_nsec = (long) ((deadline - ts.tv_sec) * 1e9);
+        recover(pthread_cond_timedwait(&shared->done, &shared->mutex, &ts), &shared->mutex);
+        supervise();
+    }
+    for(unsigned int i = 0; i < count; i++)
+    {
+        scores[i] = m_slots[i].score;
+    }
+    shared->count = 0;
+    m_stats.evaluations += count;
+    pthread_mutex_unlock(&shared->mutex);
+}
+
+Processor::Score IsolatedProcessor::process(Algo* a, std::string logname) const
+{
+    if (logname.size())
+    {
+        return m_processor.process(a, logname);
+    }
+    Processor::Score score;
+    processBatch(&a, 1, &score);
+    return score;
+}
+
+void IsolatedProcessor::processBatch(Algo* const* algos, unsigned int count, Processor::Score* scores) const
+{
+    pthread_mutex_lock(&m_batchMutex);
+    for(unsigned int offset = 0; offset < count; offset += m_capacity)
+    {
+        evaluate(algos + offset, std::min(count - offset, m_capacity), scores + offset);
+    }
+    pthread_mutex_unlock(&m_batchMutex);
+}
+
+IsolatedProcessor::Stats IsolatedProcessor::getStats() const
+{
+    pthread_mutex_lock(&m_batchMutex);
+    Stats stats = m_stats;
+    pthread_mutex_unlock(&m_batchMutex);
+    return stats;
+}
+
+std::string IsolatedProcessor::getSummary() const
+{
+    Stats stats = getStats();
+    std::stringstream ss;
+    ss << "Isolated: " << m_workers.size() << " workers Evaluations: " << stats.evaluations << " Crashes: " << stats.crashes << " Timeouts: " << stats.timeouts;
+    ss << " Retries: " << stats.retries << " Failures: " << stats.failures << " Respawns: " << stats.respawns << std::endl;
+    return ss.str();
+}
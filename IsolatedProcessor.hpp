@@ -0,0 +1,114 @@
+/*
+ *  IsolatedProcessor.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ISOLATED_PROCESSOR_HPP
+#define ISOLATED_PROCESSOR_HPP
+
+#include "Processor.hpp"
+
+#include <pthread.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+class Algo;
+
+/**
+ * Runs another processor in forked worker processes, so a crash or leak
+ * in it cannot take the run down
+ * Genes are written once into a shared anonymous mapping; workers build
+ * the algorithm from them with the prototype's clone() and write the score
+ * back into the same slot, so nothing is serialized or sent. Workers claim
+ * slots under a robust process-shared mutex. A worker that dies, or
+ * overruns the timeout and is killed, is replaced; the slot it held is
+ * evaluated again until maxAttempts, then scored as a failure with an
+ * infinite score. Workers may also be recycled after a number of
+ * evaluations to contain leaks.
+ *
+ * processBatch() calls are serialized, one batch fills the workers, so a
+ * single evaluation thread with large chunks is enough. Logged runs are
+ * made in this process, where the log is wanted. The processor is not
+ * owned, the prototype is cloned; workers use the copies they were forked with
+ * A worker that cannot be forked again is retried at the next check.
+ */
+class IsolatedProcessor : public virtual Processor
+{
+    public:
+        struct Stats
+        {
+            unsigned long long evaluations;
+            unsigned long long crashes;
+            unsigned long long timeouts;
+            unsigned long long retries;
+            unsigned long long failures;
+            unsigned long long respawns;
+        };
+
+        /**
+         * @param capacity slots in the shared mapping, larger batches go in parts
+         * @param timeout seconds one evaluation may take, 0 for no limit
+         * @param recycle evaluations before a worker is replaced, 0 for never
+         */
+        IsolatedProcessor(const Processor& processor, const Algo& prototype, unsigned int numWorkers, unsigned int capacity, double timeout=0.0, unsigned int maxAttempts=2, unsigned int recycle=0);
+
+        /**
+         * Stops and reaps the workers
+         */
+        ~IsolatedProcessor();
+
+        /**
+         * Maps the shared slots and forks the workers, before evaluating
+         */
+        bool start(std::string& error);
+
+        virtual Processor::Score process(Algo* a, std::string logname="") const;
+        virtual void processBatch(Algo* const* algos, unsigned int count, Processor::Score* scores) const;
+
+        Stats getStats() const;
+        std::string getSummary() const;
+
+    private:
+        struct Shared;
+        struct Slot;
+
+        IsolatedProcessor(const IsolatedProcessor& processor);
+        const IsolatedProcessor& operator=(const IsolatedProcessor& processor);
+        void lock() const;
+        pid_t spawn() const;
+        void work() const;
+        void evaluate(Algo* const* algos, unsigned int count, Processor::Score* scores) const;
+        void supervise() const;
+
+        const Processor& m_processor;
+        Algo* m_prototype;
+        unsigned int m_numGenes;
+        unsigned int m_capacity;
+        double m_timeout;
+        unsigned int m_maxAttempts;
+        unsigned int m_recycle;
+        size_t m_mapSize;
+        Shared* m_shared;
+        Slot* m_slots;
+        double* m_genes;
+        unsigned int* m_requeued;
+        mutable std::vector<pid_t> m_workers;
+        mutable pthread_mutex_t m_batchMutex;
+        mutable Stats m_stats;
+};
+
+#endif // ISOLATED_PROCESSOR_HPP
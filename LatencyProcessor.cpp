@@ -0,0 +1,97 @@
+/*
+ *  LatencyProcessor.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LatencyProcessor.hpp"
+
+#include "Timer.hpp"
+
+#include <sys/time.h>
+#include <time.h>
+
+LatencyProcessor::LatencyProcessor(const Processor& processor, double latency, unsigned int maxInFlight)
+    : AsyncProcessor(maxInFlight)
+    , m_processor(processor)
+    , m_latency(latency)
+    , m_stop(false)
+{
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+    pthread_create(&m_thread, NULL, timer, this);
+}
+
+LatencyProcessor::~LatencyProcessor()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_stop = true;
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+    pthread_join(m_thread, NULL);
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool LatencyProcessor::beginGeneration(unsigned int generation) const
+{
+    return m_processor.beginGeneration(generation);
+}
+
+void LatencyProcessor::submit(Algo* a, const std::string& logname, AsyncProcessor::Ticket* ticket) const
+{
+    Pending pending;
+    pending.score = m_processor.process(a, logname);
+    pending.due = monotonicTime() + m_latency;
+    pending.ticket = ticket;
+    pthread_mutex_lock(&m_mutex);
+    // Every evaluation has the same latency, so the queue stays in due order
+    m_pending.push_back(pending);
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void* LatencyProcessor::timer(void* param)
+{
+    LatencyProcessor* self = static_cast<LatencyProcessor*>(param);
+    pthread_mutex_lock(&self->m_mutex);
+    while (!self->m_stop || self->m_pending.size())
+    {
+        if (self->m_pending.empty())
+        {
+            pthread_cond_wait(&self->m_cond, &self->m_mutex);
+            continue;
+        }
+        double wait = self->m_pending.front().due - monotonicTime();
+        if (wait > 0)
+        {
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            double deadline = now.tv_sec + now.tv_usec * 1e-6 + wait;
+            struct timespec ts;
+            ts.tv_sec = (time_t) deadline;
+            ts.tv_nsec = (long) ((deadline - ts.tv_sec) * 1e9);
+            pthread_cond_timedwait(&self->m_cond, &self->m_mutex, &ts);
+            continue;
+        }
+        Pending pending = self->m_pending.front();
+        self->m_pending.pop_front();
+        pthread_mutex_unlock(&self->m_mutex);
+        self->complete(pending.ticket, pending.score);
+        pthread_mutex_lock(&self->m_mutex);
+    }
+    pthread_mutex_unlock(&self->m_mutex);
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ *  LatencyProcessor.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATENCY_PROCESSOR_HPP
+#define LATENCY_PROCESSOR_HPP
+
+#include "AsyncProcessor.hpp"
+
+#include <deque>
+#include <pthread.h>
+
+/**
+ * Stand-in for a rig or simulator that takes a while to answer
+ * Scores with another processor at once, then holds each score back for
+ * a fixed latency on a single timer thread, so waiting costs no thread
+ * per evaluation. The processor is not owned and sees every
+ * beginGeneration().
+ */
+class LatencyProcessor : public virtual AsyncProcessor
+{
+    public:
+        /**
+         * @param latency seconds from submission to completion
+         */
+        LatencyProcessor(const Processor& processor, double latency, unsigned int maxInFlight);
+        ~LatencyProcessor();
+
+        virtual bool beginGeneration(unsigned int generation) const;
+
+    protected:
+        virtual void submit(Algo* a, const std::string& logname, AsyncProcessor::Ticket* ticket) const;
+
+    private:
+        struct Pending
+        {
+            double due;
+            AsyncProcessor::Ticket* ticket;
+            Processor::Score score;
+        };
+
+        static void* timer(void* param);
+
+        const Processor& m_processor;
+        const double m_latency;
+        mutable std::deque<Pending> m_pending;
+        mutable pthread_mutex_t m_mutex;
+        mutable pthread_cond_t m_cond;
+        pthread_t m_thread;
+        bool m_stop;
+};
+
+#endif // LATENCY_PROCESSOR_HPP
@@ -0,0 +1,408 @@
+/*
+ *  Metrics.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Metrics.hpp"
+
+#include <math.h>
+#include <stdint.h>
+#include <sys/resource.h>
+
+long peakRssKb()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+    {
+        return 0;
+    }
+    return usage.ru_maxrss;
+}
+
+const char* phaseName(GenerationStats::Phase phase)
+{
+    static const char* names[GenerationStats::numPhases] = {"breed", "evaluate", "merge", "select", "log"};
+    return names[phase];
+}
+
+ConsoleSink::ConsoleSink()
+    : m_prevAvg(0.0)
+    , m_prevBest(0.0)
+{
+}
+
+void ConsoleSink::record(const GenerationStats& stats)
+{
+    printf("Generation %d/%d\n", stats.generation, stats.numGenerations);
+    printf("Threads: %d Chunk: %d Evaluations/s: %f\n", (int) stats.threadBusy.size(), stats.chunkSize, stats.evaluationsPerSecond);
+    if (stats.samplesUsed < 1.0)
+    {
+        printf("Raced on %f%% of the samples\n", stats.samplesUsed * 100.0);
+    }
+    printf("Average performance of population %d:\n", stats.populationSize);
+    printf("mu: %f sigma: %f\n", stats.mu, stats.sigma);
+    printf("p10: %f median: %f p90: %f success rate: %f\n", stats.p10, stats.median, stats.p90, stats.successRate);
+    printf("Best Algo:\n");
+    printf("%s", stats.bestSummary.c_str());
+    printf("\n");
+    printf("Success: %d Score: %f\n", stats.bestSuccess, stats.bestScore);
+    if (stats.responseValid)
+    {
+        const Processor::Response& r = stats.bestResponse;
+        printf("Rise: %fs Settling: %fs Overshoot: %fm Peak: %fV Effort: %fVs Energy: %fV^2s\n", r.riseTime, r.settlingTime, r.overshoot, r.peakVoltage, r.effort, r.energy);
+    }
+    printf("\n");
+    for(unsigned int i = 0; i < stats.genes.size(); i++)
+    {
+        const GeneStats& g = stats.genes[i];
+        printf("%s: mean: %f variance: %f min: %f max: %f diversity: %f\n", g.name.c_str(), g.mean, g.variance(), g.min, g.max, g.diversity());
+    }
+    if (stats.mu != 0.0)
+    {
+        printf("%% above avg: %f\n", -(stats.bestScore - stats.mu) / stats.mu * 100.0);
+    }
+    if (stats.sigma != 0.0)
+    {
+        printf("Std above avg: %f\n", -(stats.bestScore - stats.mu) / stats.sigma);
+    }
+    if (stats.generation > 1 && m_prevAvg != 0.0 && m_prevBest != 0.0)
+    {
+        printf("%% score change from prev: avg: %f best: %f\n", -(stats.mu - m_prevAvg) / m_prevAvg * 100.0, -(stats.bestScore - m_prevBest) / m_prevBest * 100.0);
+    }
+    printf("Time: %fs breed: %f evaluate: %f merge: %f select: %f log: %f\n", stats.totalTime(), stats.breedTime, stats.evaluateTime, stats.mergeTime, stats.selectTime, stats.logTime);
+    if (stats.perfValid)
+    {
+        const PerfSample& eval = stats.perf[GenerationStats::evaluatePhase];
+        printf("IPC: breed: %f evaluate: %f merge: %f select: %f log: %f\n", stats.ipc(GenerationStats::breedPhase), stats.ipc(GenerationStats::evaluatePhase), stats.ipc(GenerationStats::mergePhase), stats.ipc(GenerationStats::selectPhase), stats.ipc(GenerationStats::logPhase));
+        printf("Per evaluation: instructions: %f branch misses: %f cache misses: %f\n", stats.perEvaluation(eval.instructions), stats.perEvaluation(eval.branchMisses), stats.perEvaluation(eval.cacheMisses));
+    }
+    printf("\n");
+
+    m_prevAvg = stats.mu;
+    m_prevBest = stats.bestScore;
+}
+
+FileSink::FileSink(const std::string& filename, const char* mode)
+    : m_file(NULL)
+{
+    if (filename == "-")
+    {
+        m_file = stdout;
+    }
+    else
+    {
+        m_file = fopen(filename.c_str(), mode);
+    }
+}
+
+FileSink::~FileSink()
+{
+    if (m_file && m_file != stdout)
+    {
+        fclose(m_file);
+    }
+}
+
+bool FileSink::good() const
+{
+    return m_file != NULL;
+}
+
+/**
+ * JSON has no representation for inf or nan
+ */
+static void writeJsonNumber(FILE* f, double d)
+{
+    if (isfinite(d))
+    {
+        fprintf(f, "%.17g", d);
+    }
+    else
+    {
+        fprintf(f, "null");
+    }
+}
+
+static void writeJsonString(FILE* f, const std::string& s)
+{
+    fputc('"', f);
+    for(unsigned int i = 0; i < s.size(); i++)
+    {
+        char c = s[i];
+        switch (c)
+        {
+            case '"':  fputs("\\\"", f); break;
+            case '\\': fputs("\\\\", f); break;
+            case '\n': fputs("\\n", f); break;
+            case '\t': fputs("\\t", f); break;
+            default:
+                if ((unsigned char) c < 0x20)
+                {
+                    fprintf(f, "\\u%04x", c);
+                }
+                else
+                {
+                    fputc(c, f);
+                }
+        }
+    }
+    fputc('"', f);
+}
+
+static void writeJsonResponse(FILE* f, const Processor::Response& r)
+{
+    fprintf(f, "{\"error\":");
+    writeJsonNumber(f, r.error);
+    fprintf(f, ",\"riseTime\":");
+    writeJsonNumber(f, r.riseTime);
+    fprintf(f, ",\"settlingTime\":");
+    writeJsonNumber(f, r.settlingTime);
+    fprintf(f, ",\"overshoot\":");
+    writeJsonNumber(f, r.overshoot);
+    fprintf(f, ",\"peakVoltage\":");
+    writeJsonNumber(f, r.peakVoltage);
+    fprintf(f, ",\"effort\":");
+    writeJsonNumber(f, r.effort);
+    fprintf(f, ",\"energy\":");
+    writeJsonNumber(f, r.energy);
+    fprintf(f, "}");
+}
+
+JsonLinesSink::JsonLinesSink(const std::string& filename)
+    : FileSink(filename, "w")
+{
+}
+
+void JsonLinesSink::record(const GenerationStats& stats)
+{
+    if (!m_file)
+    {
+        return;
+    }
+    fprintf(m_file, "{\"generation\":%u,\"generations\":%u,\"population\":%u,\"mu\":", stats.generation, stats.numGenerations, stats.populationSize);
+    writeJsonNumber(m_file, stats.mu);
+    fprintf(m_file, ",\"sigma\":");
+    writeJsonNumber(m_file, stats.sigma);
+    fprintf(m_file, ",\"p10\":");
+    writeJsonNumber(m_file, stats.p10);
+    fprintf(m_file, ",\"median\":");
+    writeJsonNumber(m_file, stats.median);
+    fprintf(m_file, ",\"p90\":");
+    writeJsonNumber(m_file, stats.p90);
+    fprintf(m_file, ",\"successRate\":");
+    writeJsonNumber(m_file, stats.successRate);
+    fprintf(m_file, ",\"samplesUsed\":");
+    writeJsonNumber(m_file, stats.samplesUsed);
+    fprintf(m_file, ",\"best\":{\"success\":%s,\"score\":", stats.bestSuccess ? "true" : "false");
+    writeJsonNumber(m_file, stats.bestScore);
+    fprintf(m_file, ",\"summary\":");
+    writeJsonString(m_file, stats.bestSummary);
+    if (stats.responseValid)
+    {
+        fprintf(m_file, ",\"response\":");
+        writeJsonResponse(m_file, stats.bestResponse);
+    }
+    fprintf(m_file, "}");
+    if (stats.responseValid)
+    {
+        fprintf(m_file, ",\"elites\":[");
+        for(unsigned int i = 0; i < stats.elites.size(); i++)
+        {
+            fprintf(m_file, "%s", i ? "," : "");
+            writeJsonResponse(m_file, stats.elites[i]);
+        }
+        fprintf(m_file, "]");
+    }
+    fprintf(m_file, ",\"genes\":[");
+    for(unsigned int i = 0; i < stats.genes.size(); i++)
+    {
+        const GeneStats& g = stats.genes[i];
+        fprintf(m_file, "%s{\"name\":", i ? "," : "");
+        writeJsonString(m_file, g.name);
+        fprintf(m_file, ",\"mean\":");
+        writeJsonNumber(m_file, g.mean);
+        fprintf(m_file, ",\"variance\":");
+        writeJsonNumber(m_file, g.variance());
+        fprintf(m_file, ",\"min\":");
+        writeJsonNumber(m_file, g.min);
+        fprintf(m_file, ",\"max\":");
+        writeJsonNumber(m_file, g.max);
+        fprintf(m_file, ",\"diversity\":");
+        writeJsonNumber(m_file, g.diversity());
+        fprintf(m_file, "}");
+    }
+    fprintf(m_file, "],\"phases\":{\"breed\":%.9f,\"evaluate\":%.9f,\"merge\":%.9f,\"select\":%.9f,\"log\":%.9f,\"total\":%.9f}", stats.breedTime, stats.evaluateTime, stats.mergeTime, stats.selectTime, stats.logTime, stats.totalTime());
+    fprintf(m_file, ",\"evaluationsPerSecond\":");
+    writeJsonNumber(m_file, stats.evaluationsPerSecond);
+    fprintf(m_file, ",\"chunk\":%u,\"threadBusy\":[", stats.chunkSize);
+    for(unsigned int i = 0; i < stats.threadBusy.size(); i++)
+    {
+        fprintf(m_file, "%s%.9f", i ? "," : "", stats.threadBusy[i]);
+    }
+    fprintf(m_file, "],\"lockWait\":%.9f,\"allocations\":%llu,\"allocatedBytes\":%llu,\"peakRssKb\":%ld,\"perf\":", stats.lockWait, stats.allocations, stats.allocatedBytes, stats.peakRssKb);
+    if (stats.perfValid)
+    {
+        fprintf(m_file, "{");
+        for(int i = 0; i < GenerationStats::numPhases; i++)
+        {
+            const PerfSample& p = stats.perf[i];
+            fprintf(m_file, "\"%s\":{\"cycles\":%llu,\"instructions\":%llu,\"branchMisses\":%llu,\"cacheMisses\":%llu,\"ipc\":%.6f},", phaseName((GenerationStats::Phase) i), p.cycles, p.instructions, p.branchMisses, p.cacheMisses, stats.ipc((GenerationStats::Phase) i));
+        }
+        const PerfSample& eval = stats.perf[GenerationStats::evaluatePhase];
+        fprintf(m_file, "\"instructionsPerEval\":%.6f,\"branchMissesPerEval\":%.6f,\"cacheMissesPerEval\":%.6f}", stats.perEvaluation(eval.instructions), stats.perEvaluation(eval.branchMisses), stats.perEvaluation(eval.cacheMisses));
+    }
+    else
+    {
+        fprintf(m_file, "null");
+    }
+    fprintf(m_file, "}\n");
+    fflush(m_file);
+}
+
+CsvSink::CsvSink(const std::string& filename)
+    : FileSink(filename, "w")
+    , m_header(false)
+{
+}
+
+void CsvSink::record(const GenerationStats& stats)
+{
+    if (!m_file)
+    {
+        return;
+    }
+    if (!m_header)
+    {
+        fprintf(m_file, "generation,generations,population,mu,sigma,p10,median,p90,successRate,bestSuccess,bestScore,breed,evaluate,merge,select,log,total,evaluationsPerSecond,chunk,threadBusy,lockWait,allocations,allocatedBytes,peakRssKb,perfValid");
+        for(int i = 0; i < GenerationStats::numPhases; i++)
+        {
+            const char* name = phaseName((GenerationStats::Phase) i);
+            fprintf(m_file, ",%sCycles,%sInstructions,%sBranchMisses,%sCacheMisses", name, name, name, name);
+        }
+        for(unsigned int i = 0; i < stats.genes.size(); i++)
+        {
+            const char* name = stats.genes[i].name.c_str();
+            fprintf(m_file, ",%sMean,%sVariance,%sMin,%sMax,%sDiversity", name, name, name, name, name);
+        }
+        fprintf(m_file, ",bestError,bestRiseTime,bestSettlingTime,bestOvershoot,bestPeakVoltage,bestEffort,bestEnergy,samplesUsed\n");
+        m_header = true;
+    }
+    fprintf(m_file, "%u,%u,%u,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%d,%.17g,", stats.generation, stats.numGenerations, stats.populationSize, stats.mu, stats.sigma, stats.p10, stats.median, stats.p90, stats.successRate, stats.bestSuccess, stats.bestScore);
+    fprintf(m_file, "%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.17g,%u,", stats.breedTime, stats.evaluateTime, stats.mergeTime, stats.selectTime, stats.logTime, stats.totalTime(), stats.evaluationsPerSecond, stats.chunkSize);
+    for(unsigned int i = 0; i < stats.threadBusy.size(); i++)
+    {
+        fprintf(m_file, "%s%.9f", i ? ";" : "", stats.threadBusy[i]);
+    }
+    fprintf(m_file, ",%.9f,%llu,%llu,%ld,%d", stats.lockWait, stats.allocations, stats.allocatedBytes, stats.peakRssKb, stats.perfValid);
+    for(int i = 0; i < GenerationStats::numPhases; i++)
+    {
+        const PerfSample& p = stats.perf[i];
+        fprintf(m_file, ",%llu,%llu,%llu,%llu", p.cycles, p.instructions, p.branchMisses, p.cacheMisses);
+    }
+    for(unsigned int i = 0; i < stats.genes.size(); i++)
+    {
+        const GeneStats& g = stats.genes[i];
+        fprintf(m_file, ",%.17g,%.17g,%.17g,%.17g,%.17g", g.mean, g.variance(), g.min, g.max, g.diversity());
+    }
+    if (stats.responseValid)
+    {
+        const Processor::Response& r = stats.bestResponse;
+        fprintf(m_file, ",%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g", r.error, r.riseTime, r.settlingTime, r.overshoot, r.peakVoltage, r.effort, r.energy);
+    }
+    else
+    {
+        fprintf(m_file, ",,,,,,,");
+    }
+    fprintf(m_file, ",%.17g\n", stats.samplesUsed);
+    fflush(m_file);
+}
+
+BinarySink::BinarySink(const std::string& filename)
+    : FileSink(filename, "wb")
+{
+}
+
+void BinarySink::record(const GenerationStats& stats)
+{
+    if (!m_file)
+    {
+        return;
+    }
+    uint32_t u[6] = {stats.generation, stats.numGenerations, stats.populationSize, stats.chunkSize, stats.bestSuccess, (uint32_t) stats.threadBusy.size()};
+    double d[14] = {stats.mu, stats.sigma, stats.bestScore, stats.breedTime, stats.evaluateTime, stats.mergeTime, stats.selectTime, stats.logTime, stats.evaluationsPerSecond, stats.lockWait, stats.p10, stats.median, stats.p90, stats.successRate};
+    uint64_t l[3] = {stats.allocations, stats.allocatedBytes, (uint64_t) stats.peakRssKb};
+    fwrite(u, sizeof(u), 1, m_file);
+    fwrite(d, sizeof(d), 1, m_file);
+    fwrite(l, sizeof(l), 1, m_file);
+    uint32_t perfValid = stats.perfValid;
+    fwrite(&perfValid, sizeof(perfValid), 1, m_file);
+    for(int i = 0; i < GenerationStats::numPhases; i++)
+    {
+        const PerfSample& p = stats.perf[i];
+        uint64_t c[4] = {p.cycles, p.instructions, p.branchMisses, p.cacheMisses};
+        fwrite(c, sizeof(c), 1, m_file);
+    }
+    if (stats.threadBusy.size())
+    {
+        fwrite(&stats.threadBusy[0], sizeof(double), stats.threadBusy.size(), m_file);
+    }
+    uint32_t numGenes = stats.genes.size();
+    fwrite(&numGenes, sizeof(numGenes), 1, m_file);
+    for(unsigned int i = 0; i < stats.genes.size(); i++)
+    {
+        const GeneStats& g = stats.genes[i];
+        double gd[5] = {g.mean, g.variance(), g.min, g.max, g.diversity()};
+        fwrite(gd, sizeof(gd), 1, m_file);
+    }
+    uint32_t numElites = stats.responseValid ? stats.elites.size() : 0;
+    fwrite(&numElites, sizeof(numElites), 1, m_file);
+    for(unsigned int i = 0; i < numElites; i++)
+    {
+        const Processor::Response& r = stats.elites[i];
+        double rd[7] = {r.error, r.riseTime, r.settlingTime, r.overshoot, r.peakVoltage, r.effort, r.energy};
+        fwrite(rd, sizeof(rd), 1, m_file);
+    }
+    fwrite(&stats.samplesUsed, sizeof(double), 1, m_file);
+    fflush(m_file);
+}
+
+static bool endsWith(const std::string& s, const std::string& suffix)
+{
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+MetricsSink* createMetricsSink(const std::string& filename)
+{
+    FileSink* sink = NULL;
+    if (endsWith(filename, ".jsonl") || endsWith(filename, ".json"))
+    {
+        sink = new JsonLinesSink(filename);
+    }
+    else if (endsWith(filename, ".csv"))
+    {
+        sink = new CsvSink(filename);
+    }
+    else if (endsWith(filename, ".bin"))
+    {
+        sink = new BinarySink(filename);
+    }
+    if (sink && !sink->good())
+    {
+        delete sink;
+        sink = NULL;
+    }
+    return sink;
+}
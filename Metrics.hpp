@@ -0,0 +1,286 @@
+/*
+ *  Metrics.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "PerfCounters.hpp"
+#include "Processor.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/**
+ * Population statistics of one gene, built up one value at a time and
+ * mergeable across threads
+ * The diversity index is sigma / (|mean| + sigma): 0 once the population
+ * has collapsed onto a single value, approaching 1 as the spread dominates
+ **/
+
+struct GeneStats
+{
+    std::string name;
+    unsigned int n;
+    double mean;
+    double m2;
+    double min;
+    double max;
+
+    GeneStats()
+        : n(0)
+        , mean(0.0)
+        , m2(0.0)
+        , min(0.0)
+        , max(0.0)
+    {
+    }
+
+    void insert(double x)
+    {
+        if (n == 0 || x < min)
+        {
+            min = x;
+        }
+        if (n == 0 || x > max)
+        {
+            max = x;
+        }
+        n++;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+
+    void merge(const GeneStats& other)
+    {
+        if (other.n == 0)
+        {
+            return;
+        }
+        if (n == 0)
+        {
+            *this = other;
+            return;
+        }
+        double delta = other.mean - mean;
+        double total = n + other.n;
+        mean = (n * mean + other.n * other.mean) / total;
+        m2 += other.m2 + delta * delta * n * other.n / total;
+        n += other.n;
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+    }
+
+    double variance() const
+    {
+        return n ? m2 / n : 0.0;
+    }
+
+    double diversity() const
+    {
+        double sigma = sqrt(variance());
+        double scale = fabs(mean) + sigma;
+        return scale > 0.0 ? sigma / scale : 0.0;
+    }
+};
+
+/**
+ * Per-generation statistics published by God
+ * Phase times are wall seconds and do not overlap:
+ * - breed: generating the new population and freeing the old one
+ * - evaluate: thread startup until the last thread finished evaluating
+ * - merge: remainder of the thread phase, folding per-thread heaps and
+ *   moments into the population totals
+ * - select: extracting the successors and population statistics
+ * - log: writing the trace of the best algorithm
+ * Hardware counters are summed over every thread that took part in a phase
+ * and only filled in when perfValid is set
+ **/
+
+struct GenerationStats
+{
+    enum Phase
+    {
+        breedPhase,
+        evaluatePhase,
+        mergePhase,
+        selectPhase,
+        logPhase,
+        numPhases
+    };
+
+    unsigned int generation;
+    unsigned int numGenerations;
+    unsigned int populationSize;
+    double mu;
+    double sigma;
+    double p10;
+    double median;
+    double p90;
+    double successRate;
+    bool bestSuccess;
+    double bestScore;
+    std::string bestSummary;
+    std::vector<GeneStats> genes;
+
+    // Only when the processor measures responses: the best algorithm's and
+    // every successor's, best first
+    bool responseValid;
+    Processor::Response bestResponse;
+    std::vector<Processor::Response> elites;
+
+    // Samples scored over numSamples() per algorithm, 1 unless racing
+    double samplesUsed;
+
+    double breedTime;
+    double evaluateTime;
+    double mergeTime;
+    double selectTime;
+    double logTime;
+    double evaluationsPerSecond;
+
+    unsigned int chunkSize;
+    std::vector<double> threadBusy;
+    double lockWait;
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+    long peakRssKb;
+
+    bool perfValid;
+    PerfSample perf[numPhases];
+
+    double totalTime() const
+    {
+        return breedTime + evaluateTime + mergeTime + selectTime + logTime;
+    }
+
+    double ipc(Phase phase) const
+    {
+        return perf[phase].cycles ? (double) perf[phase].instructions / perf[phase].cycles : 0.0;
+    }
+
+    double perEvaluation(unsigned long long count) const
+    {
+        return populationSize ? (double) count / populationSize : 0.0;
+    }
+};
+
+const char* phaseName(GenerationStats::Phase phase);
+
+/**
+ * Consumer of generation statistics
+ * record() is called once per generation from the thread running God
+ **/
+
+class MetricsSink
+{
+    public:
+        virtual ~MetricsSink() {}
+        virtual void record(const GenerationStats& stats) = 0;
+};
+
+/**
+ * Human readable progress report on stdout
+ **/
+
+class ConsoleSink : public virtual MetricsSink
+{
+    public:
+        ConsoleSink();
+        virtual void record(const GenerationStats& stats);
+    private:
+        double m_prevAvg;
+        double m_prevBest;
+};
+
+/**
+ * Base for sinks writing to a file they own, or to stdout if the name is "-"
+ **/
+
+class FileSink : public virtual MetricsSink
+{
+    public:
+        FileSink(const std::string& filename, const char* mode);
+        virtual ~FileSink();
+        bool good() const;
+    protected:
+        FILE* m_file;
+};
+
+/**
+ * One JSON object per generation per line
+ **/
+
+class JsonLinesSink : public FileSink
+{
+    public:
+        JsonLinesSink(const std::string& filename);
+        virtual void record(const GenerationStats& stats);
+};
+
+/**
+ * Comma separated values with a header row
+ * Thread busy times are joined by ';' within a single column
+ * Gene columns follow the genes of the first record, then the best
+ * algorithm's response, empty without responses, and samplesUsed
+ **/
+
+class CsvSink : public FileSink
+{
+    public:
+        CsvSink(const std::string& filename);
+        virtual void record(const GenerationStats& stats);
+    private:
+        bool m_header;
+};
+
+/**
+ * Native-endian fixed layout records, cheapest to write
+ * Each record is: uint32 generation, numGenerations, populationSize,
+ * chunkSize, bestSuccess, numThreads; doubles mu, sigma, bestScore,
+ * breedTime, evaluateTime, mergeTime, selectTime, logTime,
+ * evaluationsPerSecond, lockWait, p10, median, p90, successRate; uint64 allocations, allocatedBytes,
+ * peakRssKb; uint32 perfValid; for each phase uint64 cycles, instructions,
+ * branchMisses, cacheMisses; then numThreads doubles of thread busy time;
+ * uint32 numGenes; for each gene doubles mean, variance, min, max, diversity;
+ * uint32 numElites, 0 without responses; for each successor, best first,
+ * doubles error, riseTime, settlingTime, overshoot, peakVoltage, effort, energy;
+ * double samplesUsed
+ **/
+
+class BinarySink : public FileSink
+{
+    public:
+        BinarySink(const std::string& filename);
+        virtual void record(const GenerationStats& stats);
+};
+
+/**
+ * Picks a sink from the file extension: .jsonl, .csv or .bin
+ * @return NULL if the extension is unknown or the file cannot be opened
+ */
+MetricsSink* createMetricsSink(const std::string& filename);
+
+/**
+ * Peak resident set size of the process in kilobytes
+ */
+long peakRssKb();
+
+#endif // METRICS_HPP
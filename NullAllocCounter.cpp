@@ -0,0 +1,31 @@
+/*
+ *  NullAllocCounter.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AllocCounter.hpp"
+
+// The libraries leave the host's operator new alone, so nothing is counted
+
+unsigned long long threadAllocations()
+{
+    return 0;
+}
+
+unsigned long long threadAllocatedBytes()
+{
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ *  Optimizer.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Optimizer.hpp"
+
+#include "PID1DProcessor.hpp"
+#include "rand.h"
+
+#include <algorithm>
+#include <sstream>
+#include <time.h>
+
+Optimizer::Optimizer(const std::vector<Algo*>& seeds, unsigned int populationSize, unsigned int successorSize, unsigned long seed)
+    : m_seeds(seeds)
+    , m_populationSize(populationSize)
+    , m_successorSize(successorSize)
+    , m_rng(rng_create(seed ? seed : time(NULL)))
+    , m_population(populationSize, (Algo*) NULL)
+    , m_told(populationSize, false)
+    , m_scores(successorSize, successorSize)
+    , m_successors(successorSize)
+    , m_firstId(0)
+    , m_asked(0)
+    , m_numTold(0)
+    , m_generation(0)
+    , m_evaluations(0)
+{
+    m_best.algo = NULL;
+    m_best.score.success = false;
+    m_best.score.score = 0.0;
+    breed();
+}
+
+Optimizer::~Optimizer()
+{
+    for(unsigned int j = 0; j < m_populationSize; j++)
+    {
+        if (m_population[j] != m_best.algo)
+        {
+            delete m_population[j];
+        }
+    }
+    delete m_best.algo;
+    for(unsigned int j = 0; j < m_seeds.size(); j++)
+    {
+        delete m_seeds[j];
+    }
+    rng_destroy(m_rng);
+}
+
+void Optimizer::breed()
+{
+    void* previous = rng_select(m_rng);
+    if (m_generation == 0)
+    {
+        unsigned int numSeeds = m_seeds.size();
+        for(unsigned int j = 0; j < m_populationSize; j++)
+        {
+            m_population[j] = m_seeds[j%numSeeds]->gen();
+        }
+        for(unsigned int j = 0; j < m_seeds.size(); j++)
+        {
+            delete m_seeds[j];
+        }
+        m_seeds.clear();
+    }
+    else
+    {
+        std::vector<Algo*> newpop(m_populationSize);
+        newpop[0] = m_best.algo;
+        for(unsigned int j = 1; j < m_populationSize; j++)
+        {
+            newpop[j] = m_successors[j%m_successorSize].algo->gen();
+        }
+        for(unsigned int j = 0; j < m_populationSize; j++)
+        {
+            if (m_population[j] != m_best.algo)
+            {
+                delete m_population[j];
+            }
+            m_population[j] = newpop[j];
+        }
+    }
+    rng_select(previous);
+    std::fill(m_told.begin(), m_told.end(), false);
+    m_asked = 0;
+    m_numTold = 0;
+    m_scores.Flush();
+}
+
+std::vector<Optimizer::Candidate> Optimizer::ask(unsigned int maxCount)
+{
+    unsigned int count = std::min(maxCount, m_populationSize - m_asked);
+    std::vector<Candidate> candidates(count);
+    for(unsigned int j = 0; j < count; j++)
+    {
+        candidates[j].id = m_firstId + m_asked;
+        candidates[j].algo = m_population[m_asked];
+        m_asked++;
+    }
+    return candidates;
+}
+
+bool Optimizer::tell(unsigned long id, Processor::Score score)
+{
+    if (id < m_firstId || id >= m_firstId + m_asked || m_told[id - m_firstId])
+    {
+        return false;
+    }
+    unsigned int index = id - m_firstId;
+    m_told[index] = true;
+    AlgoScore as;
+    as.algo = m_population[index];
+    as.score = score;
+    m_scores.Insert(as);
+    m_evaluations++;
+    if (++m_numTold < m_populationSize)
+    {
+        return true;
+    }
+
+    for(unsigned int j = 0; j < m_successorSize; j++)
+    {
+        m_successors[j] = m_scores.Pop();
+    }
+    God::algoScoreSort sorter;
+    m_best = *std::max_element(m_successors.begin(), m_successors.end(), sorter);
+    m_generation++;
+    m_firstId += m_populationSize;
+    breed();
+    return true;
+}
+
+RunResult run(const RunConfig& config, MetricsSink* sink)
+{
+    void* rng = rng_create(config.seed ? config.seed : time(NULL));
+    void* previous = rng_select(rng);
+    PID1DProcessor* processor = createProcessor(config);
+    God god(*processor, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, config.maxNumThreads, config.numCycles);
+    god.setLogPrefix(config.logPrefix, config.logging);
+    god.setStreaming(config.streaming);
+    god.setRacing(config.racing, config.racingDelta);
+    god.setPerfCounters(config.perf);
+    if (sink)
+    {
+        god.addSink(sink);
+    }
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    rng_select(previous);
+    rng_destroy(rng);
+
+    RunResult result;
+    result.success = best.score.success;
+    result.score = best.score.score;
+    result.genes = best.algo->getGenes();
+    result.geneNames = best.algo->getGeneNames();
+    result.summary = best.algo->getSummary();
+    delete best.algo;
+    delete processor;
+    return result;
+}
+
+bool validateRunConfig(const RunConfig& c, std::string& error)
+{
+    std::stringstream ss;
+    ss << executableSettings(c);
+    if (c.fitnessDb.size())
+    {
+        ss << (ss.tellp() > 0 ? ", " : "") << "fitnessDb";
+    }
+    if (c.metrics.size())
+    {
+        ss << (ss.tellp() > 0 ? ", " : "") << "metrics";
+    }
+    if (c.trace.size())
+    {
+        ss << (ss.tellp() > 0 ? ", " : "") << "trace";
+    }
+    error = ss.str();
+    if (error.size())
+    {
+        error = "only the genetics executable supports " + error;
+        return false;
+    }
+    return true;
+}
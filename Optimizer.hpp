@@ -0,0 +1,140 @@
+/*
+ *  Optimizer.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "Algo.hpp"
+#include "Config.hpp"
+#include "God.hpp"
+#include "Heap.hpp"
+#include "Processor.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * Ask/tell interface to the genetic algorithm, for callers that evaluate
+ * candidates themselves instead of handing God a Processor
+ * Generations follow God::simulate: the first is bred from the seeds, each
+ * later one keeps the best algorithm and breeds the rest from the
+ * successors. ask() hands out candidates of the current generation in
+ * batches and once every one has been told a score the next generation is
+ * bred. Scores are ranked like God::minScoreHeap.
+ * Breeding draws from the optimizer's own generator, so optimizers are
+ * independent of each other and of the process-wide one; a single
+ * optimizer is not thread-safe
+ **/
+
+class Optimizer
+{
+    public:
+        struct Candidate
+        {
+            unsigned long id;
+            const Algo* algo;
+        };
+
+        /**
+         * Takes ownership of the seeds
+         * @param successorSize between 1 and populationSize
+         * @param seed generator seed, 0 to seed from the clock
+         */
+        Optimizer(const std::vector<Algo*>& seeds, unsigned int populationSize, unsigned int successorSize, unsigned long seed=0);
+        ~Optimizer();
+
+        /**
+         * @return up to maxCount candidates not handed out yet, none while
+         * the rest of the generation is still being evaluated
+         */
+        std::vector<Candidate> ask(unsigned int maxCount);
+
+        /**
+         * @return false if the id is not an outstanding candidate of the
+         * current generation
+         */
+        bool tell(unsigned long id, Processor::Score score);
+
+        /**
+         * Generations completed so far
+         */
+        unsigned int generation() const
+        {
+            return m_generation;
+        }
+
+        unsigned long long evaluations() const
+        {
+            return m_evaluations;
+        }
+
+        /**
+         * Best of the last completed generation, algo is NULL before the
+         * first completes and stays owned by the optimizer
+         */
+        AlgoScore best() const
+        {
+            return m_best;
+        }
+
+    private:
+        Optimizer(const Optimizer& optimizer);
+        const Optimizer& operator=(const Optimizer& optimizer);
+        void breed();
+
+        std::vector<Algo*> m_seeds;
+        unsigned int m_populationSize;
+        unsigned int m_successorSize;
+        void* m_rng;
+        std::vector<Algo*> m_population;
+        std::vector<bool> m_told;
+        Heap<AlgoScore, God::minScoreHeap> m_scores;
+        std::vector<AlgoScore> m_successors;
+        AlgoScore m_best;
+        unsigned long m_firstId;
+        unsigned int m_asked;
+        unsigned int m_numTold;
+        unsigned int m_generation;
+        unsigned long long m_evaluations;
+};
+
+struct RunResult
+{
+    bool success;
+    double score;
+    std::vector<double> genes;
+    std::vector<std::string> geneNames;
+    std::string summary;
+};
+
+/**
+ * Runs God::simulate on the PID1DProcessor described by the config, with
+ * its own generator so it can be called from any thread
+ * The config must pass validateRunConfig()
+ * @param sink optional, e.g. a ConsoleSink for progress
+ */
+RunResult run(const RunConfig& config, MetricsSink* sink=NULL);
+
+/**
+ * Rejects settings only the genetics executable implements, which run()
+ * and the Optimizer would otherwise ignore: executableSettings(), and
+ * fitnessDb, metrics and trace
+ */
+bool validateRunConfig(const RunConfig& config, std::string& error);
+
+#endif // OPTIMIZER_HPP
@@ -40,6 +40,11 @@ Param<double>* PDParam::gen() const
     return new PDParam(randgauss(m_k*(p), p), m_k);
 }
 
+Param<double>* PDParam::clone(const double& value) const
+{
+    return new PDParam(value, m_k);
+}
+
 const double& PDParam::get() const
 {
     return m_p;
@@ -32,6 +32,7 @@ class PDParam : public virtual Param<double>
     public:
         PDParam(double p=0, double k=1);
         virtual Param<double>* gen() const;
+        virtual Param<double>* clone(const double& value) const;
         virtual const double& get() const;
     private:
         double m_p;
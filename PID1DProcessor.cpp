@@ -19,11 +19,27 @@
 #include "PID1DProcessor.hpp"
 
 #include "Algo.hpp"
+#include "rand.h"
 
+#include <algorithm>
 #include <math.h>
 #include <fstream>
+#include <sstream>
 #include <vector>
 
+static const double dt = 1e-3; // 1ms
+
+static const char* s_objectiveNames[PID1DProcessor::numObjectiveKinds] = {"error", "rise", "settling", "overshoot", "peakVoltage", "effort", "energy"};
+static double Processor::Response::* const s_objectiveFields[PID1DProcessor::numObjectiveKinds] = {
+    &Processor::Response::error,
+    &Processor::Response::riseTime,
+    &Processor::Response::settlingTime,
+    &Processor::Response::overshoot,
+    &Processor::Response::peakVoltage,
+    &Processor::Response::effort,
+    &Processor::Response::energy
+};
+
 PID1DProcessor::PID1DProcessor(double timeout, double timein, double threshold, double maxVoltage, double minVoltage, double goal, double mass, double motorStallTorque, double motorFreeSpeed, double gearingRatio, double wheelDiameter, double staticFriction, double kineticFriction)
     : m_timeout(timeout)
     , m_timein(timein)
@@ -38,13 +54,177 @@ PID1DProcessor::PID1DProcessor(double timeout, double timein, double threshold,
     , m_wheelDiameter(wheelDiameter)
     , m_staticFriction(staticFriction)
     , m_kineticFriction(kineticFriction)
+    , m_sensorNoise(0.0)
+    , m_actuatorNoise(0.0)
+    , m_loadDisturbance(0.0)
+    , m_noiseSamples(1)
+    , m_noiseSeed(0)
+    , m_noiseSteps(0)
 {
 }
 
 Processor::Score PID1DProcessor::process(Algo* a, std::string logname) const
 {
-    static const double dt = 1e-3; // 1ms
+    Processor::Response response;
+    return simulate(a, logname, response);
+}
+
+unsigned int PID1DProcessor::numObjectives() const
+{
+    return m_objectives.empty() ? 1 : m_objectives.size();
+}
 
+Processor::Score PID1DProcessor::processObjectives(Algo* a, double* objectives) const
+{
+    Processor::Response response;
+    Processor::Score score = simulate(a, "", response);
+    if (m_objectives.empty())
+    {
+        objectives[0] = response.error;
+    }
+    for(unsigned int i = 0; i < m_objectives.size(); i++)
+    {
+        objectives[i] = response.*s_objectiveFields[m_objectives[i]];
+    }
+    return score;
+}
+
+bool PID1DProcessor::hasResponse() const
+{
+    return true;
+}
+
+Processor::Score PID1DProcessor::processResponse(Algo* a, Processor::Response& response) const
+{
+    return simulate(a, "", response);
+}
+
+bool PID1DProcessor::beginGeneration(unsigned int generation) const
+{
+    if (m_noiseSteps == 0)
+    {
+        return false;
+    }
+    void* rng = rng_create(m_noiseSeed + generation);
+    void* previous = rng_select(rng);
+    for(unsigned int i = 0; i < m_sensorDraws.size(); i++)
+    {
+        m_sensorDraws[i] = randgauss(0.0, m_sensorNoise);
+    }
+    for(unsigned int i = 0; i < m_actuatorDraws.size(); i++)
+    {
+        m_actuatorDraws[i] = randgauss(0.0, m_actuatorNoise);
+    }
+    for(unsigned int i = 0; i < m_loadTimes.size(); i++)
+    {
+        m_loadTimes[i] = randf() * m_timeout;
+        m_loadTorques[i] = randgauss(0.0, m_loadDisturbance) * m_motorStallTorque * m_gearingRatio;
+    }
+    rng_select(previous);
+    rng_destroy(rng);
+    return true;
+}
+
+unsigned int PID1DProcessor::numSamples() const
+{
+    return m_noiseSamples;
+}
+
+Processor::Score PID1DProcessor::processSample(Algo* a, unsigned int sample) const
+{
+    Processor::Response response;
+    return simulateSample(a, "", sample, response);
+}
+
+void PID1DProcessor::setNoise(double sensorNoise, double actuatorNoise, double loadDisturbance, unsigned int samples, unsigned long seed)
+{
+    m_sensorNoise = sensorNoise;
+    m_actuatorNoise = actuatorNoise;
+    m_loadDisturbance = loadDisturbance;
+    m_noiseSamples = std::max(samples, 1u);
+    m_noiseSeed = seed;
+    bool noisy = sensorNoise > 0 || actuatorNoise > 0 || loadDisturbance > 0;
+    // No run outlasts the timeout by more than timein
+    m_noiseSteps = noisy ? (unsigned int) ceil((m_timeout + m_timein) / dt) + 2 : 0;
+    m_sensorDraws.assign(sensorNoise > 0 ? (size_t) m_noiseSamples * m_noiseSteps : 0, 0.0);
+    m_actuatorDraws.assign(actuatorNoise > 0 ? (size_t) m_noiseSamples * m_noiseSteps : 0, 0.0);
+    m_loadTimes.assign(loadDisturbance > 0 ? m_noiseSamples : 0, 0.0);
+    m_loadTorques.assign(m_loadTimes.size(), 0.0);
+    beginGeneration(0);
+}
+
+void PID1DProcessor::setObjectives(const std::vector<Objective>& objectives)
+{
+    m_objectives = objectives;
+}
+
+bool PID1DProcessor::parseObjectives(const std::string& list, std::vector<Objective>& objectives, std::string& error)
+{
+    objectives.clear();
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ','))
+    {
+        size_t start = name.find_first_not_of(" \t");
+        size_t stop = name.find_last_not_of(" \t");
+        name = start == std::string::npos ? "" : name.substr(start, stop - start + 1);
+        unsigned int j = 0;
+        while (j < numObjectiveKinds && name != s_objectiveNames[j])
+        {
+            j++;
+        }
+        if (j == numObjectiveKinds)
+        {
+            error = "unknown objective '" + name + "', expected error, rise, settling, overshoot, peakVoltage, effort or energy";
+            return false;
+        }
+        for(unsigned int k = 0; k < objectives.size(); k++)
+        {
+            if (objectives[k] == (Objective) j)
+            {
+                error = "objective " + name + " is listed twice";
+                return false;
+            }
+        }
+        objectives.push_back((Objective) j);
+    }
+    return true;
+}
+
+const char* PID1DProcessor::objectiveName(Objective objective)
+{
+    return s_objectiveNames[objective];
+}
+
+Processor::Score PID1DProcessor::simulate(Algo* a, const std::string& logname, Processor::Response& response) const
+{
+    // Only the first draw is logged
+    Processor::Score score = simulateSample(a, logname, 0, response);
+    if (m_noiseSamples == 1)
+    {
+        return score;
+    }
+    for(unsigned int i = 1; i < m_noiseSamples; i++)
+    {
+        Processor::Response sample;
+        Processor::Score sampleScore = simulateSample(a, "", i, sample);
+        score.success = score.success && sampleScore.success;
+        score.score += sampleScore.score;
+        for(unsigned int j = 0; j < numObjectiveKinds; j++)
+        {
+            response.*s_objectiveFields[j] += sample.*s_objectiveFields[j];
+        }
+    }
+    score.score /= m_noiseSamples;
+    for(unsigned int j = 0; j < numObjectiveKinds; j++)
+    {
+        response.*s_objectiveFields[j] /= m_noiseSamples;
+    }
+    return score;
+}
+
+Processor::Score PID1DProcessor::simulateSample(Algo* a, const std::string& logname, unsigned int sample, Processor::Response& response) const
+{
     std::ofstream* of = NULL;
     if (logname.size())
     {
@@ -57,49 +237,38 @@ Processor::Score PID1DProcessor::process(Algo* a, std::string logname) const
     double t = 0;
     double steadytime = 0;
     double wheelCircumference = M_PI * m_wheelDiameter;
-    double finalSpeed = m_motorFreeSpeed / m_gearingRatio;
-    double inertia = m_mass; // Not entirely accurate, need to think harder
     double score = 0.0;
+    double direction = m_goal < 0 ? -1 : 1;
+    double riseStart = -1;
+    double riseStop = -1;
+    double overshoot = 0.0;
+    double peakVoltage = 0.0;
+    double effort = 0.0;
+    double energy = 0.0;
+    const double* sensorDraws = m_sensorDraws.empty() ? NULL : &m_sensorDraws[(size_t) sample * m_noiseSteps];
+    const double* actuatorDraws = m_actuatorDraws.empty() ? NULL : &m_actuatorDraws[(size_t) sample * m_noiseSteps];
+    double loadTime = m_loadTimes.empty() ? HUGE_VAL : m_loadTimes[sample];
+    double loadTorque = m_loadTorques.empty() ? 0.0 : m_loadTorques[sample];
+    unsigned int step = 0;
     std::vector<double> inputs(2);
     std::vector<double> output;
+    a->initialize();
     while (t < m_timeout || (steadytime > 0  && steadytime < m_timein))
     {
-
-        // Model for motor: http://www.inf.fu-berlin.de/lehre/SS05/Robotik/motors.pdf
-
         inputs[0] = m_goal;
         inputs[1] = theta * wheelCircumference;
-        output = a->update(inputs);
-
-        double stallTorque = m_motorStallTorque * output[0] / m_maxVoltage * m_gearingRatio;
-
-        alpha = stallTorque / inertia * (1 - omega / finalSpeed);
-        if (omega == 0)
+        if (sensorDraws && step < m_noiseSteps)
         {
-            if (fabs(alpha) < m_mass * m_staticFriction)
-            {
-                alpha = 0;
-            }
+            inputs[1] += sensorDraws[step];
         }
-        else
+        output = a->update(inputs);
+        double voltage = output[0];
+        if (actuatorDraws && step < m_noiseSteps)
         {
-            if (alpha > 0)
-            {
-                alpha -= m_mass * m_kineticFriction;
-                if (alpha < 0)
-                {
-                    alpha = 0;
-                }
-            }
-            else if (alpha < 0)
-            {
-                alpha += m_mass * m_kineticFriction;
-                if (alpha > 0)
-                {
-                    alpha = 0;
-                }
-            }
+            voltage = std::min(std::max(voltage + actuatorDraws[step], m_minVoltage), m_maxVoltage);
         }
+
+        alpha = acceleration(voltage, t >= loadTime ? loadTorque : 0.0, omega);
         theta += omega * dt + 0.5 * alpha * dt * dt;
         omega += alpha * dt;
 
@@ -114,15 +283,103 @@ Processor::Score PID1DProcessor::process(Algo* a, std::string logname) const
         }
 
         score += fabs(m_goal - pos) * dt;
+        double progress = pos * direction;
+        if (riseStart < 0 && progress >= 0.1 * m_goal * direction)
+        {
+            riseStart = t;
+        }
+        if (riseStop < 0 && progress >= 0.9 * m_goal * direction)
+        {
+            riseStop = t;
+        }
+        overshoot = std::max(overshoot, (pos - m_goal) * direction);
+        peakVoltage = std::max(peakVoltage, fabs(voltage));
+        effort += fabs(voltage) * dt;
+        energy += voltage * voltage * dt;
 
         if (of)
         {
-            *of << t << "," << theta << "," << omega << "," << alpha << "," << output[0] << "," << steadytime << "," << m_goal / wheelCircumference << "," << score << std::endl;
+            *of << t << "," << theta << "," << omega << "," << alpha << "," << voltage << "," << steadytime << "," << m_goal / wheelCircumference << "," << score << std::endl;
         }
 
         t += dt;
+        step++;
+    }
+
+    a->finalize();
+    if (of)
+    {
+        of->close();
+        delete of;
+    }
+
+    response.error = score;
+    // Never reaching 90% of the goal rises for the whole run, as never settling settles
+    response.riseTime = riseStop < 0 ? t - std::max(riseStart, 0.0) : riseStop - riseStart;
+    response.settlingTime = t - steadytime;
+    response.overshoot = overshoot;
+    response.peakVoltage = peakVoltage;
+    response.effort = effort;
+    response.energy = energy;
+
+    Processor::Score ret = {steadytime > 0, score};
+    return ret;
+}
+
+Processor::Score PID1DProcessor::track(Algo* a, const double* setpoints, const double* disturbances, unsigned long long length, double period, const std::string& logname) const
+{
+    std::ofstream* of = NULL;
+    if (logname.size())
+    {
+        of = new std::ofstream(logname.c_str());
+    }
+
+    double theta = 0;
+    double omega = 0;
+    double alpha = 0;
+    double t = 0;
+    double steadytime = 0;
+    double wheelCircumference = M_PI * m_wheelDiameter;
+    double score = 0.0;
+    double end = length * period;
+    double setpoint = setpoints[length - 1];
+    double disturbance = disturbances ? disturbances[length - 1] : 0.0;
+    std::vector<double> inputs(2);
+    std::vector<double> output;
+    a->initialize();
+    // After the profile its last setpoint is held until settled, as the step is
+    for(unsigned long long i = 0; i < length || (t < end + m_timeout && steadytime < m_timein); i++)
+    {
+        double goal = i < length ? setpoints[i] : setpoint;
+        double load = i < length ? (disturbances ? disturbances[i] : 0.0) : disturbance;
+        inputs[0] = goal;
+        inputs[1] = theta * wheelCircumference;
+        output = a->update(inputs);
+        double voltage = output[0];
+
+        alpha = acceleration(voltage, load * m_gearingRatio, omega);
+        theta += omega * period + 0.5 * alpha * period * period;
+        omega += alpha * period;
+
+        double pos = theta * wheelCircumference;
+        if (fabs(goal - pos) < m_threshold)
+        {
+            steadytime += period;
+        }
+        else
+        {
+            steadytime = 0;
+        }
+        score += fabs(goal - pos) * period;
+
+        if (of)
+        {
+            *of << t << "," << theta << "," << omega << "," << alpha << "," << voltage << "," << steadytime << "," << goal / wheelCircumference << "," << score << std::endl;
+        }
+        t += period;
     }
 
+    a->finalize();
     if (of)
     {
         of->close();
@@ -133,3 +390,43 @@ Processor::Score PID1DProcessor::process(Algo* a, std::string logname) const
     return ret;
 }
 
+double PID1DProcessor::acceleration(double voltage, double loadTorque, double omega) const
+{
+    // Model for motor: http://www.inf.fu-berlin.de/lehre/SS05/Robotik/motors.pdf
+    double finalSpeed = m_motorFreeSpeed / m_gearingRatio;
+    double inertia = m_mass; // Not entirely accurate, need to think harder
+    double stallTorque = m_motorStallTorque * voltage / m_maxVoltage * m_gearingRatio;
+
+    double alpha = stallTorque / inertia * (1 - omega / finalSpeed);
+    if (loadTorque != 0)
+    {
+        alpha += loadTorque / inertia;
+    }
+    if (omega == 0)
+    {
+        if (fabs(alpha) < m_mass * m_staticFriction)
+        {
+            alpha = 0;
+        }
+    }
+    else
+    {
+        if (alpha > 0)
+        {
+            alpha -= m_mass * m_kineticFriction;
+            if (alpha < 0)
+            {
+                alpha = 0;
+            }
+        }
+        else if (alpha < 0)
+        {
+            alpha += m_mass * m_kineticFriction;
+            if (alpha > 0)
+            {
+                alpha = 0;
+            }
+        }
+    }
+    return alpha;
+}
@@ -22,18 +22,96 @@
 #include "Processor.hpp"
 
 #include <pthread.h>
+#include <string>
+#include <vector>
 
 /**
  * Simulation of a robot moving in 1D
  * Uses SI mks units
  * Const private data members are immutable and don't need a thread lock (I think?)
+ * Every run measures the step response as it goes, see Processor::Response,
+ * at the cost of a few comparisons per step; processResponse() returns it
+ * For multi-objective runs processObjectives() reports the measurements
+ * chosen by setObjectives(), all minimized
+ * setNoise() adds sensor and actuator noise and a step load disturbance.
+ * The noise is drawn once per generation by beginGeneration() from a
+ * stream seeded by the noise seed and the generation, and every algorithm
+ * of the generation is run against the same draws (common random numbers),
+ * so their differences are not noise. Each evaluation averages the given
+ * number of independent draws, which processSample() runs one at a time.
+ * track() runs the same plant along a setpoint profile instead of the
+ * step to the goal, see TrajectoryProcessor.
  */
 class PID1DProcessor : public virtual Processor
 {
     public:
         PID1DProcessor(double timeout, double timein, double threshold, double maxVoltage, double minVoltage, double goal, double mass, double motorStallTorque, double motorFreeSpeed, double gearingRatio, double wheelDiameter, double staticFriction, double kineticFriction);
+        enum Objective
+        {
+            errorObjective,
+            riseObjective,
+            settlingObjective,
+            overshootObjective,
+            peakVoltageObjective,
+            effortObjective,
+            energyObjective,
+            numObjectiveKinds
+        };
+
         virtual Processor::Score process(Algo* a, std::string logname="") const;
+        virtual unsigned int numObjectives() const;
+        virtual Processor::Score processObjectives(Algo* a, double* objectives) const;
+        virtual bool hasResponse() const;
+        virtual Processor::Score processResponse(Algo* a, Processor::Response& response) const;
+        virtual bool beginGeneration(unsigned int generation) const;
+        virtual unsigned int numSamples() const;
+        virtual Processor::Score processSample(Algo* a, unsigned int sample) const;
+
+        /**
+         * Not thread-safe, set before evaluating; empty for the score alone
+         */
+        void setObjectives(const std::vector<Objective>& objectives);
+
+        /**
+         * @param list comma-separated names: error, rise, settling, overshoot,
+         * peakVoltage, effort, energy
+         */
+        static bool parseObjectives(const std::string& list, std::vector<Objective>& objectives, std::string& error);
+        static const char* objectiveName(Objective objective);
+
+        /**
+         * Not thread-safe, set before evaluating; draws the noise of
+         * generation 0, used until the first beginGeneration()
+         * @param sensorNoise standard deviation of the measured position (m)
+         * @param actuatorNoise standard deviation of the applied voltage (V)
+         * @param loadDisturbance standard deviation of a load torque that
+         * steps in at a random time before the timeout, as a fraction of
+         * the stall torque
+         * @param samples draws averaged by each evaluation
+         */
+        void setNoise(double sensorNoise, double actuatorNoise, double loadDisturbance, unsigned int samples, unsigned long seed);
+
+        /**
+         * Follows setpoints from rest, then holds the last one until the
+         * position has stayed within threshold of it for timein or timeout
+         * has passed; noise-free and thread-safe, the arrays are only read
+         * @param setpoints position each step (m), at least one
+         * @param disturbances load torque at the motor each step (N m), NULL for none
+         * @param period seconds per step
+         * @return integral of |setpoint - position|, success if within
+         * threshold at the end
+         */
+        Processor::Score track(Algo* a, const double* setpoints, const double* disturbances, unsigned long long length, double period, const std::string& logname="") const;
+
     private:
+        Processor::Score simulate(Algo* a, const std::string& logname, Processor::Response& response) const;
+        Processor::Score simulateSample(Algo* a, const std::string& logname, unsigned int sample, Processor::Response& response) const;
+
+        /**
+         * Motor torque against speed, a load torque and friction
+         */
+        double acceleration(double voltage, double loadTorque, double omega) const;
+
         const double m_timeout;
         const double m_timein;
         const double m_threshold;
@@ -47,6 +125,18 @@ class PID1DProcessor : public virtual Processor
         const double m_wheelDiameter;
         const double m_staticFriction;
         const double m_kineticFriction;
+        std::vector<Objective> m_objectives;
+        double m_sensorNoise;
+        double m_actuatorNoise;
+        double m_loadDisturbance;
+        unsigned int m_noiseSamples;
+        unsigned long m_noiseSeed;
+        unsigned int m_noiseSteps;
+        // Draws of the current generation, samples rows of m_noiseSteps
+        mutable std::vector<double> m_sensorDraws;
+        mutable std::vector<double> m_actuatorDraws;
+        mutable std::vector<double> m_loadTimes;
+        mutable std::vector<double> m_loadTorques;
 };
 
 #endif // PID_1D_PROCESSOR_HPP
@@ -101,9 +101,32 @@ Algo* PIDAlgo::gen() const
     return new PIDAlgo(m_kP->gen(), m_kI->gen(), m_kD->gen(), m_maxPower, m_minPower);
 }
 
+Algo* PIDAlgo::clone(const std::vector<double>& genes) const
+{
+    return new PIDAlgo(m_kP->clone(genes.at(0)), m_kI->clone(genes.at(1)), m_kD->clone(genes.at(2)), m_maxPower, m_minPower);
+}
+
 std::string PIDAlgo::getSummary() const
 {
     std::stringstream ss;
     ss << "kP: " << m_kP->get() << "kI: " << m_kI->get() << "kD: " << m_kD->get() << std::endl;
     return ss.str();
 }
+
+std::vector<double> PIDAlgo::getGenes() const
+{
+    std::vector<double> genes(3);
+    genes[0] = m_kP->get();
+    genes[1] = m_kI->get();
+    genes[2] = m_kD->get();
+    return genes;
+}
+
+std::vector<std::string> PIDAlgo::getGeneNames() const
+{
+    std::vector<std::string> names(3);
+    names[0] = "kP";
+    names[1] = "kI";
+    names[2] = "kD";
+    return names;
+}
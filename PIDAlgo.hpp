@@ -38,7 +38,10 @@ class PIDAlgo : public virtual Algo
         virtual std::vector<double> update(const std::vector<double>& inputs);
         virtual void finalize();
         virtual Algo* gen() const;
+        virtual Algo* clone(const std::vector<double>& genes) const;
         virtual std::string getSummary() const;
+        virtual std::vector<double> getGenes() const;
+        virtual std::vector<std::string> getGeneNames() const;
     private:
         PIDAlgo(const PIDAlgo& pidalgo);
         const PIDAlgo& operator=(const PIDAlgo& pidalgo);
@@ -22,6 +22,8 @@
 /**
  * Generic Genetic Parameter Class
  * Has two methods for getting a value and generating a child of the parameter
+ * clone() makes a parameter with the same mutation settings holding a given
+ * value, e.g. one restored from a saved population
  * T represents the data type stored
  **/
 
@@ -29,7 +31,9 @@ template<typename T>
 class Param
 {
     public:
+        virtual ~Param() {}
         virtual const T& get() const = 0;
         virtual Param<T>* gen() const = 0;
+        virtual Param<T>* clone(const T& value) const = 0;
 };
 #endif // PARAM_HPP
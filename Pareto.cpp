@@ -0,0 +1,334 @@
+/*
+ *  Pareto.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Pareto.hpp"
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <pthread.h>
+
+// Below this many objective values the threads cost more than they save
+static const unsigned int s_minParallelValues = 4096;
+
+bool dominates(const double* a, const double* b, unsigned int numObjectives)
+{
+    bool better = false;
+    for(unsigned int j = 0; j < numObjectives; j++)
+    {
+        if (a[j] > b[j])
+        {
+            return false;
+        }
+        better = better || a[j] < b[j];
+    }
+    return better;
+}
+
+struct lexicographicOrder
+{
+    const double* objectives;
+    unsigned int numObjectives;
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        const double* l = objectives + (size_t) lhs * numObjectives;
+        const double* r = objectives + (size_t) rhs * numObjectives;
+        for(unsigned int j = 0; j < numObjectives; j++)
+        {
+            if (l[j] != r[j])
+            {
+                return l[j] < r[j];
+            }
+        }
+        return lhs < rhs;
+    }
+};
+
+unsigned int nondominatedSort(const double* objectives, unsigned int count, unsigned int numObjectives, unsigned int* ranks)
+{
+    std::vector<unsigned int> order(count);
+    for(unsigned int i = 0; i < count; i++)
+    {
+        order[i] = i;
+    }
+    lexicographicOrder lexicographic = {objectives, numObjectives};
+    std::sort(order.begin(), order.end(), lexicographic);
+
+    if (numObjectives == 2)
+    {
+        // Second objective of each front's newest member, increasing with the front
+        std::vector<double> last;
+        for(unsigned int n = 0; n < count; n++)
+        {
+            unsigned int i = order[n];
+            const double* p = objectives + (size_t) i * 2;
+            if (n > 0)
+            {
+                unsigned int previous = order[n - 1];
+                const double* q = objectives + (size_t) previous * 2;
+                if (p[0] == q[0] && p[1] == q[1])
+                {
+                    // A duplicate does not dominate its twin
+                    ranks[i] = ranks[previous];
+                    continue;
+                }
+            }
+            unsigned int front = std::upper_bound(last.begin(), last.end(), p[1]) - last.begin();
+            if (front == last.size())
+            {
+                last.push_back(p[1]);
+            }
+            else
+            {
+                last[front] = p[1];
+            }
+            ranks[i] = front;
+        }
+        return last.size();
+    }
+
+    if (numObjectives == 3)
+    {
+        // Each front's minima in the last two objectives, the third decreasing with the second
+        std::vector<std::map<double, double> > fronts;
+        for(unsigned int n = 0; n < count; n++)
+        {
+            unsigned int i = order[n];
+            const double* p = objectives + (size_t) i * 3;
+            if (n > 0)
+            {
+                unsigned int previous = order[n - 1];
+                const double* q = objectives + (size_t) previous * 3;
+                if (p[0] == q[0] && p[1] == q[1] && p[2] == q[2])
+                {
+                    ranks[i] = ranks[previous];
+                    continue;
+                }
+            }
+            unsigned int lo = 0, hi = fronts.size();
+            while (lo < hi)
+            {
+                unsigned int mid = lo + (hi - lo) / 2;
+                std::map<double, double>::const_iterator it = fronts[mid].upper_bound(p[1]);
+                if (it != fronts[mid].begin() && (--it)->second <= p[2])
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            if (lo == fronts.size())
+            {
+                fronts.push_back(std::map<double, double>());
+            }
+            std::map<double, double>& staircase = fronts[lo];
+            std::map<double, double>::iterator it = staircase.lower_bound(p[1]);
+            while (it != staircase.end() && it->second >= p[2])
+            {
+                staircase.erase(it++);
+            }
+            staircase[p[1]] = p[2];
+            ranks[i] = lo;
+        }
+        return fronts.size();
+    }
+
+    std::vector<std::vector<unsigned int> > fronts;
+    for(unsigned int n = 0; n < count; n++)
+    {
+        unsigned int i = order[n];
+        const double* p = objectives + (size_t) i * numObjectives;
+        // First front with no member dominating p; fronts before it all do
+        unsigned int lo = 0, hi = fronts.size();
+        while (lo < hi)
+        {
+            unsigned int mid = lo + (hi - lo) / 2;
+            const std::vector<unsigned int>& front = fronts[mid];
+            bool dominated = false;
+            for(unsigned int k = front.size(); k > 0 && !dominated; k--)
+            {
+                dominated = dominates(objectives + (size_t) front[k - 1] * numObjectives, p, numObjectives);
+            }
+            if (dominated)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        if (lo == fronts.size())
+        {
+            fronts.push_back(std::vector<unsigned int>());
+        }
+        fronts[lo].push_back(i);
+        ranks[i] = lo;
+    }
+    return fronts.size();
+}
+
+struct lowerScore
+{
+    const Processor::Score* scores;
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        if (scores[lhs].score != scores[rhs].score)
+        {
+            return scores[lhs].score < scores[rhs].score;
+        }
+        return lhs < rhs;
+    }
+};
+
+/**
+ * Sorts the points listed in members among themselves, numbering their
+ * fronts from firstRank
+ * @return number of fronts
+ */
+static unsigned int sortMembers(const double* objectives, const std::vector<unsigned int>& members, unsigned int numObjectives, unsigned int firstRank, unsigned int* ranks)
+{
+    std::vector<double> packed(members.size() * numObjectives);
+    for(unsigned int n = 0; n < members.size(); n++)
+    {
+        std::copy(objectives + (size_t) members[n] * numObjectives, objectives + (size_t) (members[n] + 1) * numObjectives, &packed[(size_t) n * numObjectives]);
+    }
+    std::vector<unsigned int> packedRanks(members.size());
+    unsigned int numFronts = nondominatedSort(&packed[0], members.size(), numObjectives, &packedRanks[0]);
+    for(unsigned int n = 0; n < members.size(); n++)
+    {
+        ranks[members[n]] = firstRank + packedRanks[n];
+    }
+    return numFronts;
+}
+
+unsigned int constrainedSort(const double* objectives, const Processor::Score* scores, unsigned int count, unsigned int numObjectives, unsigned int* ranks)
+{
+    std::vector<unsigned int> feasible, failed;
+    for(unsigned int i = 0; i < count; i++)
+    {
+        (scores[i].success ? feasible : failed).push_back(i);
+    }
+    unsigned int numFronts = 0;
+    if (feasible.size())
+    {
+        numFronts = sortMembers(objectives, feasible, numObjectives, 0, ranks);
+    }
+    lowerScore byScore = {scores};
+    std::sort(failed.begin(), failed.end(), byScore);
+    std::vector<unsigned int> tied;
+    for(unsigned int n = 0; n < failed.size(); n++)
+    {
+        tied.push_back(failed[n]);
+        if (n + 1 == failed.size() || scores[failed[n + 1]].score != scores[failed[n]].score)
+        {
+            numFronts += sortMembers(objectives, tied, numObjectives, numFronts, ranks);
+            tied.clear();
+        }
+    }
+    return numFronts;
+}
+
+struct crowdingData
+{
+    const double* objectives;
+    unsigned int numObjectives;
+    unsigned int count;
+    const std::vector<std::vector<unsigned int> >* fronts;
+    unsigned int numTasks;
+    unsigned int* next;
+    double* contributions;
+};
+
+/**
+ * Takes (front, objective) tasks off the shared cursor, each writing only
+ * its own objective's row of contributions for its own front's points
+ */
+static void* crowdingWorker(void* param)
+{
+    crowdingData* cd = static_cast<crowdingData*>(param);
+    std::vector<unsigned int> sorted;
+    while (true)
+    {
+        unsigned int task = __sync_fetch_and_add(cd->next, 1);
+        if (task >= cd->numTasks)
+        {
+            break;
+        }
+        unsigned int j = task % cd->numObjectives;
+        sorted = (*cd->fronts)[task / cd->numObjectives];
+        double* contribution = cd->contributions + (size_t) j * cd->count;
+        objectiveOrder byObjective = {cd->objectives, cd->numObjectives, j};
+        std::sort(sorted.begin(), sorted.end(), byObjective);
+        unsigned int size = sorted.size();
+        double lo = cd->objectives[(size_t) sorted[0] * cd->numObjectives + j];
+        double range = cd->objectives[(size_t) sorted[size - 1] * cd->numObjectives + j] - lo;
+        contribution[sorted[0]] = HUGE_VAL;
+        contribution[sorted[size - 1]] = HUGE_VAL;
+        for(unsigned int k = 1; k + 1 < size; k++)
+        {
+            double before = cd->objectives[(size_t) sorted[k - 1] * cd->numObjectives + j];
+            double after = cd->objectives[(size_t) sorted[k + 1] * cd->numObjectives + j];
+            // Failed scores may leave infinite objectives, which add nothing
+            contribution[sorted[k]] = range > 0 && range < HUGE_VAL ? (after - before) / range : 0.0;
+        }
+    }
+    return 0;
+}
+
+void crowdingDistances(const double* objectives, unsigned int count, unsigned int numObjectives, const unsigned int* ranks, unsigned int numFronts, unsigned int numThreads, double* distances)
+{
+    std::vector<std::vector<unsigned int> > fronts(numFronts);
+    for(unsigned int i = 0; i < count; i++)
+    {
+        fronts[ranks[i]].push_back(i);
+    }
+    std::vector<double> contributions((size_t) count * numObjectives);
+    unsigned int next = 0;
+    crowdingData cd = {objectives, numObjectives, count, &fronts, numFronts * numObjectives, &next, &contributions[0]};
+    numThreads = std::min(numThreads, cd.numTasks);
+    if (numThreads <= 1 || (size_t) count * numObjectives < s_minParallelValues)
+    {
+        crowdingWorker(&cd);
+    }
+    else
+    {
+        std::vector<pthread_t> threads(numThreads);
+        for(unsigned int t = 0; t < numThreads; t++)
+        {
+            pthread_create(&threads[t], NULL, crowdingWorker, &cd);
+        }
+        for(unsigned int t = 0; t < numThreads; t++)
+        {
+            pthread_join(threads[t], NULL);
+        }
+    }
+    for(unsigned int i = 0; i < count; i++)
+    {
+        double distance = 0.0;
+        for(unsigned int j = 0; j < numObjectives; j++)
+        {
+            distance += contributions[(size_t) j * count + i];
+        }
+        distances[i] = distance;
+    }
+}
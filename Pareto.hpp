@@ -0,0 +1,122 @@
+/*
+ *  Pareto.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARETO_HPP
+#define PARETO_HPP
+
+#include "Processor.hpp"
+
+#include <stddef.h>
+#include <vector>
+
+class Algo;
+
+/**
+ * Non-dominated sorting and crowding distance for NSGA-II, see God::simulatePareto()
+ * Objectives are count rows of numObjectives doubles, all minimized. Ranks
+ * number the fronts from 0, the non-dominated points.
+ *
+ * The sort is Efficient Non-dominated Sort (Zhang et al. 2015): points are
+ * sorted lexicographically, so none can dominate one before it, and each
+ * joins the first front with no member dominating it, found by binary search
+ * over the fronts. For two objectives a front is dominated exactly when its
+ * last member's second objective is not above the point's, which makes the
+ * search O(log F) and the sort O(N log N). For three, each front keeps the
+ * staircase of its members' minima in the last two objectives in a sorted
+ * map, which answers the same question in O(log N), so O(N log^2 N). Beyond
+ * three it compares against front members, newest first, and is
+ * O(M N sqrt N) on typical populations instead of O(M N^2).
+ **/
+
+struct ParetoPoint
+{
+    Algo* algo;
+    Processor::Score score;
+    std::vector<double> objectives;
+};
+
+/**
+ * Orders point indices by one objective, ties by index
+ */
+struct objectiveOrder
+{
+    const double* objectives;
+    unsigned int numObjectives;
+    unsigned int objective;
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        double l = objectives[(size_t) lhs * numObjectives + objective];
+        double r = objectives[(size_t) rhs * numObjectives + objective];
+        if (l != r)
+        {
+            return l < r;
+        }
+        return lhs < rhs;
+    }
+};
+
+/**
+ * NSGA-II's crowded comparison: lower front first, then the less crowded,
+ * ties by index
+ */
+struct crowdedOrder
+{
+    const unsigned int* ranks;
+    const double* crowding;
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        if (ranks[lhs] != ranks[rhs])
+        {
+            return ranks[lhs] < ranks[rhs];
+        }
+        if (crowding[lhs] != crowding[rhs])
+        {
+            return crowding[lhs] > crowding[rhs];
+        }
+        return lhs < rhs;
+    }
+};
+
+/**
+ * @return true if a is no worse than b in every objective and better in one
+ */
+bool dominates(const double* a, const double* b, unsigned int numObjectives);
+
+/**
+ * @param ranks receives the front of each point
+ * @return number of fronts
+ */
+unsigned int nondominatedSort(const double* objectives, unsigned int count, unsigned int numObjectives, unsigned int* ranks);
+
+/**
+ * Fronts with failed scores last: successful points are sorted on their
+ * objectives, then failed ones by score, lowest first, and points failing
+ * with equal scores on their objectives
+ */
+unsigned int constrainedSort(const double* objectives, const Processor::Score* scores, unsigned int count, unsigned int numObjectives, unsigned int* ranks);
+
+/**
+ * Crowding distance of every point within its front, infinite at the ends
+ * of each objective; one task per front and objective, shared by numThreads
+ * threads. The result does not depend on numThreads
+ */
+void crowdingDistances(const double* objectives, unsigned int count, unsigned int numObjectives, const unsigned int* ranks, unsigned int numFronts, unsigned int numThreads, double* distances);
+
+#endif // PARETO_HPP
@@ -0,0 +1,115 @@
+/*
+ *  PerfCounters.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PerfCounters.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+
+static const unsigned long long s_configs[PerfCounters::numCounters] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES
+};
+
+static int openCounter(unsigned long long config, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+PerfCounters::PerfCounters()
+{
+    for(unsigned int i = 0; i < numCounters; i++)
+    {
+        m_fds[i] = -1;
+    }
+#ifdef __linux__
+    m_fds[0] = openCounter(s_configs[0], -1);
+    if (m_fds[0] < 0)
+    {
+        // Every evaluation thread gets here, only the first one warns
+        static int warned = 0;
+        if (__sync_bool_compare_and_swap(&warned, 0, 1))
+        {
+            fprintf(stderr, "Hardware performance counters unavailable: %s\n", strerror(errno));
+        }
+        return;
+    }
+    for(unsigned int i = 1; i < numCounters; i++)
+    {
+        m_fds[i] = openCounter(s_configs[i], m_fds[0]);
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+    for(unsigned int i = 0; i < numCounters; i++)
+    {
+        if (m_fds[i] >= 0)
+        {
+            close(m_fds[i]);
+        }
+    }
+}
+
+bool PerfCounters::available() const
+{
+    return m_fds[0] >= 0;
+}
+
+PerfSample PerfCounters::read() const
+{
+    unsigned long long values[numCounters] = {0, 0, 0, 0};
+#ifdef __linux__
+    for(unsigned int i = 0; i < numCounters; i++)
+    {
+        // value, time enabled, time running, id
+        uint64_t buf[4];
+        if (m_fds[i] < 0 || ::read(m_fds[i], buf, sizeof(buf)) != sizeof(buf))
+        {
+            continue;
+        }
+        values[i] = buf[0];
+        if (buf[2] > 0 && buf[2] < buf[1])
+        {
+            // Scale up for the time the group was multiplexed out
+            values[i] = (unsigned long long) ((double) buf[0] * buf[1] / buf[2]);
+        }
+    }
+#endif
+    PerfSample s = {values[0], values[1], values[2], values[3]};
+    return s;
+}
@@ -0,0 +1,70 @@
+/*
+ *  PerfCounters.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+/**
+ * Hardware performance counters of the calling thread via perf_event_open
+ * Counts cycles, instructions, branch misses and cache misses as one group
+ * so they are scheduled together, scaled for multiplexing. Counters the
+ * host does not support or permit (see /proc/sys/kernel/perf_event_paranoid)
+ * read as zero; if cycles cannot be opened the whole group is unavailable.
+ * Only the thread that constructed a PerfCounters may read it.
+ * Always unavailable on platforms other than Linux
+ **/
+
+struct PerfSample
+{
+    unsigned long long cycles;
+    unsigned long long instructions;
+    unsigned long long branchMisses;
+    unsigned long long cacheMisses;
+
+    PerfSample& operator+=(const PerfSample& rhs)
+    {
+        cycles += rhs.cycles;
+        instructions += rhs.instructions;
+        branchMisses += rhs.branchMisses;
+        cacheMisses += rhs.cacheMisses;
+        return *this;
+    }
+
+    PerfSample operator-(const PerfSample& rhs) const
+    {
+        PerfSample s = {cycles - rhs.cycles, instructions - rhs.instructions, branchMisses - rhs.branchMisses, cacheMisses - rhs.cacheMisses};
+        return s;
+    }
+};
+
+class PerfCounters
+{
+    public:
+        static const unsigned int numCounters = 4;
+
+        PerfCounters();
+        ~PerfCounters();
+        bool available() const;
+        PerfSample read() const;
+    private:
+        PerfCounters(const PerfCounters& perfCounters);
+        const PerfCounters& operator=(const PerfCounters& perfCounters);
+        int m_fds[numCounters];
+};
+
+#endif // PERF_COUNTERS_HPP
@@ -0,0 +1,161 @@
+/*
+ *  Population.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Population.hpp"
+
+#include "Algo.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string.h>
+
+static const char* const header = "# genetics population";
+static const char* const configPrefix = "# config ";
+
+bool betterSavedAlgo(const SavedAlgo& lhs, const SavedAlgo& rhs)
+{
+    if (lhs.score.success != rhs.score.success)
+    {
+        return lhs.score.success;
+    }
+    return lhs.score.score < rhs.score.score;
+}
+
+bool savePopulation(const std::string& filename, const std::vector<std::string>& geneNames, std::vector<SavedAlgo> algos, const std::string& config, std::string& error)
+{
+    std::ofstream out(filename.c_str());
+    if (!out)
+    {
+        error = "cannot write " + filename;
+        return false;
+    }
+    std::stable_sort(algos.begin(), algos.end(), betterSavedAlgo);
+    out.precision(17);
+    out << header << std::endl;
+    std::istringstream lines(config);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        out << configPrefix << line << std::endl;
+    }
+    out << "genes";
+    for(unsigned int i = 0; i < geneNames.size(); i++)
+    {
+        out << " " << geneNames[i];
+    }
+    out << std::endl;
+    for(unsigned int i = 0; i < algos.size(); i++)
+    {
+        out << algos[i].score.success << " " << algos[i].score.score;
+        for(unsigned int j = 0; j < algos[i].genes.size(); j++)
+        {
+            out << " " << algos[i].genes[j];
+        }
+        out << std::endl;
+    }
+    if (!out)
+    {
+        error = "cannot write " + filename;
+        return false;
+    }
+    return true;
+}
+
+bool loadPopulation(const std::string& filename, std::vector<std::string>& geneNames, std::vector<SavedAlgo>& algos, std::string& config, std::string& error)
+{
+    std::ifstream in(filename.c_str());
+    std::string line;
+    if (!in || !std::getline(in, line) || line != header)
+    {
+        error = filename + " is not a saved population";
+        return false;
+    }
+    geneNames.clear();
+    algos.clear();
+    config.clear();
+    unsigned int lineNum = 1;
+    bool haveGenes = false;
+    while (std::getline(in, line))
+    {
+        lineNum++;
+        std::stringstream where;
+        where << filename << ":" << lineNum << ": ";
+        if (line.compare(0, strlen(configPrefix), configPrefix) == 0)
+        {
+            config += line.substr(strlen(configPrefix)) + "\n";
+            continue;
+        }
+        std::istringstream fields(line);
+        if (line == "genes" || line.compare(0, 6, "genes ") == 0)
+        {
+            std::string name;
+            fields >> name;
+            while (fields >> name)
+            {
+                geneNames.push_back(name);
+            }
+            haveGenes = true;
+            continue;
+        }
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        SavedAlgo algo;
+        int success;
+        double gene;
+        if (!haveGenes || !(fields >> success >> algo.score.score))
+        {
+            error = where.str() + "expected <success> <score> <gene>...";
+            return false;
+        }
+        algo.score.success = success != 0;
+        while (fields >> gene)
+        {
+            algo.genes.push_back(gene);
+        }
+        if (algo.genes.size() != geneNames.size() || !fields.eof())
+        {
+            error = where.str() + "gene count does not match the genes line";
+            return false;
+        }
+        algos.push_back(algo);
+    }
+    if (algos.empty())
+    {
+        error = filename + " holds no algorithms";
+        return false;
+    }
+    return true;
+}
+
+bool restorePopulation(const Algo& prototype, const std::vector<std::string>& geneNames, const std::vector<SavedAlgo>& algos, std::vector<Algo*>& restored, std::string& error)
+{
+    if (geneNames != prototype.getGeneNames())
+    {
+        error = "saved genes do not match the algorithm's";
+        return false;
+    }
+    restored.resize(algos.size());
+    for(unsigned int i = 0; i < algos.size(); i++)
+    {
+        restored[i] = prototype.clone(algos[i].genes);
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+ *  Population.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POPULATION_HPP
+#define POPULATION_HPP
+
+#include "Processor.hpp"
+
+#include <string>
+#include <vector>
+
+class Algo;
+
+/**
+ * Saved algorithms for warm starts
+ * A file holds the run configuration the algorithms were scored under, so a
+ * warm start can report how the plant changed, then one algorithm per line
+ * with its score and genes:
+ *   # genetics population
+ *   # config <key> = <value>
+ *   genes <name>...
+ *   <success> <score> <gene>...
+ * Algorithms are written best first
+ **/
+
+struct SavedAlgo
+{
+    Processor::Score score;
+    std::vector<double> genes;
+};
+
+/**
+ * Success first, then lower scores, as God::minScoreHeap ranks them
+ */
+bool betterSavedAlgo(const SavedAlgo& lhs, const SavedAlgo& rhs);
+
+/**
+ * @param config configToString() of the run, may be empty
+ */
+bool savePopulation(const std::string& filename, const std::vector<std::string>& geneNames, std::vector<SavedAlgo> algos, const std::string& config, std::string& error);
+bool loadPopulation(const std::string& filename, std::vector<std::string>& geneNames, std::vector<SavedAlgo>& algos, std::string& config, std::string& error);
+
+/**
+ * Rebuilds algorithms with the prototype's kind and mutation settings
+ * @return false if the gene names do not match the prototype's
+ */
+bool restorePopulation(const Algo& prototype, const std::vector<std::string>& geneNames, const std::vector<SavedAlgo>& algos, std::vector<Algo*>& restored, std::string& error);
+
+#endif // POPULATION_HPP
@@ -19,6 +19,7 @@
 #ifndef PROCESSOR_HPP
 #define PROCESSOR_HPP
 
+#include <math.h>
 #include <string>
 
 class Algo;
@@ -31,6 +32,19 @@ class Algo;
  * applications
  * Implementations of process() shall log select data to a textfile iff the length
  * of logname > 0
+ * processBatch() scores several algorithms at once; the default runs
+ * process() on each, processors with a per-call round trip override it
+ * processObjectives() scores an algorithm on numObjectives() values, all
+ * minimized, for multi-objective selection; the default is the score alone
+ * Processors that measure the step response while simulating report it
+ * through processResponse() and say so with hasResponse(); the default
+ * leaves every measurement NaN
+ * God calls beginGeneration() before evaluating each generation, never
+ * while an evaluation runs, so a stochastic plant can draw the noise every
+ * algorithm of that generation will share
+ * A score that is the mean over numSamples() samples, such as noise draws
+ * or scenarios, can be taken one sample at a time with processSample(),
+ * which lets God race algorithms on a few samples instead of all of them
  */
 
 class Processor
@@ -41,8 +55,85 @@ class Processor
             double score;
         };
 
+        /**
+         * Step response of one evaluation, all measured in the loop
+         */
+        struct Response {
+            double error;        // integral of |goal - position| (m s)
+            double riseTime;     // from 10% to 90% of the goal (s)
+            double settlingTime; // until the position stays within threshold (s)
+            double overshoot;    // furthest past the goal (m)
+            double peakVoltage;  // largest |output| (V)
+            double effort;       // integral of |output| (V s)
+            double energy;       // integral of output squared (V^2 s)
+        };
+
+        virtual ~Processor() {}
         virtual Score process(Algo* a, std::string logname="") const = 0;
-        
+
+        virtual void processBatch(Algo* const* algos, unsigned int count, Score* scores) const
+        {
+            for(unsigned int i = 0; i < count; i++)
+            {
+                scores[i] = process(algos[i]);
+            }
+        }
+
+        virtual unsigned int numObjectives() const
+        {
+            return 1;
+        }
+
+        virtual Score processObjectives(Algo* a, double* objectives) const
+        {
+            Score score = process(a);
+            objectives[0] = score.score;
+            return score;
+        }
+
+        virtual bool hasResponse() const
+        {
+            return false;
+        }
+
+        virtual Score processResponse(Algo* a, Response& response) const
+        {
+            Response unknown = {NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+            response = unknown;
+            return process(a);
+        }
+
+        virtual void processResponses(Algo* const* algos, unsigned int count, Score* scores, Response* responses) const
+        {
+            for(unsigned int i = 0; i < count; i++)
+            {
+                scores[i] = processResponse(algos[i], responses[i]);
+            }
+        }
+
+        virtual unsigned int numSamples() const
+        {
+            return 1;
+        }
+
+        /**
+         * Thread-safe as process(); process() scores the mean over every
+         * sample and fails if any sample fails
+         */
+        virtual Score processSample(Algo* a, unsigned int sample) const
+        {
+            return process(a);
+        }
+
+        /**
+         * @return true if scores of earlier generations no longer compare
+         * with this one's, so they must be evaluated again
+         */
+        virtual bool beginGeneration(unsigned int generation) const
+        {
+            return false;
+        }
+
 };
 
 #endif //PROCESSOR_HPP
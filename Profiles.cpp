@@ -0,0 +1,121 @@
+/*
+ *  Profiles.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TrajectoryFile.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * Converts recorded profiles to a TrajectoryFile for --trajectories
+ * Each CSV file is one profile, one step per line: the setpoint (m) and
+ * optionally the load torque at the motor (N m). Lines starting with '#'
+ * and lines that do not start with a number, such as a header, are
+ * skipped.
+ *
+ * Usage: genetics-profiles --out file [--rate Hz] profile.csv ...
+ **/
+
+/**
+ * @return false if the file cannot be read or has no steps
+ */
+static bool readProfile(const char* filename, std::vector<double>& setpoints, std::vector<double>& disturbances)
+{
+    std::ifstream in(filename);
+    std::string line;
+    bool disturbed = false;
+    while (in && std::getline(in, line))
+    {
+        for(unsigned int i = 0; i < line.size(); i++)
+        {
+            line[i] = line[i] == ',' || line[i] == ';' ? ' ' : line[i];
+        }
+        std::stringstream ss(line);
+        double setpoint, disturbance;
+        if (line.empty() || line[0] == '#' || !(ss >> setpoint))
+        {
+            continue;
+        }
+        if (ss >> disturbance)
+        {
+            disturbances.resize(setpoints.size(), 0.0);
+            disturbances.push_back(disturbance);
+            disturbed = true;
+        }
+        else if (disturbed)
+        {
+            disturbances.push_back(0.0);
+        }
+        setpoints.push_back(setpoint);
+    }
+    return in.eof() && setpoints.size();
+}
+
+int main(int argc, char** argv)
+{
+    std::string out;
+    double rate = 1000;
+    std::vector<const char*> inputs;
+    for(int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc)
+        {
+            out = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc)
+        {
+            rate = atof(argv[++i]);
+        }
+        else
+        {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (out.empty() || inputs.empty() || !(rate > 0))
+    {
+        fprintf(stderr, "Usage: %s --out file [--rate Hz] profile.csv ...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<std::vector<double> > setpoints(inputs.size()), disturbances(inputs.size());
+    for(unsigned int i = 0; i < inputs.size(); i++)
+    {
+        if (!readProfile(inputs[i], setpoints[i], disturbances[i]))
+        {
+            fprintf(stderr, "Cannot read a profile from %s\n", inputs[i]);
+            return 1;
+        }
+    }
+    std::string error;
+    if (!TrajectoryFile::write(out, 1.0 / rate, setpoints, disturbances, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    for(unsigned int i = 0; i < inputs.size(); i++)
+    {
+        printf("%s: %u steps%s\n", inputs[i], (unsigned int) setpoints[i].size(), disturbances[i].size() ? " with disturbances" : "");
+    }
+    printf("Wrote %u profiles at %g Hz to %s\n", (unsigned int) inputs.size(), rate, out.c_str());
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ *  Protocol.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Protocol.hpp"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+LineReader::LineReader(int fd)
+    : m_fd(fd)
+{
+}
+
+bool LineReader::readLine(std::string& line)
+{
+    while (!nextLine(line))
+    {
+        if (!fill())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LineReader::fill()
+{
+    while (true)
+    {
+        char buf[4096];
+        ssize_t n = read(m_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        m_buffer.append(buf, n);
+        return true;
+    }
+}
+
+bool LineReader::nextLine(std::string& line)
+{
+    size_t end = m_buffer.find('\n');
+    if (end == std::string::npos)
+    {
+        return false;
+    }
+    line = m_buffer.substr(0, end);
+    m_buffer.erase(0, end + 1);
+    return true;
+}
+
+bool writeLine(int fd, const std::string& line)
+{
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
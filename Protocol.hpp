@@ -0,0 +1,83 @@
+/*
+ *  Protocol.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <string>
+
+/**
+ * Line protocol between geneticsd and genetics-client over a Unix-domain
+ * stream socket, one request per connection
+ *
+ * Submitting a job, the configuration is the genetics.ini text:
+ *   > SUBMIT <priority> <name>
+ *   > <config line>...
+ *   > END
+ *   < ACCEPTED <id> <jobs ahead>    or    < ERROR <message>
+ *   < STARTED <id>
+ *   < PROGRESS <generation> <generations> <success> <best> <mu> <sigma> <evals/s> <seconds>
+ *   < RESULT <success> <score> <gene>=<value>...
+ * and the daemon closes the connection. Higher priorities run first, equal
+ * ones in submission order.
+ *
+ * Listing the daemon's jobs:
+ *   > STATUS
+ *   < JOB <id> <queued|running> <priority> <name>...
+ *   < END
+ **/
+
+static const char* const defaultSocketPath = "/tmp/geneticsd.sock";
+
+/**
+ * Buffered reader of newline-terminated lines
+ */
+class LineReader
+{
+    public:
+        LineReader(int fd);
+
+        /**
+         * @return false at end of stream or on error
+         */
+        bool readLine(std::string& line);
+
+        /**
+         * Reads what is available once, e.g. after poll() reports the fd readable
+         * @return false at end of stream or on error
+         */
+        bool fill();
+
+        /**
+         * Takes a complete line already read, never blocks
+         * @return false if there is none
+         */
+        bool nextLine(std::string& line);
+
+    private:
+        int m_fd;
+        std::string m_buffer;
+};
+
+/**
+ * Writes the line and a newline, without raising SIGPIPE
+ * @return false if the peer has gone
+ */
+bool writeLine(int fd, const std::string& line);
+
+#endif // PROTOCOL_HPP
@@ -0,0 +1,231 @@
+/*
+ *  QuantileSketch.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QUANTILE_SKETCH_HPP
+#define QUANTILE_SKETCH_HPP
+
+#include <algorithm>
+#include <math.h>
+#include <utility>
+#include <vector>
+
+/**
+ * Mergeable streaming quantile sketch (KLL)
+ * Derived from: Karnin, Lang, Liberty, "Optimal Quantile Approximation in Streams", FOCS 2016
+ * Items live in a stack of compactors; level h items weigh 2^h. A full level
+ * is sorted and every other item (random offset) promoted, so memory stays
+ * O(k) while rank error is roughly 1/k. Min and max are tracked exactly.
+ * Not thread safe: keep one sketch per thread and merge() them
+ **/
+
+class QuantileSketch
+{
+    public:
+        QuantileSketch(unsigned int k=200)
+            : m_k(k < 8 ? 8 : k)
+            , m_n(0)
+            , m_size(0)
+            , m_min(0.0)
+            , m_max(0.0)
+            , m_coin(0x9e3779b9u)
+            , m_compactors(1)
+        {
+        }
+
+        void insert(double x)
+        {
+            if (m_n == 0 || x < m_min)
+            {
+                m_min = x;
+            }
+            if (m_n == 0 || x > m_max)
+            {
+                m_max = x;
+            }
+            m_n++;
+            m_compactors[0].push_back(x);
+            m_size++;
+            if (m_size >= maxSize())
+            {
+                compress();
+            }
+        }
+
+        void merge(const QuantileSketch& other)
+        {
+            if (other.m_n == 0)
+            {
+                return;
+            }
+            if (m_n == 0 || other.m_min < m_min)
+            {
+                m_min = other.m_min;
+            }
+            if (m_n == 0 || other.m_max > m_max)
+            {
+                m_max = other.m_max;
+            }
+            m_n += other.m_n;
+            while (m_compactors.size() < other.m_compactors.size())
+            {
+                m_compactors.push_back(std::vector<double>());
+            }
+            for(unsigned int h = 0; h < other.m_compactors.size(); h++)
+            {
+                const std::vector<double>& src = other.m_compactors[h];
+                m_compactors[h].insert(m_compactors[h].end(), src.begin(), src.end());
+                m_size += src.size();
+            }
+            while (m_size >= maxSize())
+            {
+                compress();
+            }
+        }
+
+        void clear()
+        {
+            m_n = 0;
+            m_size = 0;
+            m_compactors.assign(1, std::vector<double>());
+        }
+
+        unsigned long long count() const
+        {
+            return m_n;
+        }
+
+        /**
+         * @param q rank in [0, 1]
+         * @return approximate q-quantile, 0 if nothing was inserted
+         */
+        double quantile(double q) const
+        {
+            if (m_n == 0)
+            {
+                return 0.0;
+            }
+            if (q <= 0.0)
+            {
+                return m_min;
+            }
+            if (q >= 1.0)
+            {
+                return m_max;
+            }
+            std::vector<std::pair<double, unsigned long long> > weighted;
+            weighted.reserve(m_size);
+            unsigned long long total = 0;
+            for(unsigned int h = 0; h < m_compactors.size(); h++)
+            {
+                for(unsigned int i = 0; i < m_compactors[h].size(); i++)
+                {
+                    weighted.push_back(std::make_pair(m_compactors[h][i], 1ULL << h));
+                    total += 1ULL << h;
+                }
+            }
+            std::sort(weighted.begin(), weighted.end());
+            double target = q * total;
+            unsigned long long cumulative = 0;
+            for(unsigned int i = 0; i < weighted.size(); i++)
+            {
+                cumulative += weighted[i].second;
+                if (cumulative >= target)
+                {
+                    return weighted[i].first;
+                }
+            }
+            return m_max;
+        }
+
+    private:
+        unsigned int capacity(unsigned int h) const
+        {
+            unsigned int depth = m_compactors.size() - 1 - h;
+            unsigned int c = (unsigned int) ceil(m_k * pow(2.0 / 3.0, (double) depth));
+            return c < 2 ? 2 : c;
+        }
+
+        unsigned int maxSize() const
+        {
+            unsigned int size = 0;
+            for(unsigned int h = 0; h < m_compactors.size(); h++)
+            {
+                size += capacity(h);
+            }
+            return size;
+        }
+
+        bool flip()
+        {
+            // xorshift32, cheap and thread local by construction
+            m_coin ^= m_coin << 13;
+            m_coin ^= m_coin >> 17;
+            m_coin ^= m_coin << 5;
+            return m_coin & 1;
+        }
+
+        /**
+         * Compacts the lowest level that is over capacity
+         */
+        void compress()
+        {
+            for(unsigned int h = 0; h < m_compactors.size(); h++)
+            {
+                if (m_compactors[h].size() < capacity(h))
+                {
+                    continue;
+                }
+                if (h + 1 == m_compactors.size())
+                {
+                    m_compactors.push_back(std::vector<double>());
+                }
+                std::vector<double>& level = m_compactors[h];
+                std::sort(level.begin(), level.end());
+                // An odd item out stays behind so weight is conserved
+                double leftover = 0.0;
+                bool odd = level.size() % 2;
+                if (odd)
+                {
+                    leftover = level.back();
+                    level.pop_back();
+                }
+                unsigned int removed = level.size();
+                for(unsigned int i = flip() ? 1 : 0; i < level.size(); i += 2)
+                {
+                    m_compactors[h + 1].push_back(level[i]);
+                }
+                m_size -= removed / 2;
+                level.clear();
+                if (odd)
+                {
+                    level.push_back(leftover);
+                }
+                return;
+            }
+        }
+
+        unsigned int m_k;
+        unsigned long long m_n;
+        unsigned int m_size;
+        double m_min;
+        double m_max;
+        unsigned int m_coin;
+        std::vector<std::vector<double> > m_compactors;
+};
+
+#endif // QUANTILE_SKETCH_HPP
@@ -0,0 +1,207 @@
+/*
+ *  Race.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Race.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+// A range and a variance need two samples
+static const unsigned int s_minSamples = 2;
+
+/**
+ * Best first by the scores so far: success, then the lower mean
+ */
+struct raceOrder
+{
+    const Race* race;
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        Processor::Score l = race->score(lhs);
+        Processor::Score r = race->score(rhs);
+        if (l.success != r.success)
+        {
+            return l.success;
+        }
+        if (l.score != r.score)
+        {
+            return l.score < r.score;
+        }
+        return lhs < rhs;
+    }
+};
+
+Race::Race(unsigned int count, unsigned int numSamples, unsigned int keep, double delta)
+    : m_numSamples(numSamples)
+    , m_keep(std::max(keep, 1U))
+    , m_log(log(3.0 / delta))
+    , m_sample(0)
+    , m_scores((size_t) count * numSamples)
+    , m_sums(count, 0.0)
+    , m_scored(count, 0)
+    , m_failedAt(count, numSamples)
+    , m_state(count, racingState)
+    , m_racers(count)
+{
+    for(unsigned int i = 0; i < count; i++)
+    {
+        m_racers[i] = i;
+    }
+    if (numSamples == 0)
+    {
+        m_racers.clear();
+    }
+}
+
+void Race::record(unsigned int i, Processor::Score score)
+{
+    m_scores[(size_t) i * m_numSamples + m_sample] = score.score;
+    m_sums[i] += score.score;
+    m_scored[i] = m_sample + 1;
+    if (!score.success && m_failedAt[i] > m_sample)
+    {
+        m_failedAt[i] = m_sample;
+    }
+}
+
+void Race::update()
+{
+    m_sample++;
+    if (m_sample >= m_numSamples)
+    {
+        m_racers.clear();
+        return;
+    }
+    if (m_sample < s_minSamples)
+    {
+        return;
+    }
+
+    std::vector<unsigned int> alive;
+    for(unsigned int i = 0; i < m_state.size(); i++)
+    {
+        if (m_state[i] != droppedState)
+        {
+            alive.push_back(i);
+        }
+    }
+    if (alive.size() <= m_keep)
+    {
+        m_racers = alive;
+        return;
+    }
+    raceOrder better = {this};
+    std::sort(alive.begin(), alive.end(), better);
+
+    // A lucky algorithm may rank high on few samples without beating
+    // anything, so beaters are looked for among twice as many
+    unsigned int contenders = std::min((unsigned int) alive.size(), 2 * m_keep);
+    std::vector<unsigned int> outside;
+    for(unsigned int n = m_keep; n < alive.size(); n++)
+    {
+        unsigned int i = alive[n];
+        unsigned int beaten = 0;
+        for(unsigned int t = 0; m_state[i] == racingState && t < contenders && beaten < m_keep; t++)
+        {
+            unsigned int j = alive[t];
+            beaten += j != i && m_state[j] != droppedState && beats(j, i);
+        }
+        if (beaten == m_keep)
+        {
+            m_state[i] = droppedState;
+        }
+        else
+        {
+            outside.push_back(i);
+        }
+    }
+    for(unsigned int t = 0; t < m_keep; t++)
+    {
+        unsigned int i = alive[t];
+        bool ahead = m_state[i] == racingState;
+        for(unsigned int n = 0; ahead && n < outside.size(); n++)
+        {
+            ahead = beats(i, outside[n]);
+        }
+        if (ahead)
+        {
+            m_state[i] = acceptedState;
+        }
+    }
+
+    m_racers.clear();
+    for(unsigned int i = 0; i < m_state.size(); i++)
+    {
+        if (m_state[i] != droppedState)
+        {
+            m_racers.push_back(i);
+        }
+    }
+}
+
+Processor::Score Race::score(unsigned int i) const
+{
+    unsigned int scored = m_scored[i];
+    Processor::Score score = {succeeded(i, scored), scored ? m_sums[i] / scored : HUGE_VAL};
+    return score;
+}
+
+unsigned long long Race::samplesScored() const
+{
+    unsigned long long samples = 0;
+    for(unsigned int i = 0; i < m_scored.size(); i++)
+    {
+        samples += m_scored[i];
+    }
+    return samples;
+}
+
+bool Race::beats(unsigned int winner, unsigned int loser) const
+{
+    unsigned int m = std::min(m_scored[winner], m_scored[loser]);
+    if (m < s_minSamples)
+    {
+        return false;
+    }
+    bool winnerSucceeded = succeeded(winner, m);
+    if (winnerSucceeded != succeeded(loser, m))
+    {
+        return winnerSucceeded;
+    }
+    const double* w = &m_scores[(size_t) winner * m_numSamples];
+    const double* l = &m_scores[(size_t) loser * m_numSamples];
+    double mean = 0.0, lo = HUGE_VAL, hi = -HUGE_VAL;
+    for(unsigned int k = 0; k < m; k++)
+    {
+        double d = l[k] - w[k];
+        mean += d;
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+    }
+    mean /= m;
+    double variance = 0.0;
+    for(unsigned int k = 0; k < m; k++)
+    {
+        double d = l[k] - w[k] - mean;
+        variance += d * d;
+    }
+    variance /= m;
+    double bound = sqrt(2 * variance * m_log / m) + 3 * (hi - lo) * m_log / m;
+    return mean > bound;
+}
@@ -0,0 +1,120 @@
+/*
+ *  Race.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RACE_HPP
+#define RACE_HPP
+
+#include "Processor.hpp"
+
+#include <vector>
+
+/**
+ * Racing selection of the best few of a generation, see God::setRacing()
+ * An algorithm's score is the mean of its scores on numSamples samples,
+ * such as noise draws every algorithm shares. Rather than scoring every
+ * algorithm on every sample, a race scores them all on the first sample and
+ * then, one sample per round, only those not yet dropped. After each
+ * round, an algorithm outside the best keep by mean is dropped once keep of
+ * the best 2 keep beat it, and one inside is accepted, and never dropped,
+ * once it beats every algorithm still outside. The remaining samples go to
+ * the algorithms near the cut and the accepted ones, so every algorithm
+ * that is not dropped ends with the mean of all samples. Those means
+ * compare across generations even when samples differ in difficulty, as
+ * recorded profiles do, which means over the first few would not.
+ *
+ * One algorithm beats another on the samples both have: failing one the
+ * other passed loses outright, otherwise the mean paired difference must
+ * exceed the empirical Bernstein bound (Audibert et al. 2009)
+ *     sqrt(2 V log(3/delta) / m) + 3 R log(3/delta) / m
+ * where V and R are the variance and range of the m differences. Shared
+ * noise keeps the differences of close algorithms small, so they are told
+ * apart in few samples. Nothing is decided before the second sample.
+ **/
+
+class Race
+{
+    public:
+        /**
+         * @param keep algorithms that must come out on top, at least 1
+         * @param delta chance that one comparison is wrong
+         */
+        Race(unsigned int count, unsigned int numSamples, unsigned int keep, double delta);
+
+        /**
+         * Algorithms to score on nextSample(), empty once the race is over
+         */
+        const std::vector<unsigned int>& racers() const
+        {
+            return m_racers;
+        }
+
+        unsigned int nextSample() const
+        {
+            return m_sample;
+        }
+
+        /**
+         * Score of racer i on nextSample(); thread-safe for distinct i
+         */
+        void record(unsigned int i, Processor::Score score);
+
+        /**
+         * Ends the round once every racer is recorded and picks the next
+         */
+        void update();
+
+        bool dropped(unsigned int i) const
+        {
+            return m_state[i] == droppedState;
+        }
+
+        /**
+         * Mean of the samples scored so far, failed if any of them failed
+         */
+        Processor::Score score(unsigned int i) const;
+
+        unsigned long long samplesScored() const;
+
+    private:
+        enum State
+        {
+            racingState,
+            droppedState,
+            acceptedState
+        };
+
+        bool succeeded(unsigned int i, unsigned int samples) const
+        {
+            return m_failedAt[i] >= samples;
+        }
+
+        bool beats(unsigned int winner, unsigned int loser) const;
+
+        unsigned int m_numSamples;
+        unsigned int m_keep;
+        double m_log;
+        unsigned int m_sample;
+        std::vector<double> m_scores;
+        std::vector<double> m_sums;
+        std::vector<unsigned int> m_scored;
+        std::vector<unsigned int> m_failedAt;
+        std::vector<unsigned char> m_state;
+        std::vector<unsigned int> m_racers;
+};
+
+#endif // RACE_HPP
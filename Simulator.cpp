@@ -0,0 +1,164 @@
+/*
+ *  Simulator.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Algo.hpp"
+#include "Config.hpp"
+#include "FitnessDb.hpp"
+#include "PID1DProcessor.hpp"
+#include "SimulatorProcessor.hpp"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Stand-in external simulator for SimulatorProcessor
+ * Reads requests on stdin and answers on stdout, see SimulatorProcessor.hpp
+ * for the protocol, scoring with the built-in plant model of the
+ * configuration given on its command line. For testing the master it can
+ * misbehave: genomes whose gene hash is 0 modulo --hang N are never
+ * answered, those whose hash is 1 modulo --crash N abort, and --exitAfter N
+ * exits cleanly after answering N requests. Exits when stdin closes.
+ *
+ * Usage: genetics-sim [--hang N] [--crash N] [--exitAfter N] [--key=value ...]
+ **/
+
+static bool readFully(int fd, void* data, size_t size)
+{
+    char* p = static_cast<char*>(data);
+    while (size > 0)
+    {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void* data, size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long hang = 0, crash = 0, exitAfter = 0;
+    std::vector<char*> args(1, argv[0]);
+    for(int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--hang") && i + 1 < argc)
+        {
+            hang = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "--crash") && i + 1 < argc)
+        {
+            crash = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "--exitAfter") && i + 1 < argc)
+        {
+            exitAfter = strtoul(argv[++i], NULL, 10);
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+    RunConfig config;
+    std::string error;
+    if (!parseConfigArgs(config, args.size(), &args[0], error) || !validateConfig(config, error))
+    {
+        fprintf(stderr, "%s: %s\n", argv[0], error.size() ? error.c_str() : "see genetics --help for the settings");
+        return 1;
+    }
+    PID1DProcessor* processor = createProcessor(config);
+    Algo* prototype = createSeeds(config)[0];
+
+    unsigned long answered = 0;
+    SimulatorProcessor::RequestHeader request;
+    std::vector<double> genes;
+    std::vector<SimulatorProcessor::Result> results;
+    while (readFully(0, &request, sizeof(request)))
+    {
+        genes.resize(request.count * request.numGenes);
+        if (genes.size() && !readFully(0, &genes[0], genes.size() * sizeof(double)))
+        {
+            break;
+        }
+        results.resize(request.count);
+        for(unsigned int i = 0; i < request.count; i++)
+        {
+            std::vector<double> algoGenes(genes.begin() + i * request.numGenes, genes.begin() + (i + 1) * request.numGenes);
+            unsigned long long hash = fitnessHash(&algoGenes[0], algoGenes.size());
+            if (hang && hash % hang == 0)
+            {
+                while (true)
+                {
+                    pause();
+                }
+            }
+            if (crash && hash % crash == 1)
+            {
+                abort();
+            }
+            Algo* algo = prototype->clone(algoGenes);
+            Processor::Score score = processor->process(algo);
+            delete algo;
+            results[i].score = score.score;
+            results[i].success = score.success;
+            results[i].reserved = 0;
+        }
+        SimulatorProcessor::ResponseHeader response = {request.id, request.count};
+        if (!writeFully(1, &response, sizeof(response)) || (results.size() && !writeFully(1, &results[0], results.size() * sizeof(results[0]))))
+        {
+            break;
+        }
+        if (exitAfter && ++answered >= exitAfter)
+        {
+            break;
+        }
+    }
+    delete prototype;
+    delete processor;
+    return 0;
+}
@@ -0,0 +1,543 @@
+/*
+ *  SimulatorProcessor.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SimulatorProcessor.hpp"
+
+#include "Algo.hpp"
+#include "Timer.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct SimulatorProcessor::Batch
+{
+    uint32_t id;
+    unsigned int attempts;
+    unsigned int numGenes;
+    std::vector<AsyncProcessor::Ticket*> tickets;
+    std::vector<double> genes;
+};
+
+struct SimulatorProcessor::Simulator
+{
+    pid_t pid;
+    int fd;
+    std::string out;
+    std::string in;
+    std::deque<Batch*> inflight;
+    double progress;
+};
+
+static void closeOnExec(int fd)
+{
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+SimulatorProcessor::SimulatorProcessor(const std::vector<std::string>& command, unsigned int numProcesses, unsigned int batchSize, unsigned int pipeline, double timeout, unsigned int maxAttempts, unsigned int maxInFlight)
+    : AsyncProcessor(maxInFlight)
+    , m_command(command)
+    , m_batchSize(batchSize > 0 ? batchSize : 1)
+    , m_pipeline(pipeline > 0 ? pipeline : 1)
+    , m_timeout(timeout)
+    , m_maxAttempts(maxAttempts > 0 ? maxAttempts : 1)
+    , m_started(false)
+    , m_stop(false)
+    , m_open(NULL)
+    , m_nextBatch(0)
+{
+    m_wake[0] = m_wake[1] = -1;
+    memset(&m_stats, 0, sizeof(m_stats));
+    pthread_mutex_init(&m_mutex, NULL);
+    for(unsigned int i = 0; i < (numProcesses > 0 ? numProcesses : 1); i++)
+    {
+        Simulator* s = new Simulator;
+        s->pid = -1;
+        s->fd = -1;
+        s->progress = 0.0;
+        m_simulators.push_back(s);
+    }
+}
+
+SimulatorProcessor::~SimulatorProcessor()
+{
+    if (m_started)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_stop = true;
+        pthread_mutex_unlock(&m_mutex);
+        wake();
+        pthread_join(m_thread, NULL);
+    }
+    for(unsigned int i = 0; i < m_simulators.size(); i++)
+    {
+        if (m_simulators[i]->fd >= 0)
+        {
+            close(m_simulators[i]->fd);
+        }
+    }
+    for(unsigned int i = 0; i < m_simulators.size(); i++)
+    {
+        Simulator* s = m_simulators[i];
+        if (s->pid > 0)
+        {
+            waitpid(s->pid, NULL, 0);
+        }
+        for(unsigned int j = 0; j < s->inflight.size(); j++)
+        {
+            delete s->inflight[j];
+        }
+        delete s;
+    }
+    for(unsigned int i = 0; i < m_queue.size(); i++)
+    {
+        delete m_queue[i];
+    }
+    delete m_open;
+    if (m_wake[0] >= 0)
+    {
+        close(m_wake[0]);
+        close(m_wake[1]);
+    }
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool SimulatorProcessor::start(std::string& error)
+{
+    if (m_command.empty())
+    {
+        error = "no simulator command";
+        return false;
+    }
+    if (pipe(m_wake) != 0)
+    {
+        error = "cannot create pipe";
+        return false;
+    }
+    closeOnExec(m_wake[0]);
+    closeOnExec(m_wake[1]);
+    fcntl(m_wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(m_wake[1], F_SETFL, O_NONBLOCK);
+    for(unsigned int i = 0; i < m_simulators.size(); i++)
+    {
+        if (!spawn(m_simulators[i], error))
+        {
+            return false;
+        }
+    }
+    pthread_create(&m_thread, NULL, io, this);
+    m_started = true;
+    return true;
+}
+
+bool SimulatorProcessor::spawn(Simulator* s, std::string& error)
+{
+    int pair[2], status[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+    {
+        error = std::string("cannot create socket pair: ") + strerror(errno);
+        return false;
+    }
+    closeOnExec(pair[0]);
+    if (pipe(status) != 0)
+    {
+        close(pair[0]);
+        close(pair[1]);
+        error = "cannot create pipe";
+        return false;
+    }
+    closeOnExec(status[0]);
+    closeOnExec(status[1]);
+    std::vector<char*> argv;
+    for(unsigned int i = 0; i < m_command.size(); i++)
+    {
+        argv.push_back(const_cast<char*>(m_command[i].c_str()));
+    }
+    argv.push_back(NULL);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(pair[1], 0);
+        dup2(pair[1], 1);
+        if (pair[1] > 1)
+        {
+            close(pair[1]);
+        }
+        execvp(argv[0], &argv[0]);
+        int e = errno;
+        if (write(status[1], &e, sizeof(e)) < 0)
+        {
+            // Nobody to tell
+        }
+        _exit(127);
+    }
+    close(pair[1]);
+    close(status[1]);
+    if (pid < 0)
+    {
+        close(pair[0]);
+        close(status[0]);
+        error = "cannot fork";
+        return false;
+    }
+    // The status pipe closes on a successful exec, or carries its errno
+    int e;
+    ssize_t n = read(status[0], &e, sizeof(e));
+    close(status[0]);
+    if (n == (ssize_t) sizeof(e))
+    {
+        waitpid(pid, NULL, 0);
+        close(pair[0]);
+        error = "cannot run " + m_command[0] + ": " + strerror(e);
+        return false;
+    }
+    s->pid = pid;
+    s->fd = pair[0];
+    s->in.clear();
+    s->out.clear();
+    return true;
+}
+
+void SimulatorProcessor::submit(Algo* a, const std::string& logname, AsyncProcessor::Ticket* ticket) const
+{
+    std::vector<double> genes = a->getGenes();
+    pthread_mutex_lock(&m_mutex);
+    if (!m_open)
+    {
+        m_open = new Batch;
+        m_open->id = m_nextBatch++;
+        m_open->attempts = 0;
+        m_open->numGenes = genes.size();
+    }
+    m_open->tickets.push_back(ticket);
+    m_open->genes.insert(m_open->genes.end(), genes.begin(), genes.end());
+    bool full = m_open->tickets.size() >= m_batchSize;
+    if (full)
+    {
+        m_queue.push_back(m_open);
+        m_open = NULL;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    if (full)
+    {
+        wake();
+    }
+}
+
+void SimulatorProcessor::flush() const
+{
+    pthread_mutex_lock(&m_mutex);
+    bool queued = m_open != NULL;
+    if (queued)
+    {
+        m_queue.push_back(m_open);
+        m_open = NULL;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    if (queued)
+    {
+        wake();
+    }
+}
+
+SimulatorProcessor::Stats SimulatorProcessor::getStats() const
+{
+    pthread_mutex_lock(&m_mutex);
+    Stats stats = m_stats;
+    stats.processes = m_simulators.size();
+    pthread_mutex_unlock(&m_mutex);
+    return stats;
+}
+
+std::string SimulatorProcessor::getSummary() const
+{
+    Stats stats = getStats();
+    std::stringstream ss;
+    ss << "Simulator: " << stats.processes << " processes Batches: " << stats.batches << " Restarts: " << stats.restarts << " Crashes: " << stats.crashes;
+    ss << " Timeouts: " << stats.timeouts << " Failures: " << stats.failures << std::endl;
+    return ss.str();
+}
+
+void SimulatorProcessor::wake() const
+{
+    char c = 0;
+    if (write(m_wake[1], &c, 1) < 0)
+    {
+        // Pipe full, the I/O thread is awake anyway
+    }
+}
+
+void* SimulatorProcessor::io(void* param)
+{
+    static_cast<SimulatorProcessor*>(param)->run();
+    return 0;
+}
+
+void SimulatorProcessor::run()
+{
+    std::vector<struct pollfd> fds(m_simulators.size() + 1);
+    while (true)
+    {
+        fds[0].fd = m_wake[0];
+        fds[0].events = POLLIN;
+        for(unsigned int i = 0; i < m_simulators.size(); i++)
+        {
+            Simulator* s = m_simulators[i];
+            fds[i + 1].fd = s->fd;
+            fds[i + 1].events = POLLIN | (s->out.size() ? POLLOUT : 0);
+        }
+        for(unsigned int i = 0; i < fds.size(); i++)
+        {
+            fds[i].revents = 0;
+        }
+        // Often enough to notice a hung simulator soon after its deadline
+        poll(&fds[0], fds.size(), (int) (m_timeout * 250) + 1);
+
+        pthread_mutex_lock(&m_mutex);
+        if (m_stop)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return;
+        }
+        char drain[64];
+        while (read(m_wake[0], drain, sizeof(drain)) > 0)
+        {
+        }
+        for(unsigned int i = 0; i < m_simulators.size(); i++)
+        {
+            Simulator* s = m_simulators[i];
+            short revents = fds[i + 1].revents;
+            if (s->fd < 0 || !revents)
+            {
+                continue;
+            }
+            if ((revents & (POLLIN | POLLHUP | POLLERR)) && !receive(s))
+            {
+                restart(s, false);
+            }
+            else if ((revents & POLLOUT) && !send(s))
+            {
+                restart(s, false);
+            }
+        }
+        double now = monotonicTime();
+        for(unsigned int i = 0; i < m_simulators.size(); i++)
+        {
+            Simulator* s = m_simulators[i];
+            if (s->fd >= 0 && s->inflight.size() && now - s->progress > m_timeout * s->inflight.front()->tickets.size())
+            {
+                kill(s->pid, SIGKILL);
+                m_stats.timeouts++;
+                restart(s, true);
+            }
+        }
+        dispatch();
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+bool SimulatorProcessor::receive(Simulator* s)
+{
+    char buf[65536];
+    ssize_t n = read(s->fd, buf, sizeof(buf));
+    if (n <= 0)
+    {
+        return n < 0 && (errno == EAGAIN || errno == EINTR);
+    }
+    s->in.append(buf, n);
+    size_t used = 0;
+    while (s->in.size() - used >= sizeof(ResponseHeader))
+    {
+        ResponseHeader header;
+        memcpy(&header, s->in.data() + used, sizeof(header));
+        size_t size = sizeof(header) + header.count * sizeof(Result);
+        if (s->inflight.empty() || header.id != s->inflight.front()->id || header.count != s->inflight.front()->tickets.size())
+        {
+            return false;
+        }
+        if (s->in.size() - used < size)
+        {
+            break;
+        }
+        Batch* batch = s->inflight.front();
+        s->inflight.pop_front();
+        for(unsigned int i = 0; i < header.count; i++)
+        {
+            Result result;
+            memcpy(&result, s->in.data() + used + sizeof(header) + i * sizeof(Result), sizeof(result));
+            Processor::Score score = {result.success != 0, result.score};
+            complete(batch->tickets[i], score);
+        }
+        delete batch;
+        used += size;
+        s->progress = monotonicTime();
+    }
+    s->in.erase(0, used);
+    return true;
+}
+
+bool SimulatorProcessor::send(Simulator* s)
+{
+    while (s->out.size())
+    {
+        ssize_t n = ::send(s->fd, s->out.data(), s->out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        s->out.erase(0, n);
+    }
+    return true;
+}
+
+void SimulatorProcessor::dispatch()
+{
+    while (!m_queue.empty())
+    {
+        Simulator* target = NULL;
+        bool alive = false;
+        for(unsigned int i = 0; i < m_simulators.size(); i++)
+        {
+            Simulator* s = m_simulators[i];
+            alive = alive || s->fd >= 0;
+            if (s->fd >= 0 && s->inflight.size() < m_pipeline && (!target || s->inflight.size() < target->inflight.size()))
+            {
+                target = s;
+            }
+        }
+        if (!alive)
+        {
+            // Nothing left to run them, restarting has failed
+            fail(m_queue.front());
+            m_queue.pop_front();
+            continue;
+        }
+        if (!target)
+        {
+            return;
+        }
+        Batch* batch = m_queue.front();
+        m_queue.pop_front();
+        RequestHeader header = {batch->id, (uint32_t) batch->tickets.size(), batch->numGenes};
+        target->out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        target->out.append(reinterpret_cast<const char*>(&batch->genes[0]), batch->genes.size() * sizeof(double));
+        if (target->inflight.empty())
+        {
+            target->progress = monotonicTime();
+        }
+        target->inflight.push_back(batch);
+        m_stats.batches++;
+        if (!send(target))
+        {
+            restart(target, false);
+        }
+    }
+}
+
+void SimulatorProcessor::restart(Simulator* s, bool timedOut)
+{
+    int status = 0;
+    bool killed = timedOut;
+    if (!killed && waitpid(s->pid, &status, WNOHANG) == 0)
+    {
+        // Closed its end but still running
+        kill(s->pid, SIGKILL);
+        killed = true;
+    }
+    if (killed)
+    {
+        waitpid(s->pid, &status, 0);
+    }
+    close(s->fd);
+    bool clean = !killed && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (!clean && !timedOut)
+    {
+        m_stats.crashes++;
+    }
+    // A simulator that exits cleanly is not blamed, e.g. one recycling itself
+    Batch* culprit = NULL;
+    if (!clean && s->inflight.size())
+    {
+        culprit = s->inflight.front();
+        s->inflight.pop_front();
+    }
+    for(unsigned int i = s->inflight.size(); i > 0; i--)
+    {
+        m_queue.push_front(s->inflight[i - 1]);
+    }
+    s->inflight.clear();
+    if (culprit)
+    {
+        blame(culprit);
+    }
+    std::string error;
+    s->pid = -1;
+    s->fd = -1;
+    if (!spawn(s, error))
+    {
+        fprintf(stderr, "Cannot restart simulator: %s\n", error.c_str());
+    }
+    m_stats.restarts++;
+}
+
+void SimulatorProcessor::blame(Batch* batch)
+{
+    if (batch->tickets.size() > 1)
+    {
+        // Find the genome at fault by trying each on its own, keeping their order
+        for(unsigned int i = batch->tickets.size(); i > 0; i--)
+        {
+            Batch* single = new Batch;
+            single->id = m_nextBatch++;
+            single->attempts = 1;
+            single->numGenes = batch->numGenes;
+            single->tickets.push_back(batch->tickets[i - 1]);
+            single->genes.assign(batch->genes.begin() + (i - 1) * batch->numGenes, batch->genes.begin() + i * batch->numGenes);
+            m_queue.push_front(single);
+        }
+        delete batch;
+    }
+    else if (++batch->attempts >= m_maxAttempts)
+    {
+        fail(batch);
+    }
+    else
+    {
+        m_queue.push_front(batch);
+    }
+}
+
+void SimulatorProcessor::fail(Batch* batch)
+{
+    Processor::Score score = {false, HUGE_VAL};
+    for(unsigned int i = 0; i < batch->tickets.size(); i++)
+    {
+        complete(batch->tickets[i], score);
+    }
+    m_stats.failures += batch->tickets.size();
+    delete batch;
+}
@@ -0,0 +1,144 @@
+/*
+ *  SimulatorProcessor.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIMULATOR_PROCESSOR_HPP
+#define SIMULATOR_PROCESSOR_HPP
+
+#include "AsyncProcessor.hpp"
+
+#include <deque>
+#include <pthread.h>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * Scores algorithms with an external plant simulator
+ * Starts a number of long-lived simulator processes, each with one end of
+ * a socket pair as its stdin and stdout. Submitted genomes are gathered
+ * into batches; an I/O thread keeps up to `pipeline` batches in flight on
+ * each simulator, least loaded first, and hands the scores back as they
+ * arrive. A simulator that exits is restarted and its batches sent again.
+ * One that crashes, or takes longer than `timeout` seconds per genome on
+ * its oldest batch and is killed, is blamed for that batch: a batch of
+ * several genomes is retried one genome at a time, a single genome is
+ * retried until maxAttempts and then scored as a failure with an infinite
+ * score. Logged runs are scored without a log, the simulator has no
+ * channel for one.
+ *
+ * Binary protocol, native byte order, messages back in request order:
+ *   > RequestHeader, then count * numGenes doubles
+ *   < ResponseHeader, then count Results
+ * genetics-sim is a stand-in simulator speaking it, see Simulator.cpp
+ **/
+
+class SimulatorProcessor : public virtual AsyncProcessor
+{
+    public:
+        struct RequestHeader
+        {
+            uint32_t id;
+            uint32_t count;
+            uint32_t numGenes;
+        };
+
+        struct ResponseHeader
+        {
+            uint32_t id;
+            uint32_t count;
+        };
+
+        struct Result
+        {
+            double score;
+            uint32_t success;
+            uint32_t reserved;
+        };
+
+        struct Stats
+        {
+            unsigned int processes;
+            unsigned long long batches;
+            unsigned long long restarts;
+            unsigned long long crashes;
+            unsigned long long timeouts;
+            unsigned long long failures;
+        };
+
+        /**
+         * @param command simulator program and its arguments, looked up in PATH
+         * @param batchSize most genomes sent in one request
+         * @param pipeline requests in flight per simulator
+         * @param timeout seconds per genome before a simulator counts as hung
+         */
+        SimulatorProcessor(const std::vector<std::string>& command, unsigned int numProcesses, unsigned int batchSize, unsigned int pipeline, double timeout, unsigned int maxAttempts, unsigned int maxInFlight);
+
+        /**
+         * No evaluation may be in progress; simulators see their input close
+         * and are reaped
+         */
+        ~SimulatorProcessor();
+
+        /**
+         * Starts the simulators and the I/O thread
+         */
+        bool start(std::string& error);
+
+        Stats getStats() const;
+        std::string getSummary() const;
+
+    protected:
+        virtual void submit(Algo* a, const std::string& logname, AsyncProcessor::Ticket* ticket) const;
+        virtual void flush() const;
+
+    private:
+        struct Batch;
+        struct Simulator;
+
+        SimulatorProcessor(const SimulatorProcessor& processor);
+        const SimulatorProcessor& operator=(const SimulatorProcessor& processor);
+        static void* io(void* param);
+        void run();
+        void wake() const;
+        bool spawn(Simulator* s, std::string& error);
+        bool receive(Simulator* s);
+        bool send(Simulator* s);
+        void dispatch();
+        void restart(Simulator* s, bool timedOut);
+        void blame(Batch* batch);
+        void fail(Batch* batch);
+
+        const std::vector<std::string> m_command;
+        const unsigned int m_batchSize;
+        const unsigned int m_pipeline;
+        const double m_timeout;
+        const unsigned int m_maxAttempts;
+        int m_wake[2];
+        bool m_started;
+        bool m_stop;
+        pthread_t m_thread;
+        mutable pthread_mutex_t m_mutex;
+        mutable Batch* m_open;
+        mutable std::deque<Batch*> m_queue;
+        std::vector<Simulator*> m_simulators;
+        mutable unsigned int m_nextBatch;
+        Stats m_stats;
+};
+
+#endif // SIMULATOR_PROCESSOR_HPP
@@ -0,0 +1,162 @@
+/*
+ *  ThreadPool.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <unistd.h>
+
+class ThreadPool::Client
+{
+    public:
+        std::deque<Job> m_queue;
+        double m_stride;
+        double m_pass;
+        unsigned int m_pending;
+};
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+    : m_pass(0.0)
+    , m_stop(false)
+{
+    if (numThreads == 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = cores > 0 ? cores : 1;
+    }
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_work, NULL);
+    pthread_cond_init(&m_done, NULL);
+    m_threads.resize(numThreads);
+    for(unsigned int i = 0; i < numThreads; i++)
+    {
+        pthread_create(&m_threads[i], NULL, worker, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_stop = true;
+    pthread_cond_broadcast(&m_work);
+    pthread_mutex_unlock(&m_mutex);
+    for(unsigned int i = 0; i < m_threads.size(); i++)
+    {
+        pthread_join(m_threads[i], NULL);
+    }
+    for(unsigned int i = 0; i < m_clients.size(); i++)
+    {
+        delete m_clients[i];
+    }
+    pthread_cond_destroy(&m_done);
+    pthread_cond_destroy(&m_work);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+ThreadPool::Client* ThreadPool::addClient(double share)
+{
+    Client* client = new Client;
+    client->m_stride = 1.0 / (share > 0.0 ? share : 1.0);
+    client->m_pending = 0;
+    pthread_mutex_lock(&m_mutex);
+    client->m_pass = m_pass;
+    m_clients.push_back(client);
+    pthread_mutex_unlock(&m_mutex);
+    return client;
+}
+
+void ThreadPool::removeClient(Client* client)
+{
+    wait(client);
+    pthread_mutex_lock(&m_mutex);
+    m_clients.erase(std::find(m_clients.begin(), m_clients.end(), client));
+    pthread_mutex_unlock(&m_mutex);
+    delete client;
+}
+
+void ThreadPool::submit(Client* client, Task task, void* arg)
+{
+    Job job = {task, arg};
+    pthread_mutex_lock(&m_mutex);
+    if (client->m_queue.empty())
+    {
+        // An idle client must not bank credit while it had nothing queued
+        client->m_pass = std::max(client->m_pass, m_pass);
+    }
+    client->m_queue.push_back(job);
+    client->m_pending++;
+    pthread_cond_signal(&m_work);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void ThreadPool::wait(Client* client)
+{
+    pthread_mutex_lock(&m_mutex);
+    while (client->m_pending > 0)
+    {
+        pthread_cond_wait(&m_done, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void* ThreadPool::worker(void* param)
+{
+    static_cast<ThreadPool*>(param)->run();
+    return 0;
+}
+
+void ThreadPool::run()
+{
+    pthread_mutex_lock(&m_mutex);
+    while (true)
+    {
+        Client* next = NULL;
+        for(unsigned int i = 0; i < m_clients.size(); i++)
+        {
+            Client* c = m_clients[i];
+            if (!c->m_queue.empty() && (!next || c->m_pass < next->m_pass))
+            {
+                next = c;
+            }
+        }
+        if (!next)
+        {
+            if (m_stop)
+            {
+                break;
+            }
+            pthread_cond_wait(&m_work, &m_mutex);
+            continue;
+        }
+        Job job = next->m_queue.front();
+        next->m_queue.pop_front();
+        m_pass = next->m_pass;
+        next->m_pass += next->m_stride;
+        pthread_mutex_unlock(&m_mutex);
+
+        job.task(job.arg);
+
+        pthread_mutex_lock(&m_mutex);
+        if (--next->m_pending == 0)
+        {
+            pthread_cond_broadcast(&m_done);
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
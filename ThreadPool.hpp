@@ -0,0 +1,96 @@
+/*
+ *  ThreadPool.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <pthread.h>
+#include <vector>
+
+/**
+ * Fixed set of worker threads shared by many independent clients
+ * Each client (e.g. one God) has its own task queue and a share. Idle
+ * workers use stride scheduling: every client carries a pass value that
+ * advances by 1/share per dispatched task, and the next task comes from
+ * the queued client with the lowest pass. A client registered late starts
+ * at the pool's current pass rather than zero, so it cannot starve others
+ * by catching up. Tasks have the pthread_create signature.
+ **/
+
+class ThreadPool
+{
+    public:
+        typedef void* (*Task)(void*);
+
+        /**
+         * Opaque handle to a client's queue
+         */
+        class Client;
+
+        /**
+         * @param numThreads worker threads, 0 for the number of online processors
+         */
+        ThreadPool(unsigned int numThreads=0);
+
+        /**
+         * Finishes every queued task before joining the workers
+         */
+        ~ThreadPool();
+
+        unsigned int numThreads() const
+        {
+            return m_threads.size();
+        }
+
+        /**
+         * @param share relative number of tasks dispatched while contended
+         */
+        Client* addClient(double share=1.0);
+
+        /**
+         * Waits for the client's tasks, then frees it
+         */
+        void removeClient(Client* client);
+
+        void submit(Client* client, Task task, void* arg);
+
+        /**
+         * Blocks until every task submitted by the client has finished
+         */
+        void wait(Client* client);
+
+    private:
+        struct Job
+        {
+            Task task;
+            void* arg;
+        };
+
+        static void* worker(void* param);
+        void run();
+
+        std::vector<pthread_t> m_threads;
+        std::vector<Client*> m_clients;
+        pthread_mutex_t m_mutex;
+        pthread_cond_t m_work;
+        pthread_cond_t m_done;
+        double m_pass;
+        bool m_stop;
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,205 @@
+/*
+ *  ThreadTuner.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREAD_TUNER_HPP
+#define THREAD_TUNER_HPP
+
+#include <math.h>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+/**
+ * Runtime calibration of the evaluation thread count and chunk size
+ * God reports the cost of every evaluation phase through record() and the
+ * tuner picks the settings for the next generation:
+ * - Thread count is found by probing downwards from the maximum, halving
+ *   until throughput (evaluations per second of wall time) stops improving.
+ *   The probe is repeated whenever the per-evaluation cost drifts far from
+ *   the cost it was calibrated against, e.g. as the population converges
+ * - Chunk size is chosen so that fetching a chunk costs at most
+ *   1/overheadRatio of evaluating it, while still leaving every thread
+ *   chunksPerThread chunks to balance stragglers
+ * fix() turns calibration off, e.g. for benchmarks sweeping thread counts
+ **/
+
+class ThreadTuner
+{
+    public:
+        static const unsigned int overheadRatio = 100;
+        static const unsigned int chunksPerThread = 4;
+
+        /**
+         * @param maxNumThreads upper bound on the thread count, 0 for the
+         * number of online processors
+         * @param initialChunkSize chunk size used until a cost is measured
+         */
+        ThreadTuner(unsigned int maxNumThreads=0, unsigned int initialChunkSize=1)
+            : m_maxNumThreads(maxNumThreads)
+            , m_numThreads(0)
+            , m_chunkSize(initialChunkSize > 0 ? initialChunkSize : 1)
+            , m_calibrating(true)
+            , m_fixed(false)
+            , m_bestNumThreads(0)
+            , m_bestThroughput(0.0)
+            , m_throughput(0.0)
+            , m_cost(0.0)
+            , m_calibratedCost(0.0)
+            , m_overhead(0.0)
+        {
+            // An explicit count is honoured, threads waiting on I/O may outnumber the cores
+            if (m_maxNumThreads == 0)
+            {
+                long cores = sysconf(_SC_NPROCESSORS_ONLN);
+                m_maxNumThreads = cores > 0 ? cores : 1;
+            }
+            m_numThreads = m_maxNumThreads;
+        }
+
+        unsigned int numThreads() const
+        {
+            return m_numThreads;
+        }
+
+        unsigned int maxNumThreads() const
+        {
+            return m_maxNumThreads;
+        }
+
+        unsigned int chunkSize() const
+        {
+            return m_chunkSize;
+        }
+
+        bool calibrating() const
+        {
+            return m_calibrating;
+        }
+
+        /**
+         * Pins the settings, even above the processor count
+         */
+        void fix(unsigned int numThreads, unsigned int chunkSize)
+        {
+            m_numThreads = numThreads > 0 ? numThreads : 1;
+            m_chunkSize = chunkSize > 0 ? chunkSize : 1;
+            if (m_maxNumThreads < m_numThreads)
+            {
+                m_maxNumThreads = m_numThreads;
+            }
+            m_calibrating = false;
+            m_fixed = true;
+        }
+
+        /**
+         * Feed back the measurements of one evaluation phase
+         * @param workload number of evaluations in the phase
+         * @param chunks number of chunks handed out to threads
+         * @param wall wall time of the phase, thread startup included
+         * @param busy summed time threads spent evaluating
+         * @param overhead summed time threads spent fetching chunks
+         */
+        void record(unsigned int workload, unsigned int chunks, double wall, double busy, double overhead)
+        {
+            static const double driftTolerance = 0.3;
+
+            if (workload == 0 || wall <= 0.0)
+            {
+                return;
+            }
+            m_throughput = workload / wall;
+            double cost = busy / workload;
+            m_cost = m_cost > 0.0 ? 0.7 * m_cost + 0.3 * cost : cost;
+            if (chunks > 0)
+            {
+                m_overhead = overhead / chunks;
+            }
+            if (m_fixed)
+            {
+                return;
+            }
+
+            if (m_calibrating)
+            {
+                if (m_throughput > m_bestThroughput)
+                {
+                    m_bestThroughput = m_throughput;
+                    m_bestNumThreads = m_numThreads;
+                }
+                // Keep halving while fewer threads still help, otherwise settle on the best probe
+                if (m_numThreads > 1 && m_bestNumThreads == m_numThreads)
+                {
+                    m_numThreads /= 2;
+                }
+                else
+                {
+                    m_numThreads = m_bestNumThreads;
+                    m_calibratedCost = m_cost;
+                    m_calibrating = false;
+                }
+            }
+            else if (fabs(m_cost - m_calibratedCost) > driftTolerance * m_calibratedCost)
+            {
+                m_calibrating = true;
+                m_bestThroughput = 0.0;
+                m_bestNumThreads = 0;
+                m_numThreads = m_maxNumThreads;
+            }
+
+            double chunk = m_cost > 0.0 ? ceil(m_overhead * overheadRatio / m_cost) : m_chunkSize;
+            double balanced = floor((double) workload / (m_numThreads * chunksPerThread));
+            if (chunk > balanced)
+            {
+                chunk = balanced;
+            }
+            m_chunkSize = chunk < 1.0 ? 1 : (unsigned int) chunk;
+        }
+
+        std::string getSummary() const
+        {
+            std::stringstream ss;
+            ss << "Threads: " << m_numThreads << "/" << m_maxNumThreads << " Chunk: " << m_chunkSize;
+            ss << " Cost: " << m_cost * 1e6 << "us/eval Overhead: " << m_overhead * 1e6 << "us/chunk";
+            ss << " Throughput: " << m_throughput << " evals/s";
+            if (m_calibrating)
+            {
+                ss << " (calibrating)";
+            }
+            else if (m_fixed)
+            {
+                ss << " (fixed)";
+            }
+            ss << std::endl;
+            return ss.str();
+        }
+
+    private:
+        unsigned int m_maxNumThreads;
+        unsigned int m_numThreads;
+        unsigned int m_chunkSize;
+        bool m_calibrating;
+        bool m_fixed;
+        unsigned int m_bestNumThreads;
+        double m_bestThroughput;
+        double m_throughput;
+        double m_cost;
+        double m_calibratedCost;
+        double m_overhead;
+};
+
+#endif // THREAD_TUNER_HPP
@@ -0,0 +1,161 @@
+/*
+ *  Trace.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Trace.hpp"
+
+#include <pthread.h>
+#include <stdio.h>
+
+struct TraceRecord
+{
+    const char* name;
+    double begin;
+    double end;
+    long arg;
+};
+
+struct TraceBuffer
+{
+    TraceBuffer* next;
+    unsigned int lane;
+    int inUse;
+    unsigned long count;
+    TraceRecord* records;
+};
+
+static bool s_enabled = false;
+static unsigned int s_capacity = 0;
+static double s_origin = 0.0;
+static TraceBuffer* s_buffers = NULL;
+static unsigned int s_lanes = 0;
+static unsigned int s_originLane = 0;
+static pthread_key_t s_key;
+static __thread TraceBuffer* t_buffer = NULL;
+
+static void releaseBuffer(void* buffer)
+{
+    __sync_lock_release(&static_cast<TraceBuffer*>(buffer)->inUse);
+}
+
+/**
+ * Claims a buffer released by an exited thread, or pushes a new one
+ */
+static TraceBuffer* claimBuffer()
+{
+    for(TraceBuffer* b = s_buffers; b; b = b->next)
+    {
+        if (__sync_lock_test_and_set(&b->inUse, 1) == 0)
+        {
+            pthread_setspecific(s_key, b);
+            return b;
+        }
+    }
+    TraceBuffer* b = new TraceBuffer;
+    b->lane = __sync_fetch_and_add(&s_lanes, 1);
+    b->inUse = 1;
+    b->count = 0;
+    b->records = new TraceRecord[s_capacity];
+    do
+    {
+        b->next = s_buffers;
+    } while (!__sync_bool_compare_and_swap(&s_buffers, b->next, b));
+    pthread_setspecific(s_key, b);
+    return b;
+}
+
+void traceEnable(unsigned int capacity)
+{
+    if (s_enabled || capacity == 0)
+    {
+        return;
+    }
+    pthread_key_create(&s_key, releaseBuffer);
+    s_capacity = capacity;
+    s_origin = monotonicTime();
+    s_enabled = true;
+    t_buffer = claimBuffer();
+    s_originLane = t_buffer->lane;
+}
+
+bool traceEnabled()
+{
+    return s_enabled;
+}
+
+void traceEvent(const char* name, double begin, double end, long arg)
+{
+    if (!s_enabled)
+    {
+        return;
+    }
+    TraceBuffer* b = t_buffer;
+    if (!b)
+    {
+        b = t_buffer = claimBuffer();
+    }
+    TraceRecord& r = b->records[b->count % s_capacity];
+    r.name = name;
+    r.begin = begin;
+    r.end = end;
+    r.arg = arg;
+    b->count++;
+}
+
+bool traceWrite(const std::string& filename)
+{
+    if (!s_enabled)
+    {
+        return false;
+    }
+    FILE* f = fopen(filename.c_str(), "w");
+    if (!f)
+    {
+        return false;
+    }
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"genetics\"}}");
+    for(TraceBuffer* b = s_buffers; b; b = b->next)
+    {
+        if (b->lane == s_originLane)
+        {
+            fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"god\"}}", b->lane);
+        }
+        else
+        {
+            fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"worker %u\"}}", b->lane, b->lane);
+        }
+        unsigned long first = b->count > s_capacity ? b->count - s_capacity : 0;
+        for(unsigned long i = first; i < b->count; i++)
+        {
+            const TraceRecord& r = b->records[i % s_capacity];
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"genetics\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", r.name, b->lane, (r.begin - s_origin) * 1e6, (r.end - r.begin) * 1e6);
+            if (r.arg >= 0)
+            {
+                fprintf(f, ",\"args\":{\"n\":%ld}", r.arg);
+            }
+            fprintf(f, "}");
+        }
+        if (first > 0)
+        {
+            fprintf(f, ",\n{\"name\":\"dropped %lu events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":0}", first, b->lane);
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,73 @@
+/*
+ *  Trace.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "Timer.hpp"
+
+#include <string>
+
+/**
+ * Timeline of worker activity in Chrome trace-event format
+ * Open the written file in chrome://tracing or https://ui.perfetto.dev
+ *
+ * Every thread appends to its own ring buffer so recording never takes a
+ * lock; a buffer is claimed the first time a thread records and released
+ * when it exits, so the threads God starts each generation reuse the same
+ * lanes instead of growing the trace. Rings keep the most recent events.
+ * Names must be string literals, they are stored by pointer.
+ * Call traceWrite() only once no thread is recording
+ **/
+
+/**
+ * @param capacity events kept per thread
+ */
+void traceEnable(unsigned int capacity=1<<16);
+bool traceEnabled();
+void traceEvent(const char* name, double begin, double end, long arg=-1);
+bool traceWrite(const std::string& filename);
+
+/**
+ * Records an event spanning its own lifetime
+ */
+class TraceScope
+{
+    public:
+        TraceScope(const char* name, long arg=-1)
+            : m_name(name)
+            , m_arg(arg)
+            , m_begin(traceEnabled() ? monotonicTime() : 0.0)
+        {
+        }
+
+        ~TraceScope()
+        {
+            if (m_begin > 0.0)
+            {
+                traceEvent(m_name, m_begin, monotonicTime(), m_arg);
+            }
+        }
+
+    private:
+        const char* m_name;
+        long m_arg;
+        double m_begin;
+};
+
+#endif // TRACE_HPP
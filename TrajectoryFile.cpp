@@ -0,0 +1,185 @@
+/*
+ *  TrajectoryFile.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TrajectoryFile.hpp"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char s_magic[8] = {'g', 'e', 'n', 't', 'r', 'a', 'j', '1'};
+static const unsigned int s_version = 1;
+
+struct TrajectoryFile::Header
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int numProfiles;
+    double period;
+};
+
+struct TrajectoryFile::Entry
+{
+    unsigned long long setpoints;
+    unsigned long long disturbances;
+    unsigned long long length;
+};
+
+/**
+ * @return true if length doubles at offset are aligned and within size
+ */
+static bool fits(unsigned long long offset, unsigned long long length, unsigned long long start, unsigned long long size)
+{
+    return offset % sizeof(double) == 0 && offset >= start && offset <= size && length <= (size - offset) / sizeof(double);
+}
+
+TrajectoryFile::TrajectoryFile()
+    : m_map(NULL)
+    , m_mapSize(0)
+    , m_period(0.0)
+{
+}
+
+TrajectoryFile::~TrajectoryFile()
+{
+    close();
+}
+
+bool TrajectoryFile::open(const std::string& filename, std::string& error)
+{
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + filename;
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && (unsigned long long) st.st_size >= sizeof(Header);
+    if (ok)
+    {
+        m_mapSize = st.st_size;
+        m_map = mmap(NULL, m_mapSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (m_map == MAP_FAILED)
+        {
+            m_map = NULL;
+            ok = false;
+        }
+    }
+    ::close(fd);
+    if (!ok)
+    {
+        error = filename + " is not a trajectory file";
+        return false;
+    }
+
+    const Header* header = static_cast<const Header*>(m_map);
+    const Entry* entries = reinterpret_cast<const Entry*>(header + 1);
+    unsigned long long dataStart = sizeof(Header) + (unsigned long long) header->numProfiles * sizeof(Entry);
+    ok = !memcmp(header->magic, s_magic, sizeof(s_magic)) && header->version == s_version && header->numProfiles > 0 && header->period > 0 && isfinite(header->period) && dataStart <= m_mapSize;
+    for(unsigned int i = 0; ok && i < header->numProfiles; i++)
+    {
+        const Entry& entry = entries[i];
+        ok = entry.length > 0 && fits(entry.setpoints, entry.length, dataStart, m_mapSize) && (entry.disturbances == 0 || fits(entry.disturbances, entry.length, dataStart, m_mapSize));
+        if (ok)
+        {
+            const char* base = static_cast<const char*>(m_map);
+            Profile profile = {reinterpret_cast<const double*>(base + entry.setpoints), entry.disturbances ? reinterpret_cast<const double*>(base + entry.disturbances) : NULL, entry.length};
+            m_profiles.push_back(profile);
+        }
+    }
+    if (!ok)
+    {
+        close();
+        error = filename + " is not a valid trajectory file";
+        return false;
+    }
+    m_period = header->period;
+    // Every evaluation reads every profile, so fault it all in up front
+    madvise(m_map, m_mapSize, MADV_WILLNEED);
+    return true;
+}
+
+void TrajectoryFile::close()
+{
+    if (m_map)
+    {
+        munmap(m_map, m_mapSize);
+        m_map = NULL;
+    }
+    m_mapSize = 0;
+    m_period = 0.0;
+    m_profiles.clear();
+}
+
+bool TrajectoryFile::write(const std::string& filename, double period, const std::vector<std::vector<double> >& setpoints, const std::vector<std::vector<double> >& disturbances, std::string& error)
+{
+    if (setpoints.empty() || !(period > 0))
+    {
+        error = "a trajectory file needs a profile and a positive period";
+        return false;
+    }
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = s_version;
+    header.numProfiles = setpoints.size();
+    header.period = period;
+    std::vector<Entry> entries(setpoints.size());
+    unsigned long long offset = sizeof(Header) + entries.size() * sizeof(Entry);
+    for(unsigned int i = 0; i < setpoints.size(); i++)
+    {
+        bool disturbed = i < disturbances.size() && disturbances[i].size();
+        if (setpoints[i].empty() || (disturbed && disturbances[i].size() != setpoints[i].size()))
+        {
+            error = "every profile needs setpoints, and as many disturbances if any";
+            return false;
+        }
+        entries[i].length = setpoints[i].size();
+        entries[i].setpoints = offset;
+        offset += entries[i].length * sizeof(double);
+        entries[i].disturbances = disturbed ? offset : 0;
+        offset += disturbed ? entries[i].length * sizeof(double) : 0;
+    }
+
+    FILE* f = fopen(filename.c_str(), "wb");
+    if (!f)
+    {
+        error = "cannot create " + filename;
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(&entries[0], sizeof(Entry), entries.size(), f) == entries.size();
+    for(unsigned int i = 0; ok && i < setpoints.size(); i++)
+    {
+        ok = fwrite(&setpoints[i][0], sizeof(double), setpoints[i].size(), f) == setpoints[i].size();
+        if (ok && entries[i].disturbances)
+        {
+            ok = fwrite(&disturbances[i][0], sizeof(double), disturbances[i].size(), f) == disturbances[i].size();
+        }
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok)
+    {
+        error = "cannot write " + filename;
+    }
+    return ok;
+}
@@ -0,0 +1,102 @@
+/*
+ *  TrajectoryFile.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRAJECTORY_FILE_HPP
+#define TRAJECTORY_FILE_HPP
+
+#include <string>
+#include <vector>
+
+/**
+ * Recorded setpoint profiles, memory-mapped read-only from a file
+ * The mapping is shared by every thread, and by every process that maps
+ * the same file through the page cache, so a profile is read in place:
+ * nothing is parsed or copied per evaluation.
+ *
+ * The file is native-endian:
+ *     header  magic "gentraj1", version, profile count, seconds per step
+ *     index   per profile: byte offset of its setpoints, byte offset of
+ *             its disturbances (0 for none), length in steps
+ *     data    the arrays of doubles, each 8-byte aligned
+ * Setpoints are positions (m). Disturbances are load torques at the motor
+ * (N m), as PID1DProcessor::track() takes them. write() produces the
+ * format and genetics-profiles converts CSV files to it.
+ **/
+
+class TrajectoryFile
+{
+    public:
+        struct Profile
+        {
+            const double* setpoints;
+            const double* disturbances; // NULL for none
+            unsigned long long length;
+        };
+
+        TrajectoryFile();
+        ~TrajectoryFile();
+
+        /**
+         * Maps the file and checks every profile lies within it
+         */
+        bool open(const std::string& filename, std::string& error);
+        void close();
+
+        bool isOpen() const
+        {
+            return m_map != NULL;
+        }
+
+        unsigned int numProfiles() const
+        {
+            return m_profiles.size();
+        }
+
+        const Profile& profile(unsigned int i) const
+        {
+            return m_profiles[i];
+        }
+
+        /**
+         * Seconds per step of every profile
+         */
+        double period() const
+        {
+            return m_period;
+        }
+
+        /**
+         * @param disturbances one per profile or none at all, an empty one
+         * for a profile without
+         */
+        static bool write(const std::string& filename, double period, const std::vector<std::vector<double> >& setpoints, const std::vector<std::vector<double> >& disturbances, std::string& error);
+
+    private:
+        struct Header;
+        struct Entry;
+
+        TrajectoryFile(const TrajectoryFile& file);
+        const TrajectoryFile& operator=(const TrajectoryFile& file);
+
+        void* m_map;
+        unsigned long long m_mapSize;
+        double m_period;
+        std::vector<Profile> m_profiles;
+};
+
+#endif // TRAJECTORY_FILE_HPP
@@ -0,0 +1,53 @@
+/*
+ *  TrajectoryProcessor.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TrajectoryProcessor.hpp"
+
+#include "PID1DProcessor.hpp"
+#include "TrajectoryFile.hpp"
+
+TrajectoryProcessor::TrajectoryProcessor(const PID1DProcessor& plant, const TrajectoryFile& trajectories)
+    : m_plant(plant)
+    , m_trajectories(trajectories)
+{
+}
+
+Processor::Score TrajectoryProcessor::process(Algo* a, std::string logname) const
+{
+    Processor::Score score = {true, 0.0};
+    for(unsigned int i = 0; i < m_trajectories.numProfiles(); i++)
+    {
+        const TrajectoryFile::Profile& profile = m_trajectories.profile(i);
+        Processor::Score sample = m_plant.track(a, profile.setpoints, profile.disturbances, profile.length, m_trajectories.period(), i == 0 ? logname : "");
+        score.success = score.success && sample.success;
+        score.score += sample.score;
+    }
+    score.score /= m_trajectories.numProfiles();
+    return score;
+}
+
+unsigned int TrajectoryProcessor::numSamples() const
+{
+    return m_trajectories.numProfiles();
+}
+
+Processor::Score TrajectoryProcessor::processSample(Algo* a, unsigned int sample) const
+{
+    const TrajectoryFile::Profile& profile = m_trajectories.profile(sample);
+    return m_plant.track(a, profile.setpoints, profile.disturbances, profile.length, m_trajectories.period());
+}
@@ -0,0 +1,52 @@
+/*
+ *  TrajectoryProcessor.hpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRAJECTORY_PROCESSOR_HPP
+#define TRAJECTORY_PROCESSOR_HPP
+
+#include "Processor.hpp"
+
+class PID1DProcessor;
+class TrajectoryFile;
+
+/**
+ * Scores tracking of recorded setpoint profiles instead of a step
+ * Every profile of a TrajectoryFile is run through PID1DProcessor::track()
+ * straight from the shared mapping. The score is the mean over profiles of
+ * the integrated tracking error and fails if any profile ends unsettled.
+ * Each profile is a sample, so God can race algorithms over the profiles.
+ * Neither the plant nor the file is owned; both must outlive this.
+ */
+class TrajectoryProcessor : public virtual Processor
+{
+    public:
+        TrajectoryProcessor(const PID1DProcessor& plant, const TrajectoryFile& trajectories);
+
+        /**
+         * Logs the first profile only
+         */
+        virtual Processor::Score process(Algo* a, std::string logname="") const;
+        virtual unsigned int numSamples() const;
+        virtual Processor::Score processSample(Algo* a, unsigned int sample) const;
+
+    private:
+        const PID1DProcessor& m_plant;
+        const TrajectoryFile& m_trajectories;
+};
+
+#endif // TRAJECTORY_PROCESSOR_HPP
@@ -0,0 +1,318 @@
+/*
+ *  Worker.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Algo.hpp"
+#include "Config.hpp"
+#include "PID1DProcessor.hpp"
+#include "Protocol.hpp"
+#include "Timer.hpp"
+
+#include <deque>
+#include <map>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Evaluation worker of a Farm, see Farm.hpp for the protocol
+ * Connects to the master, retrying for a while so workers can be started
+ * first, and scores its batches on --threads threads while the main thread
+ * keeps reading, so pings are answered even during a long batch. Exits
+ * when the master closes the connection.
+ *
+ * Usage: genetics-worker --master host:port [--threads N]
+ **/
+
+struct WorkerConfig
+{
+    PID1DProcessor* processor;
+    Algo* prototype;
+};
+
+struct WorkerBatch
+{
+    std::string id;
+    WorkerConfig config;
+    unsigned int count;
+    std::vector<double> genes;
+};
+
+struct WorkerState
+{
+    int fd;
+    pthread_mutex_t mutex;
+    pthread_mutex_t writeMutex;
+    pthread_cond_t work;
+    std::deque<WorkerBatch*> queue;
+    bool stop;
+};
+
+static int connectTo(const std::string& address)
+{
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos)
+    {
+        fprintf(stderr, "Expected host:port, got %s\n", address.c_str());
+        return -1;
+    }
+    struct addrinfo hints, *info = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(address.substr(0, colon).c_str(), address.substr(colon + 1).c_str(), &hints, &info) != 0)
+    {
+        fprintf(stderr, "Cannot resolve %s\n", address.c_str());
+        return -1;
+    }
+    double deadline = monotonicTime() + 10.0;
+    int fd = -1;
+    while (true)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, info->ai_addr, info->ai_addrlen) == 0)
+        {
+            break;
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+        if (monotonicTime() > deadline)
+        {
+            perror(address.c_str());
+            break;
+        }
+        usleep(100000);
+    }
+    freeaddrinfo(info);
+    if (fd >= 0)
+    {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+static bool send(WorkerState* state, const std::string& line)
+{
+    pthread_mutex_lock(&state->writeMutex);
+    bool ok = writeLine(state->fd, line);
+    pthread_mutex_unlock(&state->writeMutex);
+    return ok;
+}
+
+static void* evaluate(void* param)
+{
+    WorkerState* state = static_cast<WorkerState*>(param);
+    while (true)
+    {
+        pthread_mutex_lock(&state->mutex);
+        while (state->queue.empty() && !state->stop)
+        {
+            pthread_cond_wait(&state->work, &state->mutex);
+        }
+        if (state->queue.empty())
+        {
+            pthread_mutex_unlock(&state->mutex);
+            return 0;
+        }
+        WorkerBatch* batch = state->queue.front();
+        state->queue.pop_front();
+        pthread_mutex_unlock(&state->mutex);
+
+        unsigned int numGenes = batch->count ? batch->genes.size() / batch->count : 0;
+        char buf[64];
+        snprintf(buf, sizeof(buf), " %u", batch->count);
+        std::string line = "SCORES " + batch->id + buf;
+        for(unsigned int i = 0; i < batch->count; i++)
+        {
+            std::vector<double> genes(batch->genes.begin() + i * numGenes, batch->genes.begin() + (i + 1) * numGenes);
+            Algo* algo = batch->config.prototype->clone(genes);
+            Processor::Score score = batch->config.processor->process(algo);
+            delete algo;
+            snprintf(buf, sizeof(buf), " %d %.17g", score.success, score.score);
+            line += buf;
+        }
+        delete batch;
+        send(state, line);
+    }
+}
+
+/**
+ * @return NULL if the line is not a well-formed batch for its config's genes
+ */
+static WorkerBatch* parseBatch(const std::string& line, const std::map<unsigned int, WorkerConfig>& configs)
+{
+    const char* s = line.c_str() + 6;
+    char* end;
+    WorkerBatch* batch = new WorkerBatch;
+    strtoull(s, &end, 10);
+    batch->id = std::string(s, end - s);
+    unsigned int config = strtoul(end, &end, 10);
+    batch->count = strtoul(end, &end, 10);
+    unsigned int numGenes = strtoul(end, &end, 10);
+    std::map<unsigned int, WorkerConfig>::const_iterator it = configs.find(config);
+    if (it == configs.end())
+    {
+        delete batch;
+        return NULL;
+    }
+    // Every gene takes at least two characters of the line
+    if (numGenes != it->second.prototype->getGenes().size() || (unsigned long long) batch->count * numGenes > line.size() / 2)
+    {
+        delete batch;
+        return NULL;
+    }
+    batch->config = it->second;
+    batch->genes.resize(batch->count * numGenes);
+    for(unsigned int i = 0; i < batch->genes.size(); i++)
+    {
+        char* geneEnd;
+        batch->genes[i] = strtod(end, &geneEnd);
+        if (geneEnd == end)
+        {
+            delete batch;
+            return NULL;
+        }
+        end = geneEnd;
+    }
+    return batch;
+}
+
+int main(int argc, char** argv)
+{
+    std::string master;
+    unsigned int numThreads = 1;
+    for(int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--master") && i + 1 < argc)
+        {
+            master = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+        {
+            numThreads = atoi(argv[++i]);
+        }
+        else
+        {
+            master = "";
+            break;
+        }
+    }
+    if (master.empty() || numThreads == 0)
+    {
+        fprintf(stderr, "Usage: %s --master host:port [--threads N]\n", argv[0]);
+        return 1;
+    }
+
+    WorkerState state;
+    state.fd = connectTo(master);
+    if (state.fd < 0)
+    {
+        return 1;
+    }
+    state.stop = false;
+    pthread_mutex_init(&state.mutex, NULL);
+    pthread_mutex_init(&state.writeMutex, NULL);
+    pthread_cond_init(&state.work, NULL);
+    std::vector<pthread_t> threads(numThreads);
+    for(unsigned int i = 0; i < numThreads; i++)
+    {
+        pthread_create(&threads[i], NULL, evaluate, &state);
+    }
+    char hello[32];
+    snprintf(hello, sizeof(hello), "HELLO %u", numThreads);
+    send(&state, hello);
+
+    std::map<unsigned int, WorkerConfig> configs;
+    LineReader reader(state.fd);
+    std::string line;
+    int status = 0;
+    while (reader.readLine(line))
+    {
+        if (line == "PING")
+        {
+            send(&state, "PONG");
+        }
+        else if (line.compare(0, 7, "CONFIG ") == 0)
+        {
+            unsigned int id = strtoul(line.c_str() + 7, NULL, 10);
+            std::string text;
+            while (reader.readLine(line) && line != "END")
+            {
+                text += line + "\n";
+            }
+            RunConfig config;
+            std::string error;
+            if (!loadConfigString(config, text, error) || !validateConfig(config, error))
+            {
+                fprintf(stderr, "Bad configuration %u: %s\n", id, error.c_str());
+                status = 1;
+                break;
+            }
+            WorkerConfig wc = {createProcessor(config), createSeeds(config)[0]};
+            configs[id] = wc;
+        }
+        else if (line.compare(0, 6, "BATCH ") == 0)
+        {
+            WorkerBatch* batch = parseBatch(line, configs);
+            if (!batch)
+            {
+                fprintf(stderr, "Bad batch: %.60s\n", line.c_str());
+                status = 1;
+                break;
+            }
+            pthread_mutex_lock(&state.mutex);
+            state.queue.push_back(batch);
+            pthread_cond_signal(&state.work);
+            pthread_mutex_unlock(&state.mutex);
+        }
+    }
+
+    // The master is gone, nobody is waiting for the rest
+    pthread_mutex_lock(&state.mutex);
+    for(unsigned int i = 0; i < state.queue.size(); i++)
+    {
+        delete state.queue[i];
+    }
+    state.queue.clear();
+    state.stop = true;
+    pthread_cond_broadcast(&state.work);
+    pthread_mutex_unlock(&state.mutex);
+    shutdown(state.fd, SHUT_RDWR);
+    for(unsigned int i = 0; i < numThreads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    close(state.fd);
+    for(std::map<unsigned int, WorkerConfig>::iterator it = configs.begin(); it != configs.end(); ++it)
+    {
+        delete it->second.processor;
+        delete it->second.prototype;
+    }
+    return status;
+}
@@ -0,0 +1,117 @@
+/*
+ *  Async.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Config.hpp"
+#include "../God.hpp"
+#include "../LatencyProcessor.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../rand.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Throughput of a slow-answering plant, blocking versus asynchronous
+ * Runs the same seeded GA on two threads against a plant that takes
+ * plantLatency to answer, once sleeping in process() and once through a
+ * LatencyProcessor with asyncInFlight evaluations outstanding. Both runs
+ * must end with identical successors.
+ *
+ * Usage: async [latency in ms] [in flight]
+ * Exits with 0 if the runs agree
+ **/
+
+static const unsigned long seed = 5;
+static const unsigned int numThreads = 2;
+
+/**
+ * The plant answering after a delay, holding the thread meanwhile
+ */
+class SleepProcessor : public virtual Processor
+{
+    public:
+        SleepProcessor(const Processor& processor, double latency)
+            : m_processor(processor)
+            , m_latency(latency)
+        {
+        }
+
+        virtual Processor::Score process(Algo* a, std::string logname="") const
+        {
+            usleep((useconds_t) (m_latency * 1e6));
+            return m_processor.process(a, logname);
+        }
+
+    private:
+        const Processor& m_processor;
+        double m_latency;
+};
+
+static std::vector<SavedAlgo> run(const RunConfig& config, const Processor& processor, double& seconds)
+{
+    seed_rng(seed);
+    God god(processor, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, numThreads, config.numCycles);
+    god.getTuner().fix(numThreads, config.populationSize / (numThreads * ThreadTuner::chunksPerThread));
+    god.setLogPrefix("", false);
+    double start = monotonicTime();
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    seconds = monotonicTime() - start;
+    delete best.algo;
+    return god.getSuccessors();
+}
+
+int main(int argc, char** argv)
+{
+    RunConfig config;
+    config.populationSize = 400;
+    config.numCycles = 4;
+    config.plantLatency = (argc > 1 ? atof(argv[1]) : 2.0) * 1e-3;
+    config.asyncInFlight = argc > 2 ? atoi(argv[2]) : 64;
+
+    init_rng();
+    PID1DProcessor* plant = createProcessor(config);
+    double blockingSeconds, asyncSeconds;
+    SleepProcessor blocking(*plant, config.plantLatency);
+    std::vector<SavedAlgo> expected = run(config, blocking, blockingSeconds);
+    LatencyProcessor* async = new LatencyProcessor(*plant, config.plantLatency, config.asyncInFlight);
+    std::vector<SavedAlgo> actual = run(config, *async, asyncSeconds);
+    unsigned int peak = async->peakInFlight();
+    delete async;
+    delete plant;
+    free_rng();
+
+    double evaluations = config.populationSize * (double) config.numCycles;
+    printf("Latency: %.1fms Threads: %u\n", config.plantLatency * 1e3, numThreads);
+    printf("Blocking: %.3fs %.0f evals/s\n", blockingSeconds, evaluations / blockingSeconds);
+    printf("Async: %.3fs %.0f evals/s, %u of %u in flight at most\n", asyncSeconds, evaluations / asyncSeconds, peak, config.asyncInFlight);
+
+    bool same = expected.size() == actual.size();
+    for(unsigned int i = 0; same && i < expected.size(); i++)
+    {
+        same = expected[i].score.success == actual[i].score.success && expected[i].score.score == actual[i].score.score && expected[i].genes == actual[i].genes;
+    }
+    if (!same)
+    {
+        printf("FAIL: asynchronous successors differ from blocking evaluation\n");
+        return 1;
+    }
+    printf("OK: identical successors\n");
+    return 0;
+}
@@ -0,0 +1,354 @@
+/*
+ *  Convergence.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../God.hpp"
+#include "../PDParam.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../PIDAlgo.hpp"
+#include "../rand.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * Time-to-solution benchmark of the optimizer
+ * Every GA setting is run with several seeds on a fixed set of plants
+ * (variations of the main.cpp constants). Processor::process calls and wall
+ * time are recorded per generation, giving a convergence curve per run.
+ *
+ * Score targets are relative to the best score any run found on the plant,
+ * so they stay meaningful across plants: a run reaches target f once its
+ * best is within a factor f of that score, and successful if that one was.
+ *
+ * Usage: convergence [--seeds N] [--generations N] [--scale F] [--out prefix]
+ * --scale multiplies every population size, for quick runs.
+ * Writes <prefix>.csv with every curve point and <prefix>.json with the
+ * evaluations and wall time to each target, summarised over seeds
+ **/
+
+struct PlantConfig
+{
+    const char* name;
+    double mass;
+    double motorStallTorque;
+    double staticFriction;
+    double kineticFriction;
+    double goal;
+};
+
+struct GASetting
+{
+    const char* name;
+    unsigned int populationSize;
+    unsigned int successorSize;
+    double k;
+};
+
+/**
+ * Counts calls into the wrapped processor
+ */
+class CountingProcessor : public virtual Processor
+{
+    public:
+        CountingProcessor(const Processor& processor)
+            : m_processor(processor)
+            , m_count(0)
+        {
+        }
+
+        virtual Processor::Score process(Algo* a, std::string logname="") const
+        {
+            __sync_fetch_and_add(&m_count, 1);
+            return m_processor.process(a, logname);
+        }
+
+        unsigned long long count() const
+        {
+            return m_count;
+        }
+
+    private:
+        const Processor& m_processor;
+        mutable unsigned long long m_count;
+};
+
+struct CurvePoint
+{
+    unsigned int generation;
+    unsigned long long evaluations;
+    double wallTime;
+    bool bestSuccess;
+    double bestScore;
+};
+
+class CurveSink : public virtual MetricsSink
+{
+    public:
+        CurveSink(const CountingProcessor& processor)
+            : m_processor(processor)
+            , m_wallTime(0.0)
+        {
+        }
+
+        virtual void record(const GenerationStats& stats)
+        {
+            m_wallTime += stats.totalTime();
+            CurvePoint p = {stats.generation, m_processor.count(), m_wallTime, stats.bestSuccess, stats.bestScore};
+            curve.push_back(p);
+        }
+
+        std::vector<CurvePoint> curve;
+
+    private:
+        const CountingProcessor& m_processor;
+        double m_wallTime;
+};
+
+struct Run
+{
+    unsigned int plant;
+    unsigned int setting;
+    unsigned long seed;
+    std::vector<CurvePoint> curve;
+};
+
+static double median(std::vector<double> v)
+{
+    if (v.empty())
+    {
+        return 0.0;
+    }
+    std::sort(v.begin(), v.end());
+    unsigned int n = v.size();
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+static bool better(bool lSuccess, double lScore, bool rSuccess, double rScore)
+{
+    if (lSuccess != rSuccess)
+    {
+        return lSuccess;
+    }
+    return lScore < rScore;
+}
+
+int main(int argc, char** argv)
+{
+    static const double timeout                     =   5.00;
+    static const double timein                      =   1.00;
+    static const double threshold                   =   0.01;
+    static const double maxVoltage                  =  12.00;
+    static const double minVoltage                  = -12.00;
+    static const double motorFreeSpeed              = 010.00;
+    static const double gearingRatio                =   1.00;
+    static const double wheelDiameter               =   0.03;
+
+    static const PlantConfig plants[] = {
+        {"nominal",      1.0, 10.0, 0.50, 0.10, 1.0},
+        {"heavy",        3.0, 10.0, 0.50, 0.10, 1.0},
+        {"sticky",       1.0, 10.0, 1.50, 0.40, 1.0},
+        {"weak-motor",   1.0,  4.0, 0.50, 0.10, 1.0},
+        {"short-move",   1.0, 10.0, 0.50, 0.10, 0.2}
+    };
+    static const GASetting settings[] = {
+        {"default",      4000, 10, 1.00},
+        {"small-pop",    1000, 10, 1.00},
+        {"wide-select",  4000, 50, 1.00},
+        {"low-mutation", 4000, 10, 0.25}
+    };
+    static const double targets[] = {1.10, 1.01, 1.001};
+    unsigned int numPlants = sizeof(plants) / sizeof(plants[0]);
+    unsigned int numSettings = sizeof(settings) / sizeof(settings[0]);
+    unsigned int numTargets = sizeof(targets) / sizeof(targets[0]);
+
+    unsigned int numSeeds = 3;
+    unsigned int numCycles = 10;
+    double scale = 1.0;
+    std::string out = "convergence";
+    for(int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--seeds") && i + 1 < argc)
+        {
+            numSeeds = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--generations") && i + 1 < argc)
+        {
+            numCycles = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--scale") && i + 1 < argc)
+        {
+            scale = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+        {
+            out = argv[++i];
+        }
+        else
+        {
+            numSeeds = 0;
+            break;
+        }
+    }
+    if (numSeeds == 0 || numCycles == 0 || scale <= 0.0)
+    {
+        fprintf(stderr, "Usage: %s [--seeds N] [--generations N] [--scale F] [--out prefix]\n", argv[0]);
+        return 1;
+    }
+
+    init_rng();
+    std::vector<Run> runs;
+    for(unsigned int p = 0; p < numPlants; p++)
+    {
+        const PlantConfig& plant = plants[p];
+        PID1DProcessor processor(timeout, timein, threshold, maxVoltage, minVoltage, plant.goal, plant.mass, plant.motorStallTorque, motorFreeSpeed, gearingRatio, wheelDiameter, plant.staticFriction, plant.kineticFriction);
+        for(unsigned int s = 0; s < numSettings; s++)
+        {
+            const GASetting& setting = settings[s];
+            unsigned int populationSize = std::max(1u, (unsigned int) (setting.populationSize * scale));
+            unsigned int successorSize = std::min(setting.successorSize, populationSize);
+            for(unsigned int seed = 1; seed <= numSeeds; seed++)
+            {
+                seed_rng(seed);
+                CountingProcessor counter(processor);
+                CurveSink sink(counter);
+                std::vector<Algo*> seeds(1);
+                seeds[0] = new PIDAlgo(new PDParam(0, setting.k), new PDParam(0, 0), new PDParam(0, setting.k/100.0), maxVoltage, minVoltage);
+                God god(counter, seeds, populationSize, successorSize, 1, 0, numCycles);
+                god.setLogPrefix("", false);
+                god.addSink(&sink);
+                AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+                delete best.algo;
+
+                Run run = {p, s, seed, sink.curve};
+                runs.push_back(run);
+                fprintf(stderr, "%s %s seed %u: %s%f\n", plant.name, setting.name, seed, best.score.success ? "" : "(failed) ", best.score.score);
+            }
+        }
+    }
+    free_rng();
+
+    std::string csvName = out + ".csv";
+    FILE* csv = fopen(csvName.c_str(), "w");
+    if (!csv)
+    {
+        perror(csvName.c_str());
+        return 1;
+    }
+    fprintf(csv, "plant,setting,seed,generation,evaluations,wallTime,bestSuccess,bestScore\n");
+    for(unsigned int r = 0; r < runs.size(); r++)
+    {
+        const Run& run = runs[r];
+        for(unsigned int i = 0; i < run.curve.size(); i++)
+        {
+            const CurvePoint& c = run.curve[i];
+            fprintf(csv, "%s,%s,%lu,%u,%llu,%.9f,%d,%.17g\n", plants[run.plant].name, settings[run.setting].name, run.seed, c.generation, c.evaluations, c.wallTime, c.bestSuccess, c.bestScore);
+        }
+    }
+    fclose(csv);
+
+    std::string jsonName = out + ".json";
+    FILE* json = fopen(jsonName.c_str(), "w");
+    if (!json)
+    {
+        perror(jsonName.c_str());
+        return 1;
+    }
+    fprintf(json, "{\"seeds\":%u,\"generations\":%u,\"scale\":%g,\"results\":[\n", numSeeds, numCycles, scale);
+    printf("%-11s %-13s %7s %9s %9s %16s %12s\n", "plant", "setting", "target", "reached", "score", "median evals", "median s");
+    bool first = true;
+    for(unsigned int p = 0; p < numPlants; p++)
+    {
+        // Reference is the best any run found on this plant
+        bool refSuccess = false;
+        double refScore = 0.0;
+        bool haveRef = false;
+        for(unsigned int r = 0; r < runs.size(); r++)
+        {
+            if (runs[r].plant != p || runs[r].curve.empty())
+            {
+                continue;
+            }
+            const CurvePoint& c = runs[r].curve.back();
+            if (!haveRef || better(c.bestSuccess, c.bestScore, refSuccess, refScore))
+            {
+                refSuccess = c.bestSuccess;
+                refScore = c.bestScore;
+                haveRef = true;
+            }
+        }
+
+        for(unsigned int s = 0; s < numSettings; s++)
+        {
+            std::vector<double> finals;
+            for(unsigned int r = 0; r < runs.size(); r++)
+            {
+                if (runs[r].plant == p && runs[r].setting == s && !runs[r].curve.empty())
+                {
+                    finals.push_back(runs[r].curve.back().bestScore);
+                }
+            }
+            for(unsigned int t = 0; t < numTargets; t++)
+            {
+                double target = refScore * targets[t];
+                std::vector<double> evaluations, wallTimes;
+                for(unsigned int r = 0; r < runs.size(); r++)
+                {
+                    const Run& run = runs[r];
+                    if (run.plant != p || run.setting != s)
+                    {
+                        continue;
+                    }
+                    for(unsigned int i = 0; i < run.curve.size(); i++)
+                    {
+                        const CurvePoint& c = run.curve[i];
+                        if ((c.bestSuccess || !refSuccess) && c.bestScore <= target)
+                        {
+                            evaluations.push_back(c.evaluations);
+                            wallTimes.push_back(c.wallTime);
+                            break;
+                        }
+                    }
+                }
+                printf("%-11s %-13s %7.3f %5u/%-3u %9.5f", plants[p].name, settings[s].name, targets[t], (unsigned int) evaluations.size(), numSeeds, target);
+                fprintf(json, "%s{\"plant\":\"%s\",\"setting\":\"%s\",\"populationSize\":%u,\"successorSize\":%u,\"k\":%g,", first ? "" : ",\n", plants[p].name, settings[s].name, (unsigned int) (settings[s].populationSize * scale), settings[s].successorSize, settings[s].k);
+                fprintf(json, "\"target\":%g,\"targetScore\":%.17g,\"reached\":%u,\"runs\":%u,", targets[t], target, (unsigned int) evaluations.size(), numSeeds);
+                // Medians are over the runs that reached the target
+                if (evaluations.empty())
+                {
+                    printf(" %16s %12s\n", "-", "-");
+                    fprintf(json, "\"medianEvaluations\":null,\"medianWallTime\":null,");
+                }
+                else
+                {
+                    printf(" %16.0f %12.3f\n", median(evaluations), median(wallTimes));
+                    fprintf(json, "\"medianEvaluations\":%.1f,\"medianWallTime\":%.9f,", median(evaluations), median(wallTimes));
+                }
+                fprintf(json, "\"medianFinalScore\":%.17g}", median(finals));
+                first = false;
+            }
+        }
+    }
+    fprintf(json, "\n]}\n");
+    fclose(json);
+    printf("Wrote %s and %s\n", csvName.c_str(), jsonName.c_str());
+    return 0;
+}
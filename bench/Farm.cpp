@@ -0,0 +1,141 @@
+/*
+ *  Farm.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Config.hpp"
+#include "../Farm.hpp"
+#include "../FarmProcessor.hpp"
+#include "../God.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../rand.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/**
+ * Localhost check of the evaluation farm
+ * Runs the same seeded GA once with local evaluation and once on a farm of
+ * spawned genetics-worker processes. During the farm run one worker is
+ * killed and another stopped, so their batches must be re-dispatched, the
+ * stopped one only once its heartbeat times out, and the killed one must
+ * be started again. Both runs must end with
+ * identical successors.
+ *
+ * Usage: farm [path of genetics-worker]
+ * Exits with 0 if the runs agree and both failures were recovered from
+ **/
+
+static const unsigned long seed = 7;
+static const unsigned int numWorkers = 3;
+
+/**
+ * Kills a worker after generation 2 and stops another after generation 3
+ */
+class FaultSink : public virtual MetricsSink
+{
+    public:
+        FaultSink(const Farm& farm)
+            : m_farm(farm)
+        {
+        }
+
+        virtual void record(const GenerationStats& stats)
+        {
+            const std::vector<pid_t>& workers = m_farm.spawnedWorkers();
+            if (stats.generation == 2)
+            {
+                printf("Killing worker %d\n", (int) workers[0]);
+                kill(workers[0], SIGKILL);
+            }
+            else if (stats.generation == 3)
+            {
+                printf("Stopping worker %d\n", (int) workers[1]);
+                kill(workers[1], SIGSTOP);
+            }
+        }
+
+    private:
+        const Farm& m_farm;
+};
+
+static std::vector<SavedAlgo> run(const RunConfig& config, const Processor& processor, MetricsSink* sink, double& seconds)
+{
+    seed_rng(seed);
+    God god(processor, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, 2, config.numCycles);
+    god.getTuner().fix(2, config.populationSize / 8);
+    god.setLogPrefix("", false);
+    if (sink)
+    {
+        god.addSink(sink);
+    }
+    double start = monotonicTime();
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    seconds = monotonicTime() - start;
+    delete best.algo;
+    return god.getSuccessors();
+}
+
+int main(int argc, char** argv)
+{
+    std::string program = argc > 1 ? argv[1] : "./genetics-worker";
+    RunConfig config;
+    config.populationSize = 400;
+    config.numCycles = 6;
+
+    init_rng();
+    PID1DProcessor* local = createProcessor(config);
+    double localSeconds, farmSeconds;
+    std::vector<SavedAlgo> expected = run(config, *local, NULL, localSeconds);
+    delete local;
+
+    std::string error;
+    Farm* farm = new Farm(8, 2, 1.0);
+    if (!farm->listen("127.0.0.1:0", error) || !farm->spawnWorkers(numWorkers, program, 1, error))
+    {
+        fprintf(stderr, "Cannot start farm: %s\n", error.c_str());
+        return 1;
+    }
+    FarmProcessor* remote = new FarmProcessor(*farm, config);
+    FaultSink faults(*farm);
+    std::vector<SavedAlgo> actual = run(config, *remote, &faults, farmSeconds);
+    Farm::Stats stats = farm->getStats();
+    printf("Local: %.3fs Farm: %.3fs\n%s", localSeconds, farmSeconds, farm->getSummary().c_str());
+    kill(farm->spawnedWorkers()[1], SIGKILL);
+    delete remote;
+    delete farm;
+    free_rng();
+
+    bool same = expected.size() == actual.size();
+    for(unsigned int i = 0; same && i < expected.size(); i++)
+    {
+        same = expected[i].score.success == actual[i].score.success && expected[i].score.score == actual[i].score.score && expected[i].genes == actual[i].genes;
+    }
+    if (!same)
+    {
+        printf("FAIL: farm successors differ from local evaluation\n");
+        return 1;
+    }
+    if (stats.lost < 2 || stats.redispatched == 0 || stats.respawned == 0)
+    {
+        printf("FAIL: expected two lost workers, re-dispatched batches and a respawned worker\n");
+        return 1;
+    }
+    printf("OK: identical successors, %llu batches re-dispatched\n", stats.redispatched);
+    return 0;
+}
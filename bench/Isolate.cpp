@@ -0,0 +1,198 @@
+/*
+ *  Isolate.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Config.hpp"
+#include "../FitnessDb.hpp"
+#include "../God.hpp"
+#include "../IsolatedProcessor.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../rand.h"
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Fault injection check of IsolatedProcessor
+ * The plant is wrapped so that some algorithms, picked by a hash of their
+ * genes, always crash, and others crash or hang until a shared budget of
+ * faults runs out. The same seeded GA is run in worker processes with a
+ * timeout and in threads against a reference that scores the always
+ * crashing algorithms as failed. Both runs must end with identical
+ * successors, and every kind of fault must have been recovered from.
+ *
+ * Usage: isolate
+ * Exits with 0 if the runs agree
+ **/
+
+static const unsigned long seed = 11;
+static const unsigned int numWorkers = 3;
+static const unsigned int crashBudget = 3;
+static const unsigned int hangBudget = 1;
+
+enum Fault
+{
+    NONE,
+    ALWAYS_CRASH,
+    CRASH,
+    HANG
+};
+
+static Fault faultOf(const Algo* a)
+{
+    std::vector<double> genes = a->getGenes();
+    switch (fitnessHash(&genes[0], genes.size()) % 40)
+    {
+        case 0:
+            return ALWAYS_CRASH;
+        case 1:
+            return CRASH;
+        case 2:
+            return HANG;
+        default:
+            return NONE;
+    }
+}
+
+/**
+ * Injects the faults, the budgets live in memory shared with the workers
+ */
+class FaultyProcessor : public virtual Processor
+{
+    public:
+        FaultyProcessor(const Processor& processor, int* budgets)
+            : m_processor(processor)
+            , m_budgets(budgets)
+        {
+        }
+
+        virtual Processor::Score process(Algo* a, std::string logname="") const
+        {
+            Fault fault = faultOf(a);
+            if (fault == ALWAYS_CRASH || (fault == CRASH && __sync_fetch_and_sub(&m_budgets[0], 1) > 0))
+            {
+                raise(SIGSEGV);
+            }
+            if (fault == HANG && __sync_fetch_and_sub(&m_budgets[1], 1) > 0)
+            {
+                while (true)
+                {
+                    pause();
+                }
+            }
+            return m_processor.process(a, logname);
+        }
+
+    private:
+        const Processor& m_processor;
+        int* m_budgets;
+};
+
+/**
+ * What the isolated run should see: the always crashing algorithms failed
+ */
+class ReferenceProcessor : public virtual Processor
+{
+    public:
+        ReferenceProcessor(const Processor& processor)
+            : m_processor(processor)
+        {
+        }
+
+        virtual Processor::Score process(Algo* a, std::string logname="") const
+        {
+            if (faultOf(a) == ALWAYS_CRASH)
+            {
+                Processor::Score score = {false, HUGE_VAL};
+                return score;
+            }
+            return m_processor.process(a, logname);
+        }
+
+    private:
+        const Processor& m_processor;
+};
+
+static std::vector<SavedAlgo> run(const RunConfig& config, const Processor& processor, double& seconds)
+{
+    seed_rng(seed);
+    God god(processor, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, 1, config.numCycles);
+    god.getTuner().fix(1, config.populationSize);
+    god.setLogPrefix("", false);
+    double start = monotonicTime();
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    seconds = monotonicTime() - start;
+    delete best.algo;
+    return god.getSuccessors();
+}
+
+int main(int argc, char** argv)
+{
+    RunConfig config;
+    config.populationSize = 200;
+    config.numCycles = 6;
+
+    init_rng();
+    PID1DProcessor* plant = createProcessor(config);
+    ReferenceProcessor reference(*plant);
+    double localSeconds, isolatedSeconds;
+    std::vector<SavedAlgo> expected = run(config, reference, localSeconds);
+
+    int* budgets = static_cast<int*>(mmap(NULL, 2 * sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    budgets[0] = crashBudget;
+    budgets[1] = hangBudget;
+    FaultyProcessor faulty(*plant, budgets);
+    std::vector<Algo*> prototype = createSeeds(config);
+    // Enough attempts that the transient faults never exhaust them
+    IsolatedProcessor* isolated = new IsolatedProcessor(faulty, *prototype[0], numWorkers, config.populationSize, 0.5, crashBudget + hangBudget + 2, 50);
+    delete prototype[0];
+    std::string error;
+    if (!isolated->start(error))
+    {
+        printf("FAIL: %s\n", error.c_str());
+        return 1;
+    }
+    std::vector<SavedAlgo> actual = run(config, *isolated, isolatedSeconds);
+    IsolatedProcessor::Stats stats = isolated->getStats();
+    printf("Threads: %.3fs Isolated: %.3fs\n%s", localSeconds, isolatedSeconds, isolated->getSummary().c_str());
+    delete isolated;
+    delete plant;
+    munmap(budgets, 2 * sizeof(int));
+    free_rng();
+
+    bool same = expected.size() == actual.size();
+    for(unsigned int i = 0; same && i < expected.size(); i++)
+    {
+        same = expected[i].score.success == actual[i].score.success && expected[i].score.score == actual[i].score.score && expected[i].genes == actual[i].genes;
+    }
+    if (!same)
+    {
+        printf("FAIL: isolated successors differ from the reference\n");
+        return 1;
+    }
+    if (stats.failures == 0 || stats.timeouts == 0 || stats.retries == 0 || stats.respawns <= stats.crashes)
+    {
+        printf("FAIL: expected failures, timeouts, retries and recycled workers\n");
+        return 1;
+    }
+    printf("OK: identical successors, %llu crashes and %llu timeouts recovered from\n", stats.crashes, stats.timeouts);
+    return 0;
+}
@@ -0,0 +1,327 @@
+/*
+ *  Micro.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../AllocCounter.hpp"
+#include "../God.hpp"
+#include "../Heap.hpp"
+#include "../PDParam.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../PIDAlgo.hpp"
+#include "../Timer.hpp"
+#include "../rand.h"
+
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * Microbenchmarks of the hot paths
+ * Each benchmark doubles its iteration count until a run lasts minRunTime,
+ * then reports the fastest of numRepeats runs in ns/op, which is far less
+ * sensitive to noisy neighbours than the mean, and allocations per op from
+ * AllocCounter.
+ *
+ * Usage: micro [--out results.json] [--compare baseline.json] [--tolerance 0.25]
+ * In compare mode a benchmark regresses if it is slower than the baseline by
+ * more than the tolerance, or allocates more per op; the exit status is 1
+ * if any benchmark regressed
+ **/
+
+static volatile double s_sink;
+
+static PID1DProcessor* s_processor = NULL;
+static PIDAlgo* s_algo = NULL;
+
+static void processBench(unsigned long iterations)
+{
+    for(unsigned long i = 0; i < iterations; i++)
+    {
+        s_sink = s_processor->process(s_algo).score;
+    }
+}
+
+static void updateBench(unsigned long iterations)
+{
+    std::vector<double> inputs(2);
+    inputs[0] = 1.0;
+    s_algo->initialize();
+    for(unsigned long i = 0; i < iterations; i++)
+    {
+        inputs[1] = (i % 1000) * 1e-3;
+        s_sink = s_algo->update(inputs)[0];
+    }
+    s_algo->finalize();
+}
+
+static void paramGenBench(unsigned long iterations)
+{
+    PDParam param(3.0, 1.0);
+    for(unsigned long i = 0; i < iterations; i++)
+    {
+        Param<double>* child = param.gen();
+        s_sink = child->get();
+        delete child;
+    }
+}
+
+static void randfBench(unsigned long iterations)
+{
+    double sum = 0.0;
+    for(unsigned long i = 0; i < iterations; i++)
+    {
+        sum += randf();
+    }
+    s_sink = sum;
+}
+
+static void randgaussBench(unsigned long iterations)
+{
+    double sum = 0.0;
+    for(unsigned long i = 0; i < iterations; i++)
+    {
+        sum += randgauss(0.0, 1.0);
+    }
+    s_sink = sum;
+}
+
+/**
+ * One op is a God generation's worth of heap traffic for a single thread:
+ * population inserts into a successor-capped heap, then draining it
+ */
+static void heapBench(unsigned long iterations)
+{
+    static const unsigned int populationSize = 4000;
+    static const unsigned int successorSize = 10;
+    std::vector<AlgoScore> candidates(populationSize);
+    for(unsigned int i = 0; i < populationSize; i++)
+    {
+        candidates[i].algo = NULL;
+        candidates[i].score.success = false;
+        candidates[i].score.score = randf();
+    }
+    Heap<AlgoScore, God::minScoreHeap> heap(successorSize, successorSize);
+    for(unsigned long i = 0; i < iterations; i++)
+    {
+        for(unsigned int j = 0; j < populationSize; j++)
+        {
+            heap.Insert(candidates[j]);
+        }
+        while (heap.Size() > 0)
+        {
+            s_sink = heap.Pop().score.score;
+        }
+    }
+}
+
+struct Benchmark
+{
+    const char* name;
+    void (*run)(unsigned long iterations);
+};
+
+struct Result
+{
+    std::string name;
+    double nsPerOp;
+    double allocsPerOp;
+    unsigned long iterations;
+};
+
+static Result measure(const Benchmark& b)
+{
+    static const double minRunTime = 0.2;
+    static const unsigned int numRepeats = 5;
+
+    unsigned long iterations = 1;
+    while (true)
+    {
+        double start = monotonicTime();
+        b.run(iterations);
+        if (monotonicTime() - start >= minRunTime)
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    std::vector<double> times(numRepeats);
+    unsigned long long allocations = 0;
+    for(unsigned int i = 0; i < numRepeats; i++)
+    {
+        unsigned long long allocStart = threadAllocations();
+        double start = monotonicTime();
+        b.run(iterations);
+        times[i] = (monotonicTime() - start) / iterations * 1e9;
+        allocations += threadAllocations() - allocStart;
+    }
+
+    Result r;
+    r.name = b.name;
+    r.nsPerOp = *std::min_element(times.begin(), times.end());
+    r.allocsPerOp = (double) allocations / (numRepeats * iterations);
+    r.iterations = iterations;
+    return r;
+}
+
+static bool writeResults(const char* filename, const std::vector<Result>& results)
+{
+    FILE* f = fopen(filename, "w");
+    if (!f)
+    {
+        return false;
+    }
+    fprintf(f, "{\"benchmarks\":[\n");
+    for(unsigned int i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+        fprintf(f, "{\"name\":\"%s\",\"nsPerOp\":%.3f,\"allocsPerOp\":%.3f,\"iterations\":%lu}%s\n", r.name.c_str(), r.nsPerOp, r.allocsPerOp, r.iterations, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "]}\n");
+    fclose(f);
+    return true;
+}
+
+/**
+ * Reads back the one-benchmark-per-line layout written by writeResults()
+ */
+static bool readResults(const char* filename, std::map<std::string, Result>& results)
+{
+    FILE* f = fopen(filename, "r");
+    if (!f)
+    {
+        return false;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), f))
+    {
+        char name[256];
+        Result r;
+        if (sscanf(line, "{\"name\":\"%255[^\"]\",\"nsPerOp\":%lf,\"allocsPerOp\":%lf,\"iterations\":%lu", name, &r.nsPerOp, &r.allocsPerOp, &r.iterations) == 4)
+        {
+            r.name = name;
+            results[r.name] = r;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* out = NULL;
+    const char* compare = NULL;
+    double tolerance = 0.25;
+    for(int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc)
+        {
+            out = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--compare") && i + 1 < argc)
+        {
+            compare = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc)
+        {
+            tolerance = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--out results.json] [--compare baseline.json] [--tolerance 0.25]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    init_rng();
+    seed_rng(5489);
+    s_processor = new PID1DProcessor(5.0, 1.0, 0.01, 12.0, -12.0, 1.0, 1.0, 10.0, 10.0, 1.0, 0.03, 0.5, 0.1);
+    s_algo = new PIDAlgo(new PDParam(3.2, 1.0), new PDParam(0.0, 0.0), new PDParam(0.01, 0.01), 12.0, -12.0);
+
+    Benchmark benchmarks[] = {
+        {"PID1DProcessor::process", processBench},
+        {"PIDAlgo::update", updateBench},
+        {"PDParam::gen", paramGenBench},
+        {"randf", randfBench},
+        {"randgauss", randgaussBench},
+        {"Heap::Insert+Pop/generation", heapBench}
+    };
+    unsigned int numBenchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+    std::vector<Result> results;
+    for(unsigned int i = 0; i < numBenchmarks; i++)
+    {
+        results.push_back(measure(benchmarks[i]));
+    }
+    delete s_algo;
+    delete s_processor;
+    free_rng();
+
+    std::map<std::string, Result> baseline;
+    if (compare && !readResults(compare, baseline))
+    {
+        fprintf(stderr, "Cannot read baseline %s\n", compare);
+        return 1;
+    }
+
+    bool regressed = false;
+    printf("%-30s %14s %12s", "benchmark", "ns/op", "allocs/op");
+    if (compare)
+    {
+        printf(" %14s %9s", "baseline ns/op", "change");
+    }
+    printf("\n");
+    for(unsigned int i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+        printf("%-30s %14.3f %12.3f", r.name.c_str(), r.nsPerOp, r.allocsPerOp);
+        if (compare)
+        {
+            std::map<std::string, Result>::const_iterator it = baseline.find(r.name);
+            if (it == baseline.end())
+            {
+                printf(" %14s %9s", "-", "new");
+            }
+            else
+            {
+                const Result& b = it->second;
+                double change = (r.nsPerOp - b.nsPerOp) / b.nsPerOp;
+                bool slower = change > tolerance;
+                bool allocs = r.allocsPerOp > b.allocsPerOp + 0.5;
+                printf(" %14.3f %+8.1f%%%s%s", b.nsPerOp, change * 100.0, slower ? " SLOWER" : "", allocs ? " MORE ALLOCS" : "");
+                regressed = regressed || slower || allocs;
+            }
+        }
+        printf("\n");
+    }
+
+    if (out && !writeResults(out, results))
+    {
+        fprintf(stderr, "Cannot write %s\n", out);
+        return 1;
+    }
+    if (regressed)
+    {
+        printf("Performance regressed against %s\n", compare);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ *  Noise.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Algo.hpp"
+#include "../Config.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../Timer.hpp"
+#include "../rand.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+/**
+ * Common random numbers on the noisy plant
+ * Scores two nearby gain sets every generation, once against the same
+ * draws, as God compares a generation, and once against the draws of
+ * different generations, as independent noise would, and compares the
+ * spread of their score difference. Also checks that a generation's draws
+ * do not change when they are drawn again, and times noisy evaluations
+ * against noise-free ones and the drawing itself.
+ *
+ * Usage: noise [generations]
+ * Exits with 0 if common draws narrow the difference and are repeatable
+ **/
+
+static void moments(const std::vector<double>& values, double& mean, double& sigma)
+{
+    mean = 0.0;
+    for(unsigned int i = 0; i < values.size(); i++)
+    {
+        mean += values[i];
+    }
+    mean /= values.size();
+    double m = 0.0;
+    for(unsigned int i = 0; i < values.size(); i++)
+    {
+        m += (values[i] - mean) * (values[i] - mean);
+    }
+    sigma = sqrt(m / (values.size() - 1));
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int generations = argc > 1 ? atoi(argv[1]) : 200;
+    RunConfig config;
+    config.seedKP = 3;
+    config.seedKD = 0.05;
+    config.sensorNoise = 0.002;
+    config.actuatorNoise = 1;
+    config.loadDisturbance = 0.05;
+
+    init_rng();
+    PID1DProcessor* processor = createProcessor(config);
+    Algo* seed = createSeeds(config)[0];
+    std::vector<double> genes = seed->getGenes();
+    Algo* a = seed->clone(genes);
+    genes[0] *= 1.05;
+    genes[2] *= 1.2;
+    Algo* b = seed->clone(genes);
+
+    std::vector<double> common(generations), independent(generations);
+    bool repeatable = true;
+    for(unsigned int g = 0; g < generations; g++)
+    {
+        processor->beginGeneration(g + 1);
+        double scoreA = processor->process(a).score;
+        double scoreB = processor->process(b).score;
+        common[g] = scoreA - scoreB;
+        processor->beginGeneration(generations + g + 1);
+        independent[g] = scoreA - processor->process(b).score;
+        processor->beginGeneration(g + 1);
+        repeatable = repeatable && processor->process(a).score == scoreA;
+    }
+
+    double start = monotonicTime();
+    for(unsigned int g = 0; g < generations; g++)
+    {
+        processor->beginGeneration(g + 1);
+    }
+    double draw = (monotonicTime() - start) / generations;
+    start = monotonicTime();
+    for(unsigned int g = 0; g < generations; g++)
+    {
+        processor->process(a);
+        processor->process(b);
+    }
+    double noisy = (monotonicTime() - start) / (2.0 * generations);
+
+    RunConfig quiet = config;
+    quiet.sensorNoise = quiet.actuatorNoise = quiet.loadDisturbance = 0;
+    PID1DProcessor* ideal = createProcessor(quiet);
+    start = monotonicTime();
+    double idealDifference = 0.0;
+    for(unsigned int g = 0; g < generations; g++)
+    {
+        idealDifference = ideal->process(a).score - ideal->process(b).score;
+    }
+    double clean = (monotonicTime() - start) / (2.0 * generations);
+
+    double commonMean, commonSigma, independentMean, independentSigma;
+    moments(common, commonMean, commonSigma);
+    moments(independent, independentMean, independentSigma);
+    printf("Generations: %u, noise-free difference %g\n", generations, idealDifference);
+    printf("Common draws: difference %g +- %g\n", commonMean, commonSigma);
+    printf("Independent draws: difference %g +- %g\n", independentMean, independentSigma);
+    printf("Evaluation: %.1fus noisy, %.1fus noise-free, drawing a generation's noise %.1fus\n", noisy * 1e6, clean * 1e6, draw * 1e6);
+
+    delete a;
+    delete b;
+    delete seed;
+    delete processor;
+    delete ideal;
+    free_rng();
+
+    if (!repeatable)
+    {
+        printf("FAIL: a generation's draws change when drawn again\n");
+        return 1;
+    }
+    if (!(commonSigma < independentSigma))
+    {
+        printf("FAIL: common draws do not narrow the difference\n");
+        return 1;
+    }
+    printf("OK: common draws cut the spread of the difference %.1f times\n", independentSigma / commonSigma);
+    return 0;
+}
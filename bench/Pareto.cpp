@@ -0,0 +1,227 @@
+/*
+ *  Pareto.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Config.hpp"
+#include "../God.hpp"
+#include "../Pareto.hpp"
+#include "../rand.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+/**
+ * Check of the NSGA-II pieces
+ * Compares nondominatedSort() with Deb's O(M N^2) sort on random points,
+ * coarse ones to force ties and duplicates, and times both; checks that
+ * crowdingDistances() does not depend on the thread count; then runs
+ * God::simulatePareto() on two conflicting objectives with one and with
+ * two threads and checks that both return the same, mutually
+ * non-dominated front.
+ *
+ * Usage: pareto
+ * Exits with 0 if every check passes
+ **/
+
+static const unsigned long seed = 23;
+
+/**
+ * Deb's fast non-dominated sort, the reference
+ */
+static unsigned int naiveSort(const std::vector<double>& objectives, unsigned int count, unsigned int numObjectives, std::vector<unsigned int>& ranks)
+{
+    std::vector<std::vector<unsigned int> > dominated(count);
+    std::vector<unsigned int> dominators(count, 0);
+    for(unsigned int i = 0; i < count; i++)
+    {
+        for(unsigned int j = 0; j < count; j++)
+        {
+            if (dominates(&objectives[(size_t) i * numObjectives], &objectives[(size_t) j * numObjectives], numObjectives))
+            {
+                dominated[i].push_back(j);
+                dominators[j]++;
+            }
+        }
+    }
+    ranks.assign(count, 0);
+    std::vector<unsigned int> front;
+    for(unsigned int i = 0; i < count; i++)
+    {
+        if (dominators[i] == 0)
+        {
+            front.push_back(i);
+        }
+    }
+    unsigned int numFronts = 0;
+    while (front.size())
+    {
+        std::vector<unsigned int> next;
+        for(unsigned int n = 0; n < front.size(); n++)
+        {
+            ranks[front[n]] = numFronts;
+            for(unsigned int k = 0; k < dominated[front[n]].size(); k++)
+            {
+                if (--dominators[dominated[front[n]][k]] == 0)
+                {
+                    next.push_back(dominated[front[n]][k]);
+                }
+            }
+        }
+        front.swap(next);
+        numFronts++;
+    }
+    return numFronts;
+}
+
+static std::vector<double> randomPoints(unsigned int count, unsigned int numObjectives, bool coarse)
+{
+    std::vector<double> objectives((size_t) count * numObjectives);
+    for(unsigned int i = 0; i < objectives.size(); i++)
+    {
+        objectives[i] = coarse ? floor(randf() * 8) : randf();
+    }
+    return objectives;
+}
+
+static bool checkSort(unsigned int count, unsigned int numObjectives, bool coarse)
+{
+    std::vector<double> objectives = randomPoints(count, numObjectives, coarse);
+    std::vector<unsigned int> ranks(count), expected;
+    double start = monotonicTime();
+    unsigned int numFronts = nondominatedSort(&objectives[0], count, numObjectives, &ranks[0]);
+    double middle = monotonicTime();
+    unsigned int expectedFronts = naiveSort(objectives, count, numObjectives, expected);
+    double stop = monotonicTime();
+    bool same = numFronts == expectedFronts && ranks == expected;
+    printf("%u points, %u objectives%s: %u fronts, ENS %.3fms naive %.3fms %s\n", count, numObjectives, coarse ? ", coarse" : "", numFronts, (middle - start) * 1e3, (stop - middle) * 1e3, same ? "agree" : "DIFFER");
+    return same;
+}
+
+/**
+ * Two objectives: distances of (kP, kD) from (1, 0) and from (3, 1), so the
+ * Pareto set is the segment between them
+ */
+class TwoTargetProcessor : public virtual Processor
+{
+    public:
+        virtual Processor::Score process(Algo* a, std::string logname="") const
+        {
+            double objectives[2];
+            return processObjectives(a, objectives);
+        }
+
+        virtual unsigned int numObjectives() const
+        {
+            return 2;
+        }
+
+        virtual Processor::Score processObjectives(Algo* a, double* objectives) const
+        {
+            a->initialize();
+            std::vector<double> genes = a->getGenes();
+            a->finalize();
+            objectives[0] = hypot(genes[0] - 1, genes[2]);
+            objectives[1] = hypot(genes[0] - 3, genes[2] - 1);
+            Processor::Score score = {true, objectives[0] + objectives[1]};
+            return score;
+        }
+};
+
+static std::vector<ParetoPoint> runGa(const RunConfig& config, unsigned int numThreads)
+{
+    TwoTargetProcessor processor;
+    seed_rng(seed);
+    God god(processor, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, numThreads, config.numCycles);
+    god.getTuner().fix(numThreads, 16);
+    god.setLogPrefix("", false);
+    return god.simulatePareto();
+}
+
+int main(int argc, char** argv)
+{
+    init_rng();
+    seed_rng(seed);
+    bool ok = true;
+    ok = checkSort(3000, 2, false) && ok;
+    ok = checkSort(3000, 2, true) && ok;
+    ok = checkSort(3000, 3, false) && ok;
+    ok = checkSort(3000, 3, true) && ok;
+    ok = checkSort(3000, 4, false) && ok;
+    ok = checkSort(3000, 5, true) && ok;
+    ok = checkSort(1, 2, false) && ok;
+
+    unsigned int count = 200000;
+    std::vector<double> objectives = randomPoints(count, 3, false);
+    std::vector<unsigned int> ranks(count);
+    double start = monotonicTime();
+    unsigned int numFronts = nondominatedSort(&objectives[0], count, 3, &ranks[0]);
+    double sorted = monotonicTime();
+    std::vector<double> serial(count), parallel(count);
+    crowdingDistances(&objectives[0], count, 3, &ranks[0], numFronts, 1, &serial[0]);
+    double crowded = monotonicTime();
+    crowdingDistances(&objectives[0], count, 3, &ranks[0], numFronts, 4, &parallel[0]);
+    double crowdedParallel = monotonicTime();
+    bool same = serial == parallel;
+    printf("%u points, 3 objectives: %u fronts, ENS %.1fms, crowding %.1fms on 1 thread %.1fms on 4 %s\n", count, numFronts, (sorted - start) * 1e3, (crowded - sorted) * 1e3, (crowdedParallel - crowded) * 1e3, same ? "agree" : "DIFFER");
+    ok = same && ok;
+
+    RunConfig config;
+    config.populationSize = 200;
+    config.numCycles = 30;
+    config.seedKP = 2;
+    config.seedKD = 0.5;
+    config.mutationKD = 0.5;
+    std::vector<ParetoPoint> one = runGa(config, 1);
+    std::vector<ParetoPoint> two = runGa(config, 2);
+    free_rng();
+
+    bool agree = one.size() == two.size();
+    for(unsigned int i = 0; agree && i < one.size(); i++)
+    {
+        agree = one[i].objectives == two[i].objectives && one[i].algo->getGenes() == two[i].algo->getGenes();
+    }
+    bool nondominated = true;
+    for(unsigned int i = 0; i < one.size(); i++)
+    {
+        for(unsigned int j = 0; j < one.size(); j++)
+        {
+            nondominated = nondominated && !dominates(&one[i].objectives[0], &one[j].objectives[0], 2);
+        }
+    }
+    printf("GA: front of %u, objectives from (%g, %g) to (%g, %g)\n", (unsigned int) one.size(), one[0].objectives[0], one[0].objectives[1], one.back().objectives[0], one.back().objectives[1]);
+    for(unsigned int i = 0; i < one.size(); i++)
+    {
+        delete one[i].algo;
+    }
+    for(unsigned int i = 0; i < two.size(); i++)
+    {
+        delete two[i].algo;
+    }
+    if (!agree || !nondominated || one.size() < 2)
+    {
+        printf("FAIL: the GA front %s\n", !agree ? "depends on the thread count" : !nondominated ? "has dominated points" : "collapsed");
+        return 1;
+    }
+    if (!ok)
+    {
+        printf("FAIL: ENS or crowding differ from the reference\n");
+        return 1;
+    }
+    printf("OK: sorts agree with the reference, crowding and fronts do not depend on threads\n");
+    return 0;
+}
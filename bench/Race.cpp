@@ -0,0 +1,215 @@
+/*
+ *  Race.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Config.hpp"
+#include "../God.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../Race.hpp"
+#include "../rand.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+/**
+ * Racing against scoring every sample
+ * First races single generations of the noisy plant, fresh from the seed
+ * and bred close to a good algorithm, against scoring all of their
+ * samples, and compares the successors each picks by their full means.
+ * Then runs the same seeded GA with and without racing and scores both
+ * winners on fresh noise.
+ *
+ * Usage: race [population [generations]]
+ * Exits with 0 if racing saves samples and picks successors within 1% of
+ * the full evaluation's
+ **/
+
+static const unsigned int numSamples = 8;
+static const unsigned int successorSize = 10;
+
+static RunConfig noisyConfig()
+{
+    RunConfig config;
+    config.sensorNoise = 0.002;
+    config.actuatorNoise = 1;
+    config.loadDisturbance = 0.05;
+    config.noiseSamples = numSamples;
+    config.successorSize = successorSize;
+    return config;
+}
+
+/**
+ * Mean full score of the successorSize algorithms best by the given scores
+ */
+static double selected(const std::vector<double>& by, const std::vector<double>& full, const std::vector<bool>& eligible)
+{
+    std::vector<std::pair<double, unsigned int> > order;
+    for(unsigned int i = 0; i < by.size(); i++)
+    {
+        if (eligible[i])
+        {
+            order.push_back(std::make_pair(by[i], i));
+        }
+    }
+    std::sort(order.begin(), order.end());
+    double sum = 0.0;
+    for(unsigned int n = 0; n < successorSize; n++)
+    {
+        sum += full[order[n].second];
+    }
+    return sum / successorSize;
+}
+
+/**
+ * Races one generation of population
+ * @return mean full score of the raced successors over that of the true ones
+ */
+static double raceGeneration(const PID1DProcessor& processor, const std::vector<Algo*>& population, double& samplesUsed)
+{
+    unsigned int count = population.size();
+    std::vector<double> full(count);
+    std::vector<bool> all(count, true), survived(count);
+    for(unsigned int i = 0; i < count; i++)
+    {
+        full[i] = processor.process(population[i]).score;
+    }
+    Race race(count, numSamples, successorSize, 0.05);
+    while (race.racers().size())
+    {
+        for(unsigned int n = 0; n < race.racers().size(); n++)
+        {
+            unsigned int i = race.racers()[n];
+            race.record(i, processor.processSample(population[i], race.nextSample()));
+        }
+        race.update();
+    }
+    std::vector<double> raced(count);
+    for(unsigned int i = 0; i < count; i++)
+    {
+        raced[i] = race.score(i).score;
+        survived[i] = !race.dropped(i);
+    }
+    samplesUsed = (double) race.samplesScored() / ((double) count * numSamples);
+    return selected(raced, full, survived) / selected(full, full, all);
+}
+
+class SampleSink : public virtual MetricsSink
+{
+    public:
+        SampleSink()
+            : samples(0.0)
+        {
+        }
+
+        virtual void record(const GenerationStats& stats)
+        {
+            samples += stats.samplesUsed * stats.populationSize * numSamples;
+        }
+
+        double samples;
+};
+
+static double runGa(const RunConfig& config, bool racing, double& samples, double& seconds, std::vector<double>& genes)
+{
+    PID1DProcessor* processor = createProcessor(config);
+    seed_rng(config.seed);
+    SampleSink sink;
+    God god(*processor, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, 1, config.numCycles);
+    god.setLogPrefix("", false);
+    god.setRacing(racing);
+    god.addSink(&sink);
+    double start = monotonicTime();
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    seconds = monotonicTime() - start;
+    samples = sink.samples;
+    genes = best.algo->getGenes();
+
+    RunConfig fresh = config;
+    fresh.noiseSeed = config.noiseSeed + 1000003;
+    fresh.noiseSamples = 64;
+    PID1DProcessor* judge = createProcessor(fresh);
+    double score = judge->process(best.algo).score;
+    delete judge;
+    delete best.algo;
+    delete processor;
+    return score;
+}
+
+int main(int argc, char** argv)
+{
+    RunConfig config = noisyConfig();
+    config.populationSize = argc > 1 ? atoi(argv[1]) : 400;
+    config.numCycles = argc > 2 ? atoi(argv[2]) : 10;
+    config.seed = 11;
+
+    init_rng();
+    seed_rng(config.seed);
+    PID1DProcessor* processor = createProcessor(config);
+    bool ok = true;
+    for(unsigned int close = 0; close < 2; close++)
+    {
+        RunConfig bred = config;
+        if (close)
+        {
+            bred.seedKP = 3.7;
+            bred.seedKD = 0.18;
+            bred.mutationKP = 0.05;
+            bred.mutationKD = 0.2;
+        }
+        Algo* seed = createSeeds(bred)[0];
+        double worst = 0.0, samplesUsed = 0.0;
+        for(unsigned int generation = 1; generation <= 5; generation++)
+        {
+            processor->beginGeneration(generation);
+            std::vector<Algo*> population(config.populationSize);
+            for(unsigned int i = 0; i < population.size(); i++)
+            {
+                population[i] = seed->gen();
+            }
+            double used;
+            worst = std::max(worst, raceGeneration(*processor, population, used));
+            samplesUsed += used / 5;
+            for(unsigned int i = 0; i < population.size(); i++)
+            {
+                delete population[i];
+            }
+        }
+        delete seed;
+        printf("%s population: raced on %.1f%% of the samples, successors at most %.3f%% worse\n", close ? "Close" : "Fresh", samplesUsed * 100.0, (worst - 1) * 100.0);
+        ok = ok && samplesUsed < 1.0 && worst <= 1.01;
+    }
+    delete processor;
+
+    double samples[2], seconds[2], scores[2];
+    std::vector<double> genes[2];
+    for(unsigned int racing = 0; racing < 2; racing++)
+    {
+        scores[racing] = runGa(config, racing, samples[racing], seconds[racing], genes[racing]);
+        printf("GA %s: %.0f samples in %.3fs, winner kP %g kD %g scores %g on fresh noise\n", racing ? "racing" : "full", samples[racing], seconds[racing], genes[racing][0], genes[racing][2], scores[racing]);
+    }
+    free_rng();
+
+    if (!ok)
+    {
+        printf("FAIL: racing saved no samples or picked worse successors\n");
+        return 1;
+    }
+    printf("OK: racing used %.1f%% of the GA's samples\n", samples[1] / samples[0] * 100.0);
+    return 0;
+}
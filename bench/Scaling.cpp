@@ -0,0 +1,221 @@
+/*
+ *  Scaling.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../God.hpp"
+#include "../PDParam.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../PIDAlgo.hpp"
+#include "../rand.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+/**
+ * Strong and weak scaling benchmark of God::simulate
+ * Runs the main.cpp plant with a fixed seed at 1..N threads, first with a
+ * fixed population (strong scaling) and then with the population growing
+ * with the thread count (weak scaling). Thread count and chunk size are
+ * pinned so the tuner does not interfere.
+ *
+ * Usage: scaling [maxThreads [population [generations [output.json]]]]
+ *
+ * Efficiency is speedup / threads for strong scaling and T1 / Tn for weak
+ * scaling. The serial fraction is the share of wall time spent outside the
+ * parallel evaluation (breed, merge, select and log); karpFlatt is the
+ * experimentally determined serial fraction (1/speedup - 1/n) / (1 - 1/n)
+ **/
+
+struct TotalsSink : public virtual MetricsSink
+{
+    TotalsSink()
+        : generations(0)
+        , evaluations(0)
+        , breed(0.0)
+        , evaluate(0.0)
+        , merge(0.0)
+        , select(0.0)
+        , log(0.0)
+    {
+    }
+
+    virtual void record(const GenerationStats& stats)
+    {
+        generations++;
+        evaluations += stats.populationSize;
+        breed += stats.breedTime;
+        evaluate += stats.evaluateTime;
+        merge += stats.mergeTime;
+        select += stats.selectTime;
+        log += stats.logTime;
+    }
+
+    double total() const
+    {
+        return breed + evaluate + merge + select + log;
+    }
+
+    double serial() const
+    {
+        return breed + merge + select + log;
+    }
+
+    unsigned int generations;
+    unsigned long long evaluations;
+    double breed;
+    double evaluate;
+    double merge;
+    double select;
+    double log;
+};
+
+struct ScalingRun
+{
+    const char* mode;
+    unsigned int threads;
+    unsigned int population;
+    TotalsSink totals;
+    double speedup;
+    double efficiency;
+    double karpFlatt;
+};
+
+static TotalsSink runGod(unsigned int threads, unsigned int populationSize, unsigned int numCycles, unsigned long seed, const std::string& logPrefix)
+{
+    static const double timeout                     =   5.00;
+    static const double timein                      =   1.00;
+    static const double threshold                   =   0.01;
+    static const double maxVoltage                  =  12.00;
+    static const double minVoltage                  = -12.00;
+    static const double goal                        =   1.00;
+    static const double mass                        =  1.000;
+    static const double motorStallTorque            = 010.00;
+    static const double motorFreeSpeed              = 010.00;
+    static const double gearingRatio                =   1.00;
+    static const double wheelDiameter               =   0.03;
+    static const double staticFriction              =   0.50;
+    static const double kineticFriction             =   0.10;
+    static const double k                           =   1.00;
+    static const unsigned int successorSize         =    10;
+
+    seed_rng(seed);
+    PID1DProcessor processor(timeout, timein, threshold, maxVoltage, minVoltage, goal, mass, motorStallTorque, motorFreeSpeed, gearingRatio, wheelDiameter, staticFriction, kineticFriction);
+    std::vector<Algo*> seeds(1);
+    seeds[0] = new PIDAlgo(new PDParam(0, k), new PDParam(0, 0), new PDParam(0, k/100.0), maxVoltage, minVoltage);
+
+    TotalsSink totals;
+    God god(processor, seeds, populationSize, successorSize, 1, threads, numCycles);
+    unsigned int chunk = populationSize / (threads * ThreadTuner::chunksPerThread);
+    god.getTuner().fix(threads, chunk);
+    god.setLogPrefix(logPrefix);
+    god.addSink(&totals);
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    delete best.algo;
+
+    for(unsigned int i = 1; i <= numCycles; i++)
+    {
+        std::stringstream ss;
+        ss << logPrefix << i << ".log";
+        unlink(ss.str().c_str());
+    }
+    return totals;
+}
+
+int main(int argc, char** argv)
+{
+    static const unsigned long seed = 5489;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int maxThreads = argc > 1 ? atoi(argv[1]) : (cores > 0 ? cores : 1);
+    unsigned int population = argc > 2 ? atoi(argv[2]) : 4000;
+    unsigned int generations = argc > 3 ? atoi(argv[3]) : 5;
+    const char* output = argc > 4 ? argv[4] : "scaling.json";
+    if (maxThreads == 0 || population == 0 || generations == 0)
+    {
+        fprintf(stderr, "Usage: %s [maxThreads [population [generations [output.json]]]]\n", argv[0]);
+        return 1;
+    }
+
+    char logDir[] = "/tmp/genetics-scaling-XXXXXX";
+    if (!mkdtemp(logDir))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string logPrefix = std::string(logDir) + "/";
+
+    init_rng();
+    std::vector<ScalingRun> runs;
+    const char* modes[2] = {"strong", "weak"};
+    for(unsigned int m = 0; m < 2; m++)
+    {
+        double baseline = 0.0;
+        for(unsigned int t = 1; t <= maxThreads; t++)
+        {
+            ScalingRun run;
+            run.mode = modes[m];
+            run.threads = t;
+            run.population = m == 0 ? population : population * t;
+            run.totals = runGod(t, run.population, generations, seed, logPrefix);
+            double wall = run.totals.total();
+            if (t == 1)
+            {
+                baseline = wall;
+            }
+            // Weak scaling does t times the work, so normalise to the 1-thread rate
+            run.speedup = m == 0 ? baseline / wall : baseline * t / wall;
+            run.efficiency = run.speedup / t;
+            run.karpFlatt = t > 1 ? (1.0 / run.speedup - 1.0 / t) / (1.0 - 1.0 / t) : 0.0;
+            runs.push_back(run);
+            fprintf(stderr, "%s %u threads done\n", run.mode, t);
+        }
+    }
+    free_rng();
+    rmdir(logDir);
+
+    printf("%-6s %7s %10s %12s %12s %8s %10s %8s %9s\n", "mode", "threads", "population", "s/gen", "evals/s", "speedup", "efficiency", "serial", "karpFlatt");
+    for(unsigned int i = 0; i < runs.size(); i++)
+    {
+        const ScalingRun& r = runs[i];
+        double wall = r.totals.total();
+        printf("%-6s %7u %10u %12.6f %12.1f %8.3f %10.3f %8.4f %9.4f\n", r.mode, r.threads, r.population, wall / r.totals.generations, r.totals.evaluations / wall, r.speedup, r.efficiency, r.totals.serial() / wall, r.karpFlatt);
+    }
+
+    FILE* f = fopen(output, "w");
+    if (!f)
+    {
+        perror(output);
+        return 1;
+    }
+    fprintf(f, "{\"seed\":%lu,\"generations\":%u,\"cores\":%ld,\"runs\":[\n", seed, generations, cores);
+    for(unsigned int i = 0; i < runs.size(); i++)
+    {
+        const ScalingRun& r = runs[i];
+        const TotalsSink& t = r.totals;
+        double wall = t.total();
+        fprintf(f, "%s{\"mode\":\"%s\",\"threads\":%u,\"population\":%u,\"wallPerGeneration\":%.9f,\"evaluationsPerSecond\":%.3f,", i ? ",\n" : "", r.mode, r.threads, r.population, wall / t.generations, t.evaluations / wall);
+        fprintf(f, "\"speedup\":%.6f,\"efficiency\":%.6f,\"serialFraction\":%.6f,\"karpFlatt\":%.6f,", r.speedup, r.efficiency, t.serial() / wall, r.karpFlatt);
+        fprintf(f, "\"phases\":{\"breed\":%.9f,\"evaluate\":%.9f,\"merge\":%.9f,\"select\":%.9f,\"log\":%.9f}}", t.breed, t.evaluate, t.merge, t.select, t.log);
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    printf("Wrote %s\n", output);
+    return 0;
+}
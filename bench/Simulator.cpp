@@ -0,0 +1,138 @@
+/*
+ *  Simulator.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Config.hpp"
+#include "../FitnessDb.hpp"
+#include "../God.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../SimulatorProcessor.hpp"
+#include "../rand.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/**
+ * Fault injection check of SimulatorProcessor
+ * Runs the same seeded GA once against the built-in plant and once on
+ * genetics-sim processes told to hang on some genomes, crash on others and
+ * exit every few requests. The local run scores the hanging and crashing
+ * genomes as failed, which the simulator run must arrive at by timing out,
+ * restarting and retrying. Both runs must end with identical successors.
+ *
+ * Usage: simulator [path of genetics-sim]
+ * Exits with 0 if the runs agree and every fault was recovered from
+ **/
+
+static const unsigned long seed = 13;
+static const unsigned int hang = 97;
+static const unsigned int crash = 89;
+
+/**
+ * The built-in plant failing where genetics-sim is told to misbehave
+ */
+class ReferenceProcessor : public virtual Processor
+{
+    public:
+        ReferenceProcessor(const Processor& processor)
+            : m_processor(processor)
+        {
+        }
+
+        virtual Processor::Score process(Algo* a, std::string logname="") const
+        {
+            std::vector<double> genes = a->getGenes();
+            unsigned long long hash = fitnessHash(&genes[0], genes.size());
+            if (hash % hang == 0 || hash % crash == 1)
+            {
+                Processor::Score score = {false, HUGE_VAL};
+                return score;
+            }
+            return m_processor.process(a, logname);
+        }
+
+    private:
+        const Processor& m_processor;
+};
+
+static std::vector<SavedAlgo> run(const RunConfig& config, const Processor& processor, double& seconds)
+{
+    seed_rng(seed);
+    God god(processor, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, 2, config.numCycles);
+    god.getTuner().fix(2, config.populationSize / 8);
+    god.setLogPrefix("", false);
+    double start = monotonicTime();
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    seconds = monotonicTime() - start;
+    delete best.algo;
+    return god.getSuccessors();
+}
+
+int main(int argc, char** argv)
+{
+    RunConfig config;
+    config.populationSize = 200;
+    config.numCycles = 4;
+
+    init_rng();
+    PID1DProcessor* plant = createProcessor(config);
+    ReferenceProcessor reference(*plant);
+    double localSeconds, simulatorSeconds;
+    std::vector<SavedAlgo> expected = run(config, reference, localSeconds);
+    delete plant;
+
+    std::vector<std::string> command;
+    command.push_back(argc > 1 ? argv[1] : "./genetics-sim");
+    command.push_back("--hang");
+    command.push_back("97");
+    command.push_back("--crash");
+    command.push_back("89");
+    command.push_back("--exitAfter");
+    command.push_back("25");
+    SimulatorProcessor* simulator = new SimulatorProcessor(command, 3, 4, 2, 0.05, 2, 64);
+    std::string error;
+    if (!simulator->start(error))
+    {
+        fprintf(stderr, "Cannot start simulator: %s\n", error.c_str());
+        return 1;
+    }
+    std::vector<SavedAlgo> actual = run(config, *simulator, simulatorSeconds);
+    SimulatorProcessor::Stats stats = simulator->getStats();
+    printf("Local: %.3fs Simulator: %.3fs\n%s", localSeconds, simulatorSeconds, simulator->getSummary().c_str());
+    delete simulator;
+    free_rng();
+
+    bool same = expected.size() == actual.size();
+    for(unsigned int i = 0; same && i < expected.size(); i++)
+    {
+        same = expected[i].score.success == actual[i].score.success && expected[i].score.score == actual[i].score.score && expected[i].genes == actual[i].genes;
+    }
+    if (!same)
+    {
+        printf("FAIL: simulator successors differ from the reference\n");
+        return 1;
+    }
+    if (stats.timeouts == 0 || stats.crashes == 0 || stats.failures == 0 || stats.restarts <= stats.timeouts + stats.crashes)
+    {
+        printf("FAIL: expected timeouts, crashes, failures and clean exits\n");
+        return 1;
+    }
+    printf("OK: identical successors, %llu timeouts and %llu crashes recovered from\n", stats.timeouts, stats.crashes);
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ *  Streaming.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Config.hpp"
+#include "../God.hpp"
+#include "../rand.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+/**
+ * Memory of a huge population, kept whole versus streamed
+ * Runs the same GA over a cheap quadratic fitness with streaming on, twice
+ * to check that the children depend neither on thread scheduling nor on
+ * chunk sizes: once with the calibrating tuner and once with a fixed odd
+ * chunk size. Then runs it with the population kept whole. Streaming runs first, as peak RSS only
+ * grows.
+ *
+ * Usage: streaming [population [generations]]
+ * Exits with 0 if the streamed runs agree
+ **/
+
+static const unsigned long seed = 17;
+static const unsigned int numThreads = 2;
+
+/**
+ * Distance of the gains from kP 3, kI 0, kD 1
+ */
+class BowlProcessor : public virtual Processor
+{
+    public:
+        virtual Processor::Score process(Algo* a, std::string logname="") const
+        {
+            a->initialize();
+            std::vector<double> genes = a->getGenes();
+            a->finalize();
+            double kP = genes[0] - 3, kI = genes[1], kD = genes[2] - 1;
+            Processor::Score score = {true, sqrt(kP * kP + kI * kI + kD * kD)};
+            return score;
+        }
+};
+
+/**
+ * @param chunkSize fixed chunk size, 0 to let the tuner calibrate
+ */
+static std::vector<SavedAlgo> run(const RunConfig& config, bool streaming, unsigned int chunkSize, double& seconds, long& peakKb)
+{
+    BowlProcessor processor;
+    seed_rng(seed);
+    God god(processor, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, numThreads, config.numCycles);
+    if (chunkSize)
+    {
+        god.getTuner().fix(numThreads, chunkSize);
+    }
+    god.setLogPrefix("", false);
+    god.setStreaming(streaming);
+    double start = monotonicTime();
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    seconds = monotonicTime() - start;
+    peakKb = peakRssKb();
+    delete best.algo;
+    return god.getSuccessors();
+}
+
+int main(int argc, char** argv)
+{
+    RunConfig config;
+    config.populationSize = argc > 1 ? atoi(argv[1]) : 2000000;
+    config.numCycles = argc > 2 ? atoi(argv[2]) : 3;
+
+    init_rng();
+    double seconds[3];
+    long peakKb[3];
+    std::vector<SavedAlgo> first = run(config, true, 0, seconds[0], peakKb[0]);
+    std::vector<SavedAlgo> second = run(config, true, 1237, seconds[1], peakKb[1]);
+    std::vector<SavedAlgo> whole = run(config, false, 0, seconds[2], peakKb[2]);
+    free_rng();
+
+    double evaluations = config.populationSize * (double) config.numCycles;
+    printf("Population: %u Generations: %u\n", config.populationSize, config.numCycles);
+    printf("Streamed: %.3fs %.0f evals/s peak RSS %ld KiB best %g\n", seconds[0], evaluations / seconds[0], peakKb[0], first[0].score.score);
+    printf("Whole: %.3fs %.0f evals/s peak RSS %ld KiB best %g\n", seconds[2], evaluations / seconds[2], peakKb[2], whole[0].score.score);
+
+    bool same = first.size() == second.size();
+    for(unsigned int i = 0; same && i < first.size(); i++)
+    {
+        same = first[i].score.score == second[i].score.score && first[i].genes == second[i].genes;
+    }
+    if (!same)
+    {
+        printf("FAIL: streamed runs with the same seed differ\n");
+        return 1;
+    }
+    printf("OK: streamed runs agree\n");
+    return 0;
+}
@@ -0,0 +1,215 @@
+/*
+ *  Trajectory.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Algo.hpp"
+#include "../Config.hpp"
+#include "../God.hpp"
+#include "../PID1DProcessor.hpp"
+#include "../TrajectoryFile.hpp"
+#include "../TrajectoryProcessor.hpp"
+#include "../rand.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Tracking recorded setpoint profiles
+ * Writes profiles of smooth moves between random waypoints at 1 kHz, every
+ * other one with load steps, maps them back and checks they read exactly
+ * as written. Checks that tracking a constant setpoint at the goal for the
+ * step's timeout scores as the step response does, times opening the file
+ * and tracking it, and runs a seeded GA on the profiles on one and two
+ * threads, with and without racing over the profiles.
+ *
+ * Usage: trajectory [profiles [seconds]]
+ * Exits with 0 if the profiles read back exactly, the constant profile
+ * matches the step and the GA does not depend on the thread count
+ **/
+
+static const double period = 1e-3;
+
+/**
+ * Minimum-jerk moves between waypoints, each followed by a dwell
+ */
+static void makeProfile(unsigned int length, bool disturbed, std::vector<double>& setpoints, std::vector<double>& disturbances)
+{
+    setpoints.resize(length);
+    disturbances.assign(disturbed ? length : 0, 0.0);
+    double from = 0.0, to = 0.0, load = 0.0;
+    unsigned int start = 0, moveSteps = 1, dwellSteps = 0;
+    for(unsigned int i = 0; i < length; i++)
+    {
+        if (i >= start + moveSteps + dwellSteps)
+        {
+            from = to;
+            to = randf() * 2.0 - 1.0;
+            start = i;
+            moveSteps = (unsigned int) ((0.5 + fabs(to - from) * 2.0) / period);
+            dwellSteps = (unsigned int) ((1.0 + randf() * 2.0) / period);
+            load = disturbed ? (randf() - 0.5) * 0.6 : 0.0;
+        }
+        double s = std::min((i - start) / (double) moveSteps, 1.0);
+        setpoints[i] = from + (to - from) * s * s * s * (10 - 15 * s + 6 * s * s);
+        if (disturbed)
+        {
+            // The load steps in halfway through the dwell
+            disturbances[i] = i >= start + moveSteps + dwellSteps / 2 ? load : 0.0;
+        }
+    }
+}
+
+/**
+ * @param full receives the winner's score on every profile, a raced
+ * winner's own score only covers the profiles it was raced on
+ */
+static AlgoScore runGa(const RunConfig& config, const TrajectoryFile& trajectories, unsigned int threads, bool racing, double& seconds, Processor::Score& full)
+{
+    PID1DProcessor* plant = createProcessor(config);
+    TrajectoryProcessor processor(*plant, trajectories);
+    seed_rng(config.seed);
+    God god(processor, createSeeds(config), config.populationSize, config.successorSize, config.initialChunkSize, threads, config.numCycles);
+    god.setLogPrefix("", false);
+    god.setRacing(racing);
+    double start = monotonicTime();
+    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    seconds = monotonicTime() - start;
+    full = processor.process(best.algo);
+    delete plant;
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int numProfiles = argc > 1 ? atoi(argv[1]) : 8;
+    double seconds = argc > 2 ? atof(argv[2]) : 60;
+    unsigned int length = (unsigned int) (seconds / period);
+
+    init_rng();
+    seed_rng(5);
+    std::vector<std::vector<double> > setpoints(numProfiles), disturbances(numProfiles);
+    for(unsigned int i = 0; i < numProfiles; i++)
+    {
+        makeProfile(length, i % 2, setpoints[i], disturbances[i]);
+    }
+    char filename[] = "/tmp/genetics-trajectory-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd < 0)
+    {
+        printf("FAIL: cannot create a temporary file\n");
+        return 1;
+    }
+    close(fd);
+    std::string error;
+    TrajectoryFile trajectories;
+    double start = monotonicTime();
+    bool written = TrajectoryFile::write(filename, period, setpoints, disturbances, error);
+    double writing = monotonicTime() - start;
+    start = monotonicTime();
+    bool opened = written && trajectories.open(filename, error);
+    double opening = monotonicTime() - start;
+    unlink(filename);
+    if (!opened)
+    {
+        printf("FAIL: %s\n", error.c_str());
+        return 1;
+    }
+
+    bool exact = trajectories.numProfiles() == numProfiles && trajectories.period() == period;
+    for(unsigned int i = 0; exact && i < numProfiles; i++)
+    {
+        const TrajectoryFile::Profile& profile = trajectories.profile(i);
+        exact = profile.length == length && !memcmp(profile.setpoints, &setpoints[i][0], length * sizeof(double)) && (disturbances[i].empty() ? profile.disturbances == NULL : profile.disturbances && !memcmp(profile.disturbances, &disturbances[i][0], length * sizeof(double)));
+    }
+    printf("Profiles: %u of %g s, %.1f MB written in %.1fms, mapped in %.1fus\n", numProfiles, seconds, numProfiles * length * 1.5 * sizeof(double) / 1e6, writing * 1e3, opening * 1e6);
+
+    // Without a timein the step ends at the timeout as the profile does
+    RunConfig config;
+    config.seedKP = 20;
+    config.seedKD = 30000;
+    config.timein = 0;
+    PID1DProcessor* plant = createProcessor(config);
+    Algo* a = createSeeds(config)[0];
+    std::vector<double> step;
+    for(double t = 0; t < config.timeout; t += period)
+    {
+        step.push_back(config.goal);
+    }
+    Processor::Score stepScore = plant->process(a);
+    Processor::Score tracked = plant->track(a, &step[0], NULL, step.size(), period);
+    bool matches = stepScore.success == tracked.success && stepScore.score == tracked.score;
+    printf("Constant setpoint: success %d score %g, step response: success %d score %g\n", tracked.success, tracked.score, stepScore.success, stepScore.score);
+
+    TrajectoryProcessor processor(*plant, trajectories);
+    unsigned int evaluations = 5;
+    start = monotonicTime();
+    Processor::Score score;
+    for(unsigned int i = 0; i < evaluations; i++)
+    {
+        score = processor.process(a);
+    }
+    double evaluation = (monotonicTime() - start) / evaluations;
+    printf("Tracking: success %d score %g in %.2fms, %.1fns per step\n", score.success, score.score, evaluation * 1e3, evaluation / (numProfiles * (double) length) * 1e9);
+    delete a;
+    delete plant;
+
+    config.timein = RunConfig().timein;
+    config.populationSize = 60;
+    config.successorSize = 6;
+    config.numCycles = 4;
+    config.seed = 3;
+    double gaSeconds[3];
+    AlgoScore best[3];
+    Processor::Score full[3];
+    best[0] = runGa(config, trajectories, 1, false, gaSeconds[0], full[0]);
+    best[1] = runGa(config, trajectories, 2, false, gaSeconds[1], full[1]);
+    best[2] = runGa(config, trajectories, 2, true, gaSeconds[2], full[2]);
+    const char* names[3] = {"1 thread", "2 threads", "2 threads racing"};
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        std::vector<double> genes = best[i].algo->getGenes();
+        printf("GA %s: %.2fs, winner kP %g kD %g success %d score %g on every profile\n", names[i], gaSeconds[i], genes[0], genes[2], full[i].success, full[i].score);
+    }
+    bool repeatable = best[0].algo->getGenes() == best[1].algo->getGenes() && best[0].score.score == best[1].score.score;
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        delete best[i].algo;
+    }
+    free_rng();
+
+    if (!exact)
+    {
+        printf("FAIL: the mapped profiles differ from those written\n");
+        return 1;
+    }
+    if (!matches)
+    {
+        printf("FAIL: a constant setpoint does not score as the step response\n");
+        return 1;
+    }
+    if (!repeatable)
+    {
+        printf("FAIL: the GA depends on the thread count\n");
+        return 1;
+    }
+    printf("OK: profiles tracked in place from the mapping\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ *  genetics.cpp
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "genetics.h"
+
+#include "Config.hpp"
+#include "Optimizer.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+struct genetics_optimizer
+{
+    Optimizer* optimizer;
+    std::vector<std::string> geneNames;
+};
+
+static void setError(char* error, size_t errorSize, const std::string& message)
+{
+    if (error && errorSize > 0)
+    {
+        strncpy(error, message.c_str(), errorSize - 1);
+        error[errorSize - 1] = '\0';
+    }
+}
+
+static bool loadConfig(RunConfig& config, const char* text, char* error, size_t errorSize)
+{
+    std::string message;
+    // Library callers opt in to the per-generation logs
+    config.logging = false;
+    if ((text && !loadConfigString(config, text, message)) || !validateConfig(config, message) || !validateRunConfig(config, message))
+    {
+        setError(error, errorSize, message);
+        return false;
+    }
+    return true;
+}
+
+static void copyGenes(const Algo* algo, double* genes)
+{
+    std::vector<double> g = algo->getGenes();
+    std::copy(g.begin(), g.end(), genes);
+}
+
+genetics_optimizer* genetics_optimizer_create(const char* text, char* error, size_t errorSize)
+{
+    RunConfig config;
+    if (!loadConfig(config, text, error, errorSize))
+    {
+        return NULL;
+    }
+    std::vector<Algo*> seeds = createSeeds(config);
+    genetics_optimizer* optimizer = new genetics_optimizer;
+    optimizer->geneNames = seeds[0]->getGeneNames();
+    optimizer->optimizer = new Optimizer(seeds, config.populationSize, config.successorSize, config.seed);
+    return optimizer;
+}
+
+void genetics_optimizer_free(genetics_optimizer* optimizer)
+{
+    if (optimizer)
+    {
+        delete optimizer->optimizer;
+        delete optimizer;
+    }
+}
+
+unsigned int genetics_num_genes(const genetics_optimizer* optimizer)
+{
+    return optimizer->geneNames.size();
+}
+
+const char* genetics_gene_name(const genetics_optimizer* optimizer, unsigned int gene)
+{
+    return gene < optimizer->geneNames.size() ? optimizer->geneNames[gene].c_str() : NULL;
+}
+
+unsigned int genetics_ask(genetics_optimizer* optimizer, unsigned int maxCount, unsigned long* ids, double* genes)
+{
+    std::vector<Optimizer::Candidate> candidates = optimizer->optimizer->ask(maxCount);
+    unsigned int numGenes = optimizer->geneNames.size();
+    for(unsigned int i = 0; i < candidates.size(); i++)
+    {
+        ids[i] = candidates[i].id;
+        copyGenes(candidates[i].algo, genes + i * numGenes);
+    }
+    return candidates.size();
+}
+
+int genetics_tell(genetics_optimizer* optimizer, unsigned long id, int success, double score)
+{
+    Processor::Score s;
+    s.success = success != 0;
+    s.score = score;
+    return optimizer->optimizer->tell(id, s);
+}
+
+unsigned int genetics_generation(const genetics_optimizer* optimizer)
+{
+    return optimizer->optimizer->generation();
+}
+
+int genetics_best(const genetics_optimizer* optimizer, double* genes, int* success, double* score)
+{
+    AlgoScore best = optimizer->optimizer->best();
+    if (!best.algo)
+    {
+        return 0;
+    }
+    copyGenes(best.algo, genes);
+    *success = best.score.success;
+    *score = best.score.score;
+    return 1;
+}
+
+int genetics_run(const char* text, double* genes, int* success, double* score, char* error, size_t errorSize)
+{
+    RunConfig config;
+    if (!loadConfig(config, text, error, errorSize))
+    {
+        return 0;
+    }
+    RunResult result = run(config);
+    std::copy(result.genes.begin(), result.genes.end(), genes);
+    *success = result.success;
+    *score = result.score;
+    return 1;
+}
+
+unsigned int genetics_run_num_genes(void)
+{
+    RunConfig config;
+    std::vector<Algo*> seeds = createSeeds(config);
+    unsigned int numGenes = seeds[0]->getGenes().size();
+    delete seeds[0];
+    return numGenes;
+}
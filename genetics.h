@@ -0,0 +1,84 @@
+/*
+ *  genetics.h
+ *  Copyright (C) 2012 Eric Bakan
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+  * Plain C interface to libgenetics
+  * Runs are described by the text of a genetics.ini style configuration
+  * (see Config.hpp), NULL or "" for the defaults, except that nothing is
+  * logged unless the configuration sets logging = true. Genomes are arrays of
+  * genetics_num_genes() doubles, in the order of genetics_gene_name().
+  * Functions that can fail return 0 and, if error is not NULL, write a
+  * NUL-terminated message of at most errorSize bytes to it
+  */
+
+#ifndef GENETICS_H
+#define GENETICS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct genetics_optimizer genetics_optimizer;
+
+/**
+ * Ask/tell optimizer, see Optimizer.hpp
+ * @return NULL if the configuration is invalid
+ */
+genetics_optimizer* genetics_optimizer_create(const char* config, char* error, size_t errorSize);
+void genetics_optimizer_free(genetics_optimizer* optimizer);
+
+unsigned int genetics_num_genes(const genetics_optimizer* optimizer);
+const char* genetics_gene_name(const genetics_optimizer* optimizer, unsigned int gene);
+
+/**
+ * Hands out up to maxCount candidates of the current generation
+ * @param ids receives maxCount ids
+ * @param genes receives maxCount genomes, one after the other
+ * @return the number of candidates written, 0 while the rest of the
+ * generation is still being evaluated
+ */
+unsigned int genetics_ask(genetics_optimizer* optimizer, unsigned int maxCount, unsigned long* ids, double* genes);
+
+/**
+ * Lower scores are better, successful candidates beat failed ones
+ * @return 0 if the id is not an outstanding candidate
+ */
+int genetics_tell(genetics_optimizer* optimizer, unsigned long id, int success, double score);
+
+unsigned int genetics_generation(const genetics_optimizer* optimizer);
+
+/**
+ * Best candidate of the last completed generation
+ * @return 0 before the first generation completes
+ */
+int genetics_best(const genetics_optimizer* optimizer, double* genes, int* success, double* score);
+
+/**
+ * Runs a whole tuning on the built-in 1D plant
+ * @param genes receives the winning genome, genetics_run_num_genes() doubles
+ */
+int genetics_run(const char* config, double* genes, int* success, double* score, char* error, size_t errorSize);
+unsigned int genetics_run_num_genes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif//GENETICS_H
@@ -16,63 +16,549 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "CachedProcessor.hpp"
+#include "Config.hpp"
+#include "Farm.hpp"
+#include "FarmProcessor.hpp"
+#include "FitnessDb.hpp"
 #include "God.hpp"
-#include "PDParam.hpp"
+#include "IsolatedProcessor.hpp"
+#include "LatencyProcessor.hpp"
 #include "PID1DProcessor.hpp"
-#include "PIDAlgo.hpp"
+#include "Population.hpp"
+#include "SimulatorProcessor.hpp"
+#include "Trace.hpp"
+#include "TrajectoryFile.hpp"
+#include "TrajectoryProcessor.hpp"
 #include "rand.h"
 
+#include <deque>
 #include <pthread.h>
+#include <signal.h>
+#include <sstream>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 
 /**
  * Main program
  * Simulates a 1D robot moving towards a goal
  * Uses a genetic algorithm to tune the PID control loop governing its motion
+ * Usage: genetics [--config genetics.ini] [--key=value ...]
+ * Run with --help for every setting and its default, see Config.hpp
+ * GENETICS_TRACE still names the trace file unless --trace overrides it
+ *
+ * Retuning after a small plant change: save the successors of the first
+ * run with --saveSuccessors, then start the next from them with
+ * --warmStart and a few numCycles. In --online mode the --config file is
+ * polled every generation and plant changes are applied to the running
+ * population; Ctrl-C ends the run after the current generation
+ *
+ * With --fitnessDb every score is kept in a file that later and concurrent
+ * runs on the same plant look up before simulating
+ *
+ * With --farm evaluations go to genetics-worker processes connecting to
+ * that port, --farmWorkers of them started here from the directory of this
+ * program. The chunks God hands out are then sized for the farm rather
+ * than calibrated, as the local threads only wait on the network
+ *
+ * With --isolate evaluations run in that many forked worker processes, so
+ * a plant that crashes or hangs (--isolateTimeout) costs only the
+ * algorithm being scored. One thread then hands God's chunks to them
+ *
+ * --plantLatency makes every evaluation wait that long, as a rig would.
+ * Chunks are sized as for the farm and each thread keeps its whole chunk
+ * waiting at once, up to --asyncInFlight over all threads, rather than
+ * blocking per evaluation
+ *
+ * --simulator replaces the built-in plant with an external program, run
+ * as --simulatorProcesses long-lived processes, see SimulatorProcessor.
+ * Plant settings then only matter to the simulator's own configuration
+ *
+ * --objectives runs NSGA-II on those objectives instead and prints the
+ * Pareto front; the winner is the front's best score
+ *
+ * --trajectories scores tracking of the setpoint profiles in that file,
+ * mapped once and read by every thread, instead of the step to the goal
  */
 
-int main(int argc, char** argv)
+static God* s_god = NULL;
+
+static void stopGod(int sig)
 {
-    init_rng();
+    s_god->stop();
+}
 
-    static const double timeout                     =   5.00;
-    static const double timein                      =   1.00;
-    static const double threshold                   =   0.01;
-    static const double maxVoltage                  =  12.00;
-    static const double minVoltage                  = -12.00;
-    static const double goal                        =   1.00;
-    static const double mass                        =  1.000;
-    static const double motorStallTorque            = 010.00;
-    static const double motorFreeSpeed              = 010.00;
-    static const double gearingRatio                =   1.00;
-    static const double wheelDiameter               =   0.03;
-    static const double staticFriction              =   0.50;
-    static const double kineticFriction             =   0.10;
-    static const double seedKP                      =   0.00;
-    static const double seedKI                      =   0.00;
-    static const double seedKD                      =   0.00;
-    static const double k                           =   1.00;
+static long long modifiedTime(const std::string& filename)
+{
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0)
+    {
+        return 0;
+    }
+    return st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
 
-    static const unsigned int populationSize        =  4000;
-    static const unsigned int successorSize         =    10;
-    static const unsigned int minThreadWorkloadSize =   100;
-    static const unsigned int maxNumThreads         =     8;
-    static const unsigned int numCycles             =   100;
+/**
+ * Puts the farm, worker processes or external simulator and the fitness
+ * database, where used, in front of the plant
+ * @param owned receives the wrappers created
+ * @return NULL if the worker processes cannot be started
+ */
+static Processor* wrapProcessor(Processor* processor, const RunConfig& config, Farm* farm, SimulatorProcessor* simulator, FitnessDb& db, std::vector<Processor*>& owned, std::string& error)
+{
+    Processor* wrapped = processor;
+    if (simulator)
+    {
+        wrapped = simulator;
+    }
+    else if (farm)
+    {
+        wrapped = new FarmProcessor(*farm, config);
+        owned.push_back(wrapped);
+    }
+    else if (config.isolate)
+    {
+        std::vector<Algo*> prototype = createSeeds(config);
+        IsolatedProcessor* isolated = new IsolatedProcessor(*processor, *prototype[0], config.isolate, config.populationSize, config.isolateTimeout, config.isolateAttempts, config.isolateRecycle);
+        owned.push_back(isolated);
+        delete prototype[0];
+        if (!isolated->start(error))
+        {
+            return NULL;
+        }
+        wrapped = isolated;
+    }
+    else if (config.plantLatency > 0)
+    {
+        wrapped = new LatencyProcessor(*processor, config.plantLatency, config.asyncInFlight);
+        owned.push_back(wrapped);
+    }
+    if (db.isOpen())
+    {
+        wrapped = new CachedProcessor(*wrapped, db, plantHash(config), config.fitnessDbBits);
+        owned.push_back(wrapped);
+    }
+    return wrapped;
+}
 
-    PID1DProcessor processor(timeout, timein, threshold, maxVoltage, minVoltage, goal, mass, motorStallTorque, motorFreeSpeed, gearingRatio, wheelDiameter, staticFriction, kineticFriction);
+/**
+ * A plant and everything in front of it, owned together so that a
+ * reload can free a whole chain at once
+ */
+class ProcessorChain
+{
+    public:
+        /**
+         * @return NULL if the chain cannot be started
+         */
+        static ProcessorChain* create(const RunConfig& config, Farm* farm, SimulatorProcessor* simulator, FitnessDb& db, const TrajectoryFile& trajectories, std::string& error)
+        {
+            ProcessorChain* chain = new ProcessorChain(createProcessor(config));
+            if (trajectories.isOpen())
+            {
+                chain->plant = new TrajectoryProcessor(*chain->processor, trajectories);
+                chain->wrappers.push_back(chain->plant);
+            }
+            chain->evaluator = wrapProcessor(chain->plant, config, farm, simulator, db, chain->wrappers, error);
+            if (!chain->evaluator)
+            {
+                delete chain;
+                return NULL;
+            }
+            return chain;
+        }
+
+        ~ProcessorChain()
+        {
+            // Outermost first, each wrapper may use the one it wraps until it stops
+            for(unsigned int i = wrappers.size(); i > 0; i--)
+            {
+                delete wrappers[i - 1];
+            }
+            delete processor;
+        }
+
+        PID1DProcessor* processor;
+        // The processor, or the trajectory tracker on it
+        Processor* plant;
+        // What God scores with
+        Processor* evaluator;
+        std::vector<Processor*> wrappers;
+
+    private:
+        ProcessorChain(PID1DProcessor* p)
+            : processor(p)
+            , plant(p)
+            , evaluator(NULL)
+        {
+        }
+
+        ProcessorChain(const ProcessorChain& chain);
+        const ProcessorChain& operator=(const ProcessorChain& chain);
+};
+
+/**
+ * Reloads the configuration whenever its file changes and hands God a
+ * processor for the new plant
+ * Only the plant constants may change, see copyPlant(); a reload that
+ * changes anything else is ignored with the offending settings listed.
+ * Owns the chain God starts with and every reloaded one. God swaps in the
+ * chain of a reload when the next generation starts, before the next
+ * record(), so only that chain and the newest are kept; older ones, worker
+ * processes and threads included, are freed.
+ */
+class OnlineSink : public virtual MetricsSink
+{
+    public:
+        OnlineSink(God& god, RunConfig& config, int argc, char** argv, Farm* farm, FitnessDb& db, const TrajectoryFile& trajectories, ProcessorChain* chain)
+            : m_god(god)
+            , m_config(config)
+            , m_argc(argc)
+            , m_argv(argv)
+            , m_modified(modifiedTime(config.configFile))
+            , m_farm(farm)
+            , m_db(db)
+            , m_trajectories(trajectories)
+        {
+            m_chains.push_back(chain);
+        }
+
+        ~OnlineSink()
+        {
+            for(unsigned int i = 0; i < m_chains.size(); i++)
+            {
+                delete m_chains[i];
+            }
+        }
+
+        virtual void record(const GenerationStats& stats)
+        {
+            long long modified = modifiedTime(m_config.configFile);
+            if (modified == m_modified)
+            {
+                return;
+            }
+            m_modified = modified;
+            RunConfig config;
+            config.trace = m_config.trace;
+            std::string error;
+            if (!parseConfigArgs(config, m_argc, m_argv, error) || !validateConfig(config, error))
+            {
+                fprintf(stderr, "Ignoring %s: %s\n", m_config.configFile.c_str(), error.c_str());
+                return;
+            }
+            RunConfig running = m_config;
+            copyPlant(config, running);
+            std::string others = configDiff(running, config);
+            if (others.size())
+            {
+                fprintf(stderr, "Ignoring %s, only plant constants can change online:\n%s", m_config.configFile.c_str(), others.c_str());
+                return;
+            }
+            // God has used the previous chain since this generation started
+            while (m_chains.size() > 1)
+            {
+                delete m_chains.front();
+                m_chains.pop_front();
+            }
+            ProcessorChain* chain = ProcessorChain::create(config, m_farm, NULL, m_db, m_trajectories, error);
+            if (!chain)
+            {
+                fprintf(stderr, "Ignoring %s: %s\n", m_config.configFile.c_str(), error.c_str());
+                return;
+            }
+            std::string diff = configDiff(m_config, config);
+            printf("Reloaded %s after generation %u:\n%s", m_config.configFile.c_str(), stats.generation, diff.c_str());
+            m_chains.push_back(chain);
+            m_god.setProcessor(*chain->evaluator);
+            m_config = config;
+        }
+
+        /**
+         * Chain of the last reload, or the one God started with
+         */
+        ProcessorChain* chain() const
+        {
+            return m_chains.back();
+        }
+
+    private:
+        God& m_god;
+        RunConfig& m_config;
+        int m_argc;
+        char** m_argv;
+        long long m_modified;
+        Farm* m_farm;
+        FitnessDb& m_db;
+        const TrajectoryFile& m_trajectories;
+        std::deque<ProcessorChain*> m_chains;
+};
+
+int main(int argc, char** argv)
+{
+    RunConfig config;
+    const char* tracename = getenv("GENETICS_TRACE");
+    if (tracename)
+    {
+        config.trace = tracename;
+    }
+
+    std::string error;
+    if (!parseConfigArgs(config, argc, argv, error))
+    {
+        if (error.size())
+        {
+            fprintf(stderr, "%s, see %s --help\n", error.c_str(), argv[0]);
+            return 1;
+        }
+        printf("Usage: %s [--config genetics.ini] [--key=value ...]\n%s", argv[0], configUsage().c_str());
+        return 0;
+    }
+    if (!validateConfig(config, error))
+    {
+        fprintf(stderr, "Invalid configuration: %s\n", error.c_str());
+        return 1;
+    }
+    if (config.online && config.configFile.empty())
+    {
+        fprintf(stderr, "Online mode needs a --config file to watch\n");
+        return 1;
+    }
+
+    init_rng();
+    if (config.seed)
+    {
+        seed_rng(config.seed);
+    }
+    if (config.trace.size())
+    {
+        traceEnable();
+    }
 
-    std::vector<Algo*> seeds(1);
-    seeds[0] = new PIDAlgo(new PDParam(seedKP, k), new PDParam(seedKI, 0), new PDParam(seedKD, k/100.0), maxVoltage, minVoltage);
+    std::vector<Algo*> seeds = createSeeds(config);
+    if (config.warmStart.size())
+    {
+        std::vector<std::string> geneNames;
+        std::vector<SavedAlgo> saved;
+        std::string savedConfig;
+        std::vector<Algo*> restored;
+        if (!loadPopulation(config.warmStart, geneNames, saved, savedConfig, error) || !restorePopulation(*seeds[0], geneNames, saved, restored, error))
+        {
+            fprintf(stderr, "Cannot warm start: %s\n", error.c_str());
+            return 1;
+        }
+        RunConfig previous;
+        if (loadConfigString(previous, savedConfig, error))
+        {
+            printf("Warm start from %u algorithms in %s, changes since:\n%s", (unsigned int) restored.size(), config.warmStart.c_str(), configDiff(previous, config).c_str());
+        }
+        else
+        {
+            fprintf(stderr, "Warm start from %u algorithms in %s, its saved settings cannot be read: %s\n", (unsigned int) restored.size(), config.warmStart.c_str(), error.c_str());
+            error.clear();
+        }
+        for(unsigned int i = 0; i < seeds.size(); i++)
+        {
+            delete seeds[i];
+        }
+        seeds = restored;
+    }
 
+    FitnessDb db;
+    if (config.fitnessDb.size() && !db.open(config.fitnessDb, config.fitnessDbSize * 1048576ULL, error))
+    {
+        fprintf(stderr, "Cannot use fitness database: %s\n", error.c_str());
+        return 1;
+    }
+    Farm* farm = NULL;
+    if (config.farm.size())
+    {
+        farm = new Farm(config.farmBatchSize, config.farmPipeline, config.farmTimeout, config.farmAttempts);
+        std::string program = argv[0];
+        program = program.substr(0, program.rfind('/') + 1) + "genetics-worker";
+        if (!farm->listen(config.farm, error) || !farm->spawnWorkers(config.farmWorkers, program, config.farmWorkerThreads, error))
+        {
+            fprintf(stderr, "Cannot start farm: %s\n", error.c_str());
+            return 1;
+        }
+        printf("Farm listening on port %u\n", farm->port());
+    }
+    SimulatorProcessor* simulator = NULL;
+    if (config.simulator.size())
+    {
+        std::vector<std::string> command;
+        std::stringstream words(config.simulator);
+        std::string word;
+        while (words >> word)
+        {
+            command.push_back(word);
+        }
+        simulator = new SimulatorProcessor(command, config.simulatorProcesses, config.simulatorBatchSize, config.simulatorPipeline, config.simulatorTimeout, config.simulatorAttempts, config.asyncInFlight);
+        if (!simulator->start(error))
+        {
+            fprintf(stderr, "Cannot start simulator: %s\n", error.c_str());
+            return 1;
+        }
+    }
+    TrajectoryFile trajectories;
+    if (config.trajectories.size() && !trajectories.open(config.trajectories, error))
+    {
+        fprintf(stderr, "Cannot use trajectories: %s\n", error.c_str());
+        return 1;
+    }
+    if (trajectories.isOpen())
+    {
+        printf("Tracking %u profiles of %s\n", trajectories.numProfiles(), config.trajectories.c_str());
+    }
+    ProcessorChain* chain = ProcessorChain::create(config, farm, simulator, db, trajectories, error);
+    if (!chain)
+    {
+        fprintf(stderr, "Cannot start evaluation: %s\n", error.c_str());
+        return 1;
+    }
 
-    God god(processor, seeds, populationSize, successorSize, minThreadWorkloadSize, maxNumThreads, numCycles);
+    God god(*chain->evaluator, seeds, config.populationSize, config.successorSize, config.initialChunkSize, config.maxNumThreads, config.numCycles);
+    if (farm || simulator || config.plantLatency > 0)
+    {
+        unsigned int numThreads = god.getTuner().maxNumThreads();
+        god.getTuner().fix(numThreads, std::max(config.populationSize / (numThreads * ThreadTuner::chunksPerThread), 1U));
+    }
+    else if (config.isolate)
+    {
+        god.getTuner().fix(1, config.populationSize);
+    }
+    god.setKeepSeeds(config.warmStart.size() > 0);
+    god.setStreaming(config.streaming);
+    god.setRacing(config.racing, config.racingDelta);
+    god.setLogPrefix(config.logPrefix, config.logging);
+    god.setPerfCounters(config.perf);
+    ConsoleSink console;
+    god.addSink(&console);
+    MetricsSink* metrics = NULL;
+    if (config.metrics.size())
+    {
+        metrics = createMetricsSink(config.metrics);
+        if (!metrics)
+        {
+            fprintf(stderr, "Cannot write metrics to %s, expected a .jsonl, .csv or .bin file\n", config.metrics.c_str());
+            return 1;
+        }
+        god.addSink(metrics);
+    }
+    OnlineSink* online = NULL;
+    if (config.online)
+    {
+        online = new OnlineSink(god, config, argc, argv, farm, db, trajectories, chain);
+        god.addSink(online);
+        s_god = &god;
+        signal(SIGINT, stopGod);
+        signal(SIGTERM, stopGod);
+    }
 
-    AlgoScore best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    AlgoScore best;
+    std::vector<ParetoPoint> front;
+    if (config.objectives.size())
+    {
+        front = god.simulatePareto();
+        best.algo = front[0].algo;
+        best.score = front[0].score;
+        for(unsigned int i = 1; i < front.size(); i++)
+        {
+            const Processor::Score& score = front[i].score;
+            if (score.success != best.score.success ? score.success : score.score < best.score.score)
+            {
+                best.algo = front[i].algo;
+                best.score = score;
+            }
+        }
+    }
+    else
+    {
+        best = god.simulate<God::minScoreHeap, God::patientComplete>();
+    }
+    if (online)
+    {
+        chain = online->chain();
+    }
 
     printf("Winning Algo:\n");
     printf("%s",best.algo->getSummary().c_str());
     printf("Success: %d Score: %f\n", best.score.success, best.score.score);
-    processor.process(best.algo, "winner.log");
+    if (front.size())
+    {
+        std::vector<PID1DProcessor::Objective> objectives;
+        PID1DProcessor::parseObjectives(config.objectives, objectives, error);
+        std::vector<std::string> geneNames = best.algo->getGeneNames();
+        printf("Pareto front of %u algorithms:\n", (unsigned int) front.size());
+        for(unsigned int i = 0; i < front.size(); i++)
+        {
+            std::vector<double> genes = front[i].algo->getGenes();
+            for(unsigned int j = 0; j < genes.size() && j < geneNames.size(); j++)
+            {
+                printf("%s: %g ", geneNames[j].c_str(), genes[j]);
+            }
+            printf("|");
+            for(unsigned int j = 0; j < objectives.size(); j++)
+            {
+                printf(" %s: %g", PID1DProcessor::objectiveName(objectives[j]), front[i].objectives[j]);
+            }
+            printf("\n");
+        }
+    }
+    printf("Tuned %s", god.getTuner().getSummary().c_str());
+    if (db.isOpen())
+    {
+        printf("Fitness database: %llu of %llu evaluations reused\n", db.hits(), db.lookups());
+    }
+    if (farm)
+    {
+        printf("%s", farm->getSummary().c_str());
+    }
+    if (simulator)
+    {
+        printf("%s", simulator->getSummary().c_str());
+    }
+    for(unsigned int i = 0; i < chain->wrappers.size(); i++)
+    {
+        IsolatedProcessor* isolated = dynamic_cast<IsolatedProcessor*>(chain->wrappers[i]);
+        AsyncProcessor* async = dynamic_cast<AsyncProcessor*>(chain->wrappers[i]);
+        if (isolated)
+        {
+            printf("%s", isolated->getSummary().c_str());
+        }
+        if (async)
+        {
+            printf("Async: %u of %u evaluations in flight at most\n", async->peakInFlight(), async->maxInFlight());
+        }
+    }
+    chain->plant->process(best.algo, config.logPrefix + "winner.log");
+    if (config.saveSuccessors.size())
+    {
+        if (savePopulation(config.saveSuccessors, best.algo->getGeneNames(), god.getSuccessors(), configToString(config), error))
+        {
+            printf("Saved %u successors to %s\n", (unsigned int) god.getSuccessors().size(), config.saveSuccessors.c_str());
+        }
+        else
+        {
+            fprintf(stderr, "Cannot save successors: %s\n", error.c_str());
+        }
+    }
+    delete metrics;
+    if (online)
+    {
+        delete online;
+    }
+    else
+    {
+        delete chain;
+    }
+    delete farm;
+    delete simulator;
+    if (config.trace.size() && !traceWrite(config.trace))
+    {
+        fprintf(stderr, "Cannot write trace to %s\n", config.trace.c_str());
+    }
 
     free_rng();
 
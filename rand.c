@@ -26,15 +26,21 @@
 
 const gsl_rng_type* T;
 gsl_rng* r;
+static __thread gsl_rng* t_r = NULL;
+
+static inline gsl_rng* current_rng()
+{
+    return t_r ? t_r : r;
+}
 
 double randf()
 {
-    return gsl_rng_uniform(r);
+    return gsl_rng_uniform(current_rng());
 }
 
 double randgauss(const double mu, const double sigma)
 {
-    return gsl_ran_gaussian_ziggurat(r,sigma)+mu;
+    return gsl_ran_gaussian_ziggurat(current_rng(),sigma)+mu;
 }
 
 void init_rng()
@@ -45,8 +51,54 @@ void init_rng()
     gsl_rng_set(r,time(NULL));
 }
 
+void seed_rng(unsigned long seed)
+{
+    gsl_rng_set(r,seed);
+}
+
 void free_rng()
 {
     gsl_rng_free(r);
 }
 
+void init_thread_rng(unsigned long seed)
+{
+    if (!t_r)
+    {
+        t_r = gsl_rng_alloc(gsl_rng_taus);
+    }
+    gsl_rng_set(t_r,seed);
+}
+
+void free_thread_rng()
+{
+    if (t_r)
+    {
+        gsl_rng_free(t_r);
+        t_r = NULL;
+    }
+}
+
+void* rng_create(unsigned long seed)
+{
+    gsl_rng* rng = gsl_rng_alloc(gsl_rng_taus);
+    gsl_rng_set(rng,seed);
+    return rng;
+}
+
+void* rng_select(void* rng)
+{
+    gsl_rng* previous = t_r;
+    t_r = static_cast<gsl_rng*>(rng);
+    return previous;
+}
+
+void rng_reseed(void* rng, unsigned long seed)
+{
+    gsl_rng_set(static_cast<gsl_rng*>(rng),seed);
+}
+
+void rng_destroy(void* rng)
+{
+    gsl_rng_free(static_cast<gsl_rng*>(rng));
+}
@@ -20,6 +20,13 @@
   * Provides an interface and
   * wrappers for random functions
   * from the GNU Scientific Library
+  * init_rng() sets up the process-wide generator; a thread that calls
+  * init_thread_rng() draws from its own seeded generator instead until
+  * free_thread_rng(), so concurrent runs stay independent and reproducible
+  * rng_create() makes a private generator, e.g. one per optimizer object;
+  * rng_select() makes the calling thread draw from it and returns the
+  * previous selection (NULL for the default) so it can be restored;
+ * rng_reseed() restarts a private generator from a new seed
   */
 
 #ifndef RAND_H
@@ -28,7 +35,14 @@
 double randf();
 double randgauss(const double sigma, const double mu);
 void init_rng();
+void seed_rng(unsigned long seed);
 void free_rng();
+void init_thread_rng(unsigned long seed);
+void free_thread_rng();
+void* rng_create(unsigned long seed);
+void* rng_select(void* rng);
+void rng_reseed(void* rng, unsigned long seed);
+void rng_destroy(void* rng);
 
 #endif//RAND_H
 